@@ -1,31 +1,124 @@
 #include "AddressBook.hpp"
-#include <QtSql/QSqlDatabase>
-#include <QtSql/QSqlError>
-#include <QSqlQuery>
 #include <QMessageBox>
-#include <QSqlRecord>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QListWidget>
+#include <QPushButton>
+#include <QVBoxLayout>
+#include <QHeaderView>
+#include <QStatusBar>
+#include <QFileDialog>
+#include <QDebug>
+#include <QLabel>
+#include <QTimer>
+#include <QCloseEvent>
+#include <QSignalBlocker>
+#include "PhoneNumber.hpp"
+#include "ItemValidator.hpp"
+#include "Trace.hpp"
+#include "ContactSnapshot.hpp"
+#include <QPromise>
+#include <QtConcurrent/QtConcurrentRun>
+
+AddressBook::AddressBook(QWidget *parent, bool lowMemoryMode, WriteQueue::Durability durability, bool snapshotCache)
+    : QMainWindow(parent), lowMemoryMode(lowMemoryMode), snapshotCache(snapshotCache) {
+    // Страницы контактов передаются из потока загрузчика через очередь сигналов
+    qRegisterMetaType<QVector<Item>>("QVector<Item>");
 
-AddressBook::AddressBook(QWidget *parent) : QMainWindow(parent) {
     setupUI();
-    loadAddressBook();
+
+    // Подключаемся к БД один раз на всё время работы программы. Открытие - единственный запрос,
+    // ответа на который GUI ждёт: без БД окну нечего показать.
+    StorageReply reply = storage.open().result();
+    if (!reply.ok) {
+        QMessageBox::critical(this, "Ошибка!", reply.errorText);
+    }
+
+    // Правки пишутся в БД группами через очередь
+    writeQueue = new WriteQueue(model, &storage, this);
+    writeQueue->setDurability(durability);
+    connect(writeQueue, &WriteQueue::failed, this, [this](const QString &errText) {
+        QMessageBox::critical(this, "Ошибка БД", "Ошибка сохранения адресной книги в БД: " + errText);
+    });
+    connect(writeQueue, &WriteQueue::conflicted, this, [this](int count) {
+        QMessageBox::warning(this, "Конфликт правок", QString("Не записано правок: %1. Эти контакты уже изменили или удалили "
+                             "в другом окне, в таблице показаны их данные из БД.").arg(count));
+    });
+
+    // Слежение за чужими правками начнётся, когда книга загрузится
+    changeWatcher = new ChangeWatcher(model, &storage, this);
+    connect(changeWatcher, &ChangeWatcher::changesApplied, this, [this](int count) {
+        statusBar()->showMessage(QString("Обновлено из БД контактов: %1").arg(count), 3000);
+    });
+    connect(changeWatcher, &ChangeWatcher::failed, this, [this](const QString &errText) {
+        statusBar()->showMessage("Ошибка обновления из БД: " + errText, 5000);
+    });
+
+    // После открытия из снимка индексы поиска строятся в фоне. До того обычный поиск идёт просмотром,
+    // а нечёткий не находит ничего, поэтому показанный результат ищем заново по готовым индексам
+    connect(model, &ContactsModel::indexReady, this, [this]() {
+        statusBar()->showMessage("Индекс поиска готов", 3000);
+        if (!searchInput->text().trimmed().isEmpty() && !birthdaysButton->isChecked()) liveSearch->setQuery(searchInput->text());
+    });
+
+    eventLoopMonitor = new EventLoopMonitor(this);
+
+    setupSearch();
+
+    // С --stats или --trace в строке состояния раз в секунду обновляется сводка замеров
+    if (Trace::isEnabled()) {
+        QLabel *statsLabel = new QLabel(this);
+        statusBar()->addPermanentWidget(statsLabel);
+        QTimer *statsTimer = new QTimer(this);
+        connect(statsTimer, &QTimer::timeout, this, [statsLabel]() { statsLabel->setText(Trace::shortStats()); });
+        statsTimer->start(1000);
+    }
+
+    // Снимок на диске открывается за доли секунды; читать книгу из БД нужно, только если его нет или он не от этой БД
+    bool fromSnapshot = snapshotCache && storage.isOpen() && !(lowMemoryMode && storage.hasFullTextSearch()) && loadSnapshot();
+    if (!fromSnapshot) loadAddressBook();
 }
 
 AddressBook::~AddressBook() {
+    // Если книга ещё загружается, останавливаем загрузчик: после очередной страницы он увидит запрос и выйдет
+    if (loaderThread) {
+        loaderThread->requestInterruption();
+        loaderThread->quit();
+        loaderThread->wait();
+    }
+    // Импорт тоже останавливается после текущей порции, записанное уже в БД
+    if (importThread) {
+        importThread->requestInterruption();
+        importThread->quit();
+        importThread->wait();
+    }
+    if (exportThread) {
+        exportThread->requestInterruption();
+        exportThread->quit();
+        exportThread->wait();
+    }
+
+    // Поиск повторов работает со своим снимком книги, достаточно попросить его остановиться
+    duplicateSearch.cancel();
+
+    if (snapshotCache) writeSnapshot();
+
+    // Последняя группа правок уходит в поток БД, деструктор storage дождётся её
     saveAddressBook();
+
+    qInfo().noquote() << "Задержки цикла событий:" << eventLoopMonitor->histogram().summary();
+    qInfo().noquote() << "Запросы к БД:" << storage.latency().summary();
 }
 
 void AddressBook::setupUI() {
-    // Создаем таблицу
-    table = new QTableWidget(this);
-
-    // В таблице у нас будет 7 столбцов
-    table->setColumnCount(7);
+    // Создаем модель и таблицу. Колонки и их заголовки (7 штук) описаны в ContactsModel
+    model = new ContactsModel(this);
+    table = new QTableView(this);
+    table->setModel(model);
 
-    // Определим названия заголовков всех шести столбцов.
-    table->setHorizontalHeaderLabels(QStringList() << "#" << "ФАМИЛИЯ" << "ИМЯ" << "ОТЧЕСТВО" << "НОМЕР ТЕЛЕФОНА" << "E-MAIL" << "ДАТА РОЖДЕНИЯ");
     table->setStyleSheet("QHeaderView::section { background-color:'light grey' }");
 
-    // А вот и бесплатная сортировка :)
+    // Сортировка по клику на заголовок, саму сортировку делает ContactsModel::sort
     table->setSortingEnabled(true);
 
     // Отключаем обработчики на события редактирования (чтобы не пытались прямо в таблице редактировать)
@@ -34,6 +127,9 @@ void AddressBook::setupUI() {
     // Установим такое поведение выбора в таблице, чтобы выделялась всегда целая строка при выборе любого из столбцов.
     table->setSelectionBehavior(QAbstractItemView::SelectRows);
 
+    // Все строки одной высоты, так представлению не нужно измерять каждую строку
+    table->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+
     // Создаем макет для расположения кнопок
     QHBoxLayout *buttonLayout = new QHBoxLayout();  // Макет для кнопок
 
@@ -47,22 +143,51 @@ void AddressBook::setupUI() {
     deleteButton = new QPushButton("Удалить", this);
     deleteButton->setStyleSheet("padding: 8px; max-width:80px; background-color:#b8c5d9; }");
 
-    searchButton = new QPushButton("Поиск контакта", this);
-    searchButton->setStyleSheet("padding: 8px; max-width:100px; background-color:#b8c5d9; }");
-
     addPhoneNumberButton = new QPushButton("Добавить номер", this);
     addPhoneNumberButton->setStyleSheet("padding: 8px; max-width:100px; background-color:#b8c5d9; }");
 
+    importButton = new QPushButton("Импорт", this);
+    importButton->setStyleSheet("padding: 8px; max-width:80px; background-color:#b8c5d9; }");
+
+    exportButton = new QPushButton("Экспорт", this);
+    exportButton->setStyleSheet("padding: 8px; max-width:80px; background-color:#b8c5d9; }");
+
+    duplicatesButton = new QPushButton("Повторы", this);
+    duplicatesButton->setStyleSheet("padding: 8px; max-width:80px; background-color:#b8c5d9; }");
+
+    birthdaysButton = new QPushButton("Дни рождения", this);
+    birthdaysButton->setStyleSheet("padding: 8px; max-width:100px; background-color:#b8c5d9; }");
+    birthdaysButton->setToolTip(QString("Контакты с днём рождения в ближайшие %1 дней").arg(UpcomingBirthdayDays));
+    birthdaysButton->setCheckable(true);
+
     buttonLayout->addWidget(addButton);
     buttonLayout->addWidget(editButton);
     buttonLayout->addWidget(deleteButton);
-    buttonLayout->addWidget(searchButton);
     buttonLayout->addWidget(addPhoneNumberButton);
+    buttonLayout->addWidget(importButton);
+    buttonLayout->addWidget(exportButton);
+    buttonLayout->addWidget(duplicatesButton);
+    buttonLayout->addWidget(birthdaysButton);
 
     // Создаём наш основной макет и запихиваем в него нашу таблицу и макет с кнопками
     QVBoxLayout *mainLayout = new QVBoxLayout();
 
+    // Строка поиска: таблица фильтруется по мере ввода
+    searchInput = new QLineEdit(this);
+    searchInput->setPlaceholderText("Поиск: фамилия, имя, телефон, e-mail (через запятую - любой из вариантов)");
+    searchInput->setClearButtonEnabled(true);
+    searchInput->setStyleSheet("padding: 5px");
+
+    // Нечёткий поиск: ФИО с опечатками или латиницей
+    fuzzySearchBox = new QCheckBox("С опечатками", this);
+    fuzzySearchBox->setToolTip("Искать по фамилии, имени и отчеству с опечатками и в латинской записи");
+
+    QHBoxLayout *searchLayout = new QHBoxLayout();
+    searchLayout->addWidget(searchInput);
+    searchLayout->addWidget(fuzzySearchBox);
+
     mainLayout->addLayout(buttonLayout);
+    mainLayout->addLayout(searchLayout);
     mainLayout->addWidget(table);
 
     // Создаем центральный виджет для QMainWindow
@@ -77,8 +202,11 @@ void AddressBook::setupUI() {
     connect(addButton, &QPushButton::clicked, this, &AddressBook::addAddressBookItem);
     connect(editButton, &QPushButton::clicked, this, &AddressBook::editAddressBookItem);
     connect(deleteButton, &QPushButton::clicked, this, &AddressBook::delAddressBookItem);
-    connect(searchButton, &QPushButton::clicked, this, &AddressBook::searchAddressBookItem);
     connect(addPhoneNumberButton, &QPushButton::clicked, this, &AddressBook::addPhoneNumber);
+    connect(importButton, &QPushButton::clicked, this, &AddressBook::importAddressBook);
+    connect(exportButton, &QPushButton::clicked, this, &AddressBook::exportAddressBook);
+    connect(duplicatesButton, &QPushButton::clicked, this, &AddressBook::findDuplicates);
+    connect(birthdaysButton, &QPushButton::toggled, this, &AddressBook::showUpcomingBirthdays);
 }
 
 void AddressBook::addAddressBookItem() {
@@ -101,97 +229,57 @@ void AddressBook::addAddressBookItem() {
         item.userEmail = itemData[4];
         item.userBirthday = itemData[5];
 
-        QString key = item.userLastName + " " + item.userFirstName + " " + item.userPatronymicName;
-        items[key] = item;
-
-        // Надо бы вынести подключение к БД в единое место и одной строкой вызывать.
-        QSqlDatabase db;
-        db = QSqlDatabase::addDatabase("QSQLITE");
-        db.setDatabaseName("C:/sqlite_db/address_book.db");
-
-        if (!db.open()) {
-            QMessageBox::critical(this, "Ошибка!", "Ошибка подключения к БД: " + db.lastError().text());
-            return;
-        }
+        // Добавляем контакт в модель, таблица сама покажет новую строку
+        model->appendItem(item);
 
-        QSqlQuery qry;
-        qry.prepare("INSERT INTO address_book (user_id, lastname, firstname, patronymic, phone_list, email, birthday) "
-                    "VALUES (NULL, :lastname, :firstname, :patronymic, :phone_list, :email, :birthday)");
-        //Привязка значений
-        qry.bindValue(":lastname", item.userLastName);
-        qry.bindValue(":firstname", item.userFirstName);
-        qry.bindValue(":patronymic", item.userPatronymicName);
-        qry.bindValue(":phone_list", userPhonesListList.join(",")); // В БД добавляем номера разделяя их запятыми
-        qry.bindValue(":email", item.userEmail);
-        qry.bindValue(":birthday", item.userBirthday);
-
-        bool ret = qry.exec();
-        if (!ret) {
-            QString errText = qry.lastError().text();
-            QMessageBox::critical(this, "Ошибка БД", "Ошибка добавления записи в таблицу БД: " + errText);
-            return;
-        }
-
-        // Мы добавили в базу новый контакт. Вытащим его уникальный идентификатор (LAST_INSERT_ID)
-        QString lastInsertUserId = qry.lastInsertId().toString();
-
-        // Добавляем контакт в таблицу
-        //Сначала мы считываем количество уже существующих строк в таблице (это количество контактов) с помощью rowCount().
-        //Затем добавляем новую строку в конец таблицы с помощью insertRow(row).
-        int row = table->rowCount();
-        table->insertRow(row);
-        table->setItem(row, 0, new QTableWidgetItem(lastInsertUserId));
-        table->setItem(row, 1, new QTableWidgetItem(item.userLastName));
-        table->setItem(row, 2, new QTableWidgetItem(item.userFirstName));
-        table->setItem(row, 3, new QTableWidgetItem(item.userPatronymicName));
-        table->setItem(row, 4, new QTableWidgetItem(userPhonesListList.join(", "))); // Отображаем все номера через запятую
-        table->setItem(row, 5, new QTableWidgetItem(item.userEmail));
-        table->setItem(row, 6, new QTableWidgetItem(item.userBirthday));
-
-        db.close();
-
-        // Теперь мы в БД добавляем запись одним запросом и полная перезапись таблицы нам не нужна
-        //saveAddressBook();
+        // Сохраняются только изменённые записи, так что это ровно один INSERT (в общей транзакции очереди).
+        // После вставки модель получит user_id из БД.
+        writeQueue->changed();
     }
 }
 
 
 void AddressBook::editAddressBookItem() {
-    int row = table->currentRow();
+    int row = table->currentIndex().row();
     if (row < 0) {
         QMessageBox::warning(this, "Ошибка", "Выберите контакт для редактирования.");
         return;
     }
 
-    // Получаем данные юзера из таблицы
-    QString userId = table->item(row, 0)->text();
-    QString userLastName = table->item(row, 1)->text();
-    QString userFirstName = table->item(row, 2)->text();
-    QString userPatronymicName = table->item(row, 3)->text();
-    QStringList userPhonesList = table->item(row, 4)->text().split(", "); // Разделяем номера по запятой
-    QString userEmail = table->item(row, 5)->text();
-    QString userBirthday = table->item(row, 6)->text();
+    // Получаем данные юзера из модели
+    int slot = model->slotAt(row);
+    Item item = model->item(row);
 
     // Создаем список данных для передачи в диалог редактирования
-    QStringList itemData = { userLastName, userFirstName, userPatronymicName, userPhonesList.join(", "), userEmail, userBirthday };
+    QStringList itemData = { item.userLastName, item.userFirstName, item.userPatronymicName,
+                             QStringList::fromVector(item.userPhonesList).join(", "), item.userEmail, item.userBirthday };
 
     // Вызываем диалог редактирования
     editAddressBookItemDialog dialog(itemData, this);
     if (dialog.exec() == QDialog::Accepted) {
+        // Пока диалог был открыт, книга могла обновиться из БД: контакт ищем заново (по user_id, а у ещё
+        // не сохранённого - по слоту) и сверяем с тем, что было открыто на редактирование
+        int itemSlot = item.userId.isEmpty() ? slot : model->slotOfId(item.userId.toLongLong());
+        row = itemSlot < 0 ? -1 : model->rowOfSlot(itemSlot);
+        if (row < 0) {
+            QMessageBox::warning(this, "Ошибка", "Контакт удалён или скрыт, изменения не записаны.");
+            return;
+        }
+        const Item current = model->itemAt(itemSlot);
+        bool changedMeanwhile = false;
+        for (int column = ContactsModel::LastNameColumn; column < ContactsModel::ColumnCount; ++column) {
+            if (ContactsModel::columnText(current, column) != ContactsModel::columnText(item, column)) changedMeanwhile = true;
+        }
+        if (changedMeanwhile) {
+            QMessageBox::StandardButton answer = QMessageBox::question(this, "Внимание!",
+                "Пока вы редактировали контакт, его изменили в другом окне. Записать ваши изменения поверх?");
+            if (answer != QMessageBox::Yes) return;
+        }
+
         // Получаем отредактированные данные
         QStringList updatedItemData = dialog.getItem();
 
-        // Обновляем контакт в таблице
-        table->setItem(row, 1, new QTableWidgetItem(updatedItemData[0])); // Фамилия
-        table->setItem(row, 2, new QTableWidgetItem(updatedItemData[1])); // Имя
-        table->setItem(row, 3, new QTableWidgetItem(updatedItemData[2])); // Отчество
-        table->setItem(row, 4, new QTableWidgetItem(updatedItemData[3])); // Номера телефонов (объединенные через запятую)
-        table->setItem(row, 5, new QTableWidgetItem(updatedItemData[4])); // E-mail
-        table->setItem(row, 6, new QTableWidgetItem(updatedItemData[5])); // Дата рождения
-
-        // Обновляем данные в карте контактов
-        QString key = userLastName + " " + userFirstName + " " + userPatronymicName;
-        Item &item = items[key];
+        // Обновляем данные контакта
         item.userLastName = updatedItemData[0];
         item.userFirstName = updatedItemData[1];
         item.userPatronymicName = updatedItemData[2];
@@ -199,151 +287,90 @@ void AddressBook::editAddressBookItem() {
         item.userEmail = updatedItemData[4];
         item.userBirthday = updatedItemData[5];
 
-        // Надо бы вынести подключение к БД в единое место и одной строкой вызывать.
-        QSqlDatabase db;
-        db = QSqlDatabase::addDatabase("QSQLITE");
-        db.setDatabaseName("C:/sqlite_db/address_book.db");
-
-        if (!db.open()) {
-            QMessageBox::critical(this, "Ошибка!", "Ошибка подключения к БД: " + db.lastError().text());
-            return;
-        }
-        //ОБНОВЛЕНИЕ СТРОКИ ПО USER_ID
-        QSqlQuery qry;
-        qry.prepare("UPDATE address_book SET lastname=:lastname, firstname=:firstname, patronymic=:patronymic, "
-                    "phone_list=:phone_list, email=:email, birthday=:birthday WHERE user_id=:user_id");
-        qry.bindValue(":lastname", item.userLastName);
-        qry.bindValue(":firstname", item.userFirstName);
-        qry.bindValue(":patronymic", item.userPatronymicName);
-        qry.bindValue(":phone_list", updatedItemData[3]); // В БД добавляем номера разделяя их запятыми
-        qry.bindValue(":email", item.userEmail);
-        qry.bindValue(":birthday", item.userBirthday);
-        qry.bindValue(":user_id", userId);
-
-        bool ret = qry.exec();
-        if (!ret) {
-            QString errText = qry.lastError().text();
-            QMessageBox::critical(this, "Ошибка БД", "Ошибка добавления записи в таблицу БД: " + errText);
-            return;
-        }
+        // Обновляем контакт в модели, таблица перерисует только эту строку
+        model->updateItem(row, item);
 
-        // Теперь мы точечно обновляем запись по уникальному user_id, и полная перезапись нам не нужна
-        //saveAddressBook();
+        // Запишется только эта запись (UPDATE по user_id)
+        writeQueue->changed();
     }
 }
 
 
 void AddressBook::delAddressBookItem() {
-    int row = table->currentRow(); // Получаем текущую выбранную строку
+    int row = table->currentIndex().row(); // Получаем текущую выбранную строку
     if (row < 0) {
         QMessageBox::warning(this, "Ошибка", "Выберите контакт для удаления.");
         return;
     }
-//Из выбранной строки извлекается уникальный идентификатор пользователя для удаления.
-    QString userIdForRemove = table->item(row, 0)->text();
-
-    // Получаем ключ контакта (используем фамилию, имя и отчество для идентификации)
-    QString key = table->item(row, 1)->text() + " " +
-                  table->item(row, 2)->text() + " " +
-                  table->item(row, 3)->text();
+    // Удаляем контакт из модели (и строку из таблицы). Его user_id модель запомнит для DELETE.
+    model->removeItem(row);
 
-    // Надо бы вынести подключение куда-нибудь и подключаться к базе одной строчкой.
-    QSqlDatabase db;
-    db = QSqlDatabase::addDatabase("QSQLITE");
-    db.setDatabaseName("C:/sqlite_db/address_book.db");
+    // В БД это будет один DELETE по user_id
+    writeQueue->changed();
 
-    if (!db.open()) {
-        QMessageBox::critical(this, "Ошибка!", "Ошибка подключения к БД: " + db.lastError().text());
-        return;
-    }
+    QMessageBox::information(this, "Успех", "Контакт успешно удален!");
+}
 
-    QSqlQuery qry;
-    qry.prepare("DELETE FROM address_book WHERE user_id=:user_id");
-    qry.bindValue(":user_id", userIdForRemove);
 
-    bool ret = qry.exec();
-    if (!ret) {
-        QString errText = qry.lastError().text();
-        QMessageBox::critical(this, "Ошибка!", "Ошибка удаления записи из БД: " + errText);
-        return;
-    }
-    // Удаляем контакт из словаря
-    if (items.contains(key)) {
-        items.remove(key);
-    }
 
-    // Удаляем строку из таблицы
-    table->removeRow(row);
 
+void AddressBook::setupSearch() {
+    liveSearch = new LiveSearch(model, this);
 
-    // Сохраняем изменения в файл
-    //saveAddressBook();
+    // В режиме экономии памяти книга не загружена, ищем в БД по FTS5
+    bool searchInDatabase = lowMemoryMode && storage.hasFullTextSearch();
+    if (searchInDatabase) liveSearch->setStorage(&storage, SearchResultPageSize);
 
-    QMessageBox::information(this, "Успех", "Контакт успешно удален!");
-}
+    connect(searchInput, &QLineEdit::textChanged, liveSearch, &LiveSearch::setQuery);
 
+    // Нечёткий поиск идёт по книге в памяти, в режиме экономии памяти его нет
+    fuzzySearchBox->setVisible(!searchInDatabase);
+    connect(fuzzySearchBox, &QCheckBox::toggled, liveSearch, &LiveSearch::setFuzzy);
 
+    // Несохранённые изменения сначала пишем в БД, иначе новая страница результатов их затрёт.
+    // Поиск встанет в очередь потока БД после сохранения и увидит сохранённое.
+    connect(liveSearch, &LiveSearch::searchStarted, this, [this, searchInDatabase]() {
+        if (searchInDatabase) saveAddressBook();
+    });
 
+    // Результат поиска заменяет в таблице напоминания о днях рождения
+    auto leaveBirthdays = [this]() {
+        QSignalBlocker blocker(birthdaysButton);
+        birthdaysButton->setChecked(false);
+    };
 
-void AddressBook::searchAddressBookItem() {
-    static bool searchPerformed = false; // Флаг, указывающий, был ли выполнен поиск
+    connect(liveSearch, &LiveSearch::matchesFound, this, [this, leaveBirthdays](const QString &query, const QVector<int> &slotList) {
+        leaveBirthdays();
+        // В таблице остаются только найденные контакты; нечёткий поиск сам упорядочил их по совпадению
+        model->setFilter(slotList, liveSearch->isFuzzy());
+        statusBar()->showMessage(QString("Найдено контактов: %1").arg(slotList.size()));
+        currentSearch = query;
+    });
 
-    if (searchPerformed) {
-        // Если поиск уже выполнен, восстанавливаем видимость всех строк
-        for (int i = 0; i < table->rowCount(); ++i) {
-            table->setRowHidden(i, false); // Показываем все строки
-        }
-        searchPerformed = false; // Сбрасываем флаг
-        return; // Выходим из функции
-    }
+    connect(liveSearch, &LiveSearch::itemsFound, this, [this, leaveBirthdays](const QString &query, const QVector<Item> &items) {
+        leaveBirthdays();
+        model->setItems(items);
+        statusBar()->showMessage(QString("Найдено контактов: %1%2").arg(items.size())
+                                 .arg(items.size() == SearchResultPageSize ? QString(" (показаны самые подходящие)") : QString()));
+        currentSearch = query;
+    });
 
-    searchAddressBookItemDialog dialog(this);
-    if (dialog.exec() == QDialog::Accepted) {
-        QString searchTerms = dialog.getSearchTerm().trimmed();
-        QStringList termsList = searchTerms.split(",", Qt::SkipEmptyParts);
-
-        bool found = false;
-        for (int i = 0; i < table->rowCount(); ++i) {
-            QString cellText = table->item(i, 0)->text(); // Полное имя
-            QString lastName = table->item(i, 2)->text().trimmed(); // Фамилия
-            QString firstName = table->item(i, 1)->text().trimmed(); // Имя
-            QString patronymic = table->item(i, 3)->text().trimmed(); // Отчество
-            QString phone = table->item(i, 4)->text().trimmed(); // Телефон
-            QString email = table->item(i, 5)->text().trimmed(); // Email
-            QString userBirthday = table->item(i, 6)->text().trimmed(); // Дата рождения
-
-            found = false; // Сброс флага перед каждой строкой
-
-            // Проверяем каждое введённое значение
-            for (const QString &term : termsList) {
-                if (cellText.contains(term.trimmed(), Qt::CaseInsensitive) ||
-                    lastName.contains(term.trimmed(), Qt::CaseInsensitive) ||
-                    firstName.contains(term.trimmed(), Qt::CaseInsensitive) ||
-                    patronymic.contains(term.trimmed(), Qt::CaseInsensitive) ||
-                    phone.contains(term.trimmed(), Qt::CaseInsensitive) ||
-                    email.contains(term.trimmed(), Qt::CaseInsensitive) ||
-                    userBirthday.contains(term.trimmed(), Qt::CaseInsensitive)) {
-                    found = true; // Если совпадение найдено, устанавливаем флаг
-                    break; // Выходим из внутреннего цикла
-                }
-            }
-            // Логика для поиска по фамилии и имени вместе
-            QStringList nameParts = searchTerms.split(" ", Qt::SkipEmptyParts);
-            if (nameParts.size() >= 1) { // Проверяем, что введены хотя бы одна часть (фамилия или имя)
-                // Проверяем комбинацию фамилии и имени
-                if (lastName.contains(nameParts[0], Qt::CaseInsensitive)) {
-                    if (nameParts.size() == 2 && firstName.contains(nameParts[1], Qt::CaseInsensitive)) {
-                        found = true; // Если найдены обе части - устанавливаем флаг
-                    } else if (nameParts.size() == 1) {
-                        found = true; // Если только фамилия
-                    }
-                }
-            }
-            table->setRowHidden(i, !found); // Прячем строку, если совпадений нет
+    // Строку поиска очистили - снова показываем все контакты (в режиме экономии памяти - очищаем таблицу)
+    connect(liveSearch, &LiveSearch::cleared, this, [this, searchInDatabase, leaveBirthdays]() {
+        leaveBirthdays();
+        if (searchInDatabase) {
+            saveAddressBook();
+            model->setItems({});
+        } else {
+            model->clearFilter();
         }
+        statusBar()->clearMessage();
+        currentSearch.clear();
+    });
 
-        searchPerformed = true; // Устанавливаем флаг поиска в true
-    }
+    connect(liveSearch, &LiveSearch::failed, this, [this](const QString &errText) {
+        statusBar()->showMessage("Ошибка поиска: " + errText, 5000);
+    });
 }
 
 
@@ -353,267 +380,469 @@ void AddressBook::searchAddressBookItem() {
 
 
 void AddressBook::loadAddressBook() {
+    // Соединение с БД открыто в конструкторе, оно же создало таблицу. Загрузка уже идёт - второй раз не запускаем.
+    if (!storage.isOpen() || loaderThread) return;
 
-    /*
- * **************************************
- * Выполняем подключение к базе данных
- * **************************************
-*/
-    QSqlDatabase db;
-    db = QSqlDatabase::addDatabase("QSQLITE");
-    db.setDatabaseName("C:/sqlite_db/address_book.db");
-
-    if (!db.open()) {
-        QMessageBox::critical(this, "Ошибка!", "Ошибка подключения к БД: " + db.lastError().text());
+    // В режиме экономии памяти книгу не загружаем, контакты попадают в таблицу только через поиск
+    if (lowMemoryMode && storage.hasFullTextSearch()) {
+        statusBar()->showMessage("Режим экономии памяти: воспользуйтесь поиском, чтобы показать контакты");
         return;
     }
 
     /*
-     * Всегда пытаемся создать таблицу. Если она создана, то просто уведомим пользователя что таблицам найдена.
-     * Конечно же в реальной программе нам не нужно будет об этом сообщать пользователю.
+     * Книгу читаем не в GUI-потоке: загрузчик переносится в отдельный поток и присылает страницы
+     * по user_id. Первая страница приходит почти сразу, окно показывается не дожидаясь остальных.
      */
-    QSqlQuery query;
-    QString queryStr = "CREATE TABLE address_book (user_id INTEGER PRIMARY KEY, lastname VARCHAR(80), "
-                       "firstname VARCHAR(80), patronymic VARCHAR(80), "
-                       "phone_list VARCHAR(120), email VARCHAR(80), birthday VARCHAR(30));";
-    bool ret = query.exec(queryStr);
-    if (!ret) {
-        QString errText = query.lastError().text();
-        QRegularExpression nameRegex("already exists");
-        if (nameRegex.match(errText).hasMatch()) {
-            QMessageBox::information(this, "Внимание!", "Таблица контактов в БД найдена.");
-        } else {
-            QMessageBox::critical(this, "Ошибка!", "Ошибка создания таблицы адресной книги в БД.");
-            return;
+    loaderThread = new QThread(this);
+    AddressBookLoader *loader = new AddressBookLoader(storage.databasePath());
+    loader->moveToThread(loaderThread);
+
+    connect(loaderThread, &QThread::started, loader, &AddressBookLoader::load);
+
+    // Страницы приходят в GUI-поток через очередь событий и дописываются в конец модели
+    connect(loader, &AddressBookLoader::pageLoaded, this, [this](const QVector<Item> &page) {
+        model->appendLoadedItems(page);
+        statusBar()->showMessage(QString("Загружено контактов: %1").arg(model->contactCount()));
+    });
+
+    connect(loader, &AddressBookLoader::finished, this, [this](int totalRows, qint64 changeSeq) {
+        // Сколько памяти на контакт занимает сама книга (без индекса поиска)
+        int count = model->contactCount();
+        qsizetype bytesPerContact = count > 0 ? model->memoryUsage() / count : 0;
+        Trace::gauge("model.bytes", model->memoryUsage());
+        statusBar()->showMessage(QString("Загрузка завершена, контактов: %1 (%2 байт на контакт)").arg(totalRows).arg(bytesPerContact), 5000);
+
+        // Страницы приходили по user_id, поэтому если пользователь уже выбрал сортировку, применяем её ещё раз
+        QHeaderView *header = table->horizontalHeader();
+        if (header->isSortIndicatorShown()) {
+            model->sort(header->sortIndicatorSection(), header->sortIndicatorOrder());
         }
-    }
 
-    /*******************************************************************************************************/
-    /*  Тестовый код для вставки в базу нового контакта
-    После тестирования нужно будет этот код закомментировать, так как добавление будет через интерфейс */
-    /*******************************************************************************************************/
-    /*
-    QSqlQuery qry;
-    qry.prepare("INSERT INTO address_book (lastname, firstname, patronymic, phone_list, email, birthday) "
-                "VALUES (:lastname, :firstname, :patronymic, :phone_list, :email, :birthday)");
-    qry.bindValue(":lastname", "Vinogradova");
-    qry.bindValue(":firstname", "Diana");
-    qry.bindValue(":patronymic", "Nikolaevna");
-    qry.bindValue(":phone_list", "+79219991999");
-    qry.bindValue(":email", "diana.vinogradova@gmail.com");
-    qry.bindValue(":birthday", "13-07-2003");
-
-    ret = qry.exec();
-    if (!ret) {
-        QString errText = qry.lastError().text();
-        QMessageBox::critical(this, "Ошибка БД", "Ошибка добавления тестой записи в таблицу БД: " + errText);
-        return;
-    }
-    */
-    /*******************************************************************************************************/
+        // Дальше книга только дочитывает то, что изменили другие, начиная с изменения, бывшего до загрузки
+        changeWatcher->start(changeSeq);
+    });
 
+    connect(loader, &AddressBookLoader::failed, this, [this](const QString &errText) {
+        QMessageBox::critical(this, "Ошибка!", errText);
+    });
 
-    //Выполняется запрос для извлечения данных из таблицы address_book и отображения их в интерфейсе
-    if (!query.exec("SELECT * FROM address_book")) {
-        QString errText = query.lastError().text();
-        QMessageBox::critical(this, "Ошибка!", "Ошибка запроса к таблице в БД: " + errText);
-        return;
-    }
-    QSqlRecord rec = query.record();
-    while (query.next()) {
-        Item item;
+    // Как только загрузка закончилась (успешно или нет), поток и загрузчик больше не нужны
+    connect(loader, &AddressBookLoader::finished, loaderThread, &QThread::quit);
+    connect(loader, &AddressBookLoader::failed, loaderThread, &QThread::quit);
+    connect(loaderThread, &QThread::finished, loader, &QObject::deleteLater);
+    connect(loaderThread, &QThread::finished, loaderThread, &QObject::deleteLater);
 
-        item.userId = query.value(rec.indexOf("user_id")).toString();
-        item.userLastName = query.value(rec.indexOf("lastname")).toString();
-        item.userFirstName = query.value(rec.indexOf("firstname")).toString();
-        item.userPatronymicName = query.value(rec.indexOf("patronymic")).toString();
-        item.userEmail = query.value(rec.indexOf("email")).toString();
-        item.userBirthday = query.value(rec.indexOf("birthday")).toString();
-
-        QStringList userPhonesArrayString = query.value(rec.indexOf("phone_list")).toString().split(",", Qt::SkipEmptyParts);
-        item.userPhonesList = userPhonesArrayString.toVector();
-
-        QString key = item.userLastName + " " + item.userFirstName + " " + item.userPatronymicName;
-        items[key] = item;
-
-        int row = table->rowCount();
-        table->insertRow(row);
-        table->setItem(row, 0, new QTableWidgetItem(item.userId));
-        table->setItem(row, 1, new QTableWidgetItem(item.userLastName));
-        table->setItem(row, 2, new QTableWidgetItem(item.userFirstName));
-        table->setItem(row, 3, new QTableWidgetItem(item.userPatronymicName));
-        table->setItem(row, 4, new QTableWidgetItem(userPhonesArrayString.join(", ")));
-        table->setItem(row, 5, new QTableWidgetItem(item.userEmail));
-        table->setItem(row, 6, new QTableWidgetItem(item.userBirthday));
+    loaderThread->start();
+}
+
+
+bool AddressBook::loadSnapshot() {
+    TraceScope trace("load.snapshot");
+
+    ContactSnapshot snapshot;
+    if (!snapshot.open(ContactSnapshot::pathFor(storage.databasePath()))) {
+        qInfo().noquote() << snapshot.lastError();
+        return false;
     }
-    db.close();
-    return;
 
-    // Тут начинается чтение из файла. Когда переключим на работу с БД, нужно будет закомментировать этот код
+    // Сверка с БД: снимок записан из неё (тот же id) и не новее её журнала
+    StorageReply reply = storage.lastChange().result();
+    if (!reply.ok || snapshot.snapshotId().toString(QUuid::WithoutBraces) != reply.snapshotId
+        || snapshot.changeSeq() > reply.changeSeq) {
+        qInfo().noquote() << "Снимок книги не от этой БД, книга читается из БД";
+        return false;
+    }
 
-    QFile file("contacts.txt");
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
-        return;
+    ContactStore contacts;
+    if (!snapshot.read(contacts)) {
+        qInfo().noquote() << snapshot.lastError();
+        return false;
+    }
+    const qint64 changeSeq = snapshot.changeSeq();
+    snapshot.close();
 
-    items.clear();
-    table->setRowCount(0);
+    model->setContacts(contacts);
+    Trace::gauge("model.bytes", model->memoryUsage());
 
-    QTextStream in(&file);
-    while (!in.atEnd()) {
-        QString line = in.readLine();
-        QStringList fields = line.split("|");
-        if (fields.size() < 6) continue;
+    // Если после снимка БД меняли, изменения дочитываются из журнала, а не всей книгой
+    changeWatcher->start(changeSeq);
+    statusBar()->showMessage(QString("Книга открыта из снимка, контактов: %1%2").arg(model->contactCount())
+                             .arg(changeSeq < reply.changeSeq ? QString(", дочитываются изменения из БД") : QString()), 5000);
+    return true;
+}
 
-        Item item;
-        item.userLastName = fields[0].trimmed();
-        item.userFirstName = fields[1].trimmed();
-        item.userPatronymicName = fields[2].trimmed();
-        item.userEmail = fields[4].trimmed();
-        item.userBirthday = fields[5].trimmed();
-
-        // Преобразуем номера телефонов из строки в QVector
-        QStringList userPhonesListList = fields[3].split(",", Qt::SkipEmptyParts);
-        item.userPhonesList = userPhonesListList.toVector();
+void AddressBook::writeSnapshot() {
+    // Снимок - это БД на момент изменения журнала, до которого дочитала модель: в нём не должно быть
+    // несохранённых правок и недочитанной книги
+    if (lowMemoryMode || loaderThread || !changeWatcher->isActive() || !writeQueue->isIdle()) return;
 
-        QString key = item.userLastName + " " + item.userFirstName + " " + item.userPatronymicName;
-        items[key] = item;
-
-        int row = table->rowCount();
-        table->insertRow(row);
-        table->setItem(row, 0, new QTableWidgetItem(item.userLastName));
-        table->setItem(row, 1, new QTableWidgetItem(item.userFirstName));
-        table->setItem(row, 2, new QTableWidgetItem(item.userPatronymicName));
-        table->setItem(row, 3, new QTableWidgetItem(userPhonesListList.join(", "))); // Отображаем все номера
-        table->setItem(row, 4, new QTableWidgetItem(item.userEmail));
-        table->setItem(row, 5, new QTableWidgetItem(item.userBirthday));
+    // Новый id сначала попадает в БД: копия БД, снятая раньше, или БД, созданная заново, со снимком не совпадёт
+    const QUuid snapshotId = QUuid::createUuid();
+    StorageReply reply = storage.setSnapshotId(snapshotId.toString(QUuid::WithoutBraces)).result();
+    if (!reply.ok) {
+        qWarning().noquote() << reply.errorText;
+        return;
     }
 
-    file.close();
+    QString errText;
+    if (!ContactSnapshot::write(ContactSnapshot::pathFor(storage.databasePath()), model->searchSnapshot().contacts,
+                                changeWatcher->lastChangeSeq(), snapshotId, errText)) {
+        qWarning().noquote() << errText;
+    }
 }
 
+void AddressBook::closeEvent(QCloseEvent *event) {
+    if (snapshotCache && !flushedBeforeClose && !writeQueue->isIdle()) {
+        flushedBeforeClose = true;
+        event->ignore();
+        writeQueue->whenFlushed([this]() { close(); });
+        return;
+    }
+    QMainWindow::closeEvent(event);
+}
 
 void AddressBook::saveAddressBook() {
+    if (!storage.isOpen()) return;
 
-    /*
-     * **************************************
-     * Выполняем подключение к базе данных
-     * **************************************
-    */
-    QSqlDatabase db;
-    db = QSqlDatabase::addDatabase("QSQLITE");
-    db.setDatabaseName("C:/sqlite_db/address_book.db");
-
-    if (!db.open()) {
-        QMessageBox::critical(this, "Ошибка!", "Ошибка подключения к БД: " + db.lastError().text());
+    // Накопленные правки уходят одной транзакцией сейчас, не дожидаясь порогов очереди
+    writeQueue->flush();
+}
+
+void AddressBook::addPhoneNumber() {
+    int currentRow = table->currentIndex().row();
+    if (currentRow < 0) {
+        QMessageBox::warning(this, "Ошибка", "Выберите контакт для добавления номера.");
         return;
     }
 
-    /*
-     * Понимаю, что при работе с БД мы могли бы и не удалять ВСЕ данные из таблицы, чтобы снова их добавить.
-     * Гораздо правильнее было бы просто в момент изменения менять конкретные строчки таблицы, обновляя их
-     * по уникальным идентификаторам в таблице, но текущий вариант сделать быстрее, так как нужно было
-     * всего лишь поменять два метода, load и save.
-     */
+    QString newNumber = QInputDialog::getText(this, "Добавить номер телефона", "Введите номер телефона (+7XXXXXXXXXX или 8XXXXXXXXXX):").trimmed();
 
-    QSqlQuery query;
-    QString queryStr = "DELETE FROM address_book;";
-    bool ret = query.exec(queryStr);
-    if (!ret) {
-        QString errText = query.lastError().text();
-        QMessageBox::critical(this, "Ошибка!", "Ошибка очистики таблицы в БД: " + errText);
+    // Проверка формата номера - те же правила, что и в диалогах
+    if (!ItemValidator::isValidPhone(newNumber)) {
+        QMessageBox::warning(this, "Ошибка", ItemValidator::message(ItemValidator::Phones));
         return;
     }
 
-    for (const auto &item : items) {
-        // Вытащим из векторного массива все номера телефонов
-        QStringList userPhonesListList = QStringList::fromVector(item.userPhonesList);
-
-        QSqlQuery qry;
-        qry.prepare("INSERT INTO address_book (user_id, lastname, firstname, patronymic, phone_list, email, birthday) "
-                    "VALUES (NULL, :lastname, :firstname, :patronymic, :phone_list, :email, :birthday)");
-        qry.bindValue(":lastname", item.userLastName);
-        qry.bindValue(":firstname", item.userFirstName);
-        qry.bindValue(":patronymic", item.userPatronymicName);
-        qry.bindValue(":phone_list", userPhonesListList.join(",")); // В БД добавляем номера разделяя их запятыми
-        qry.bindValue(":email", item.userEmail);
-        qry.bindValue(":birthday", item.userBirthday);
-
-        ret = qry.exec();
-        if (!ret) {
-            QString errText = qry.lastError().text();
-            QMessageBox::critical(this, "Ошибка БД", "Ошибка добавления записи в таблицу БД: " + errText);
+    Item item = model->item(currentRow);
+
+    if (item.userPhonesList.size() >= 100) {
+        QMessageBox::warning(this, "Ошибка", "Нельзя добавить больше 100 номеров.");
+        return;
+    }
+
+    /*
+     * Номер добавляем, когда поток БД ответит, кому он уже принадлежит. К этому времени
+     * таблица могла измениться, поэтому контакт потом ищем заново: по user_id, а у ещё
+     * не сохранённого - по слоту.
+     */
+    int slot = model->slotAt(currentRow);
+    auto addNumber = [this, slot, item, newNumber]() {
+        int itemSlot = item.userId.isEmpty() ? slot : model->slotOfId(item.userId.toLongLong());
+        int row = itemSlot < 0 ? -1 : model->rowOfSlot(itemSlot);
+        if (row < 0) {
+            QMessageBox::warning(this, "Ошибка", "Контакт удалён или скрыт, номер не добавлен.");
             return;
         }
-    }
-    db.close();
 
-    return;
+        Item updated = model->itemAt(itemSlot);
+        updated.userPhonesList.append(newNumber);
+
+        // Обновляем отображение в таблице
+        model->updateItem(row, updated);
+
+        /*
+         * Контакт сохранится обычным updateItem вместе с другими правками очереди: строка address_book
+         * (phone_list, phone_tokens, версия) и её запись в FTS переписываются целиком. Дешевле только таблица
+         * phone - в неё пишется разница, то есть одна вставка.
+         */
+        writeQueue->changed();
 
-    // Далее начинается сохранение в файл.
+        QMessageBox::information(this, "Успех", "Номер телефона успешно добавлен!");
+    };
 
-    QFile file("C:/projects/course/contacts.txt");
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        QMessageBox::warning(this, "Ошибка", "Не удалось открыть файл для записи.");
+    if (!storage.isOpen()) {
+        addNumber();
         return;
     }
 
-    QTextStream out(&file);
-    for (const auto &item : items) {
-        out << item.userLastName << "|"
-            << item.userFirstName << "|"
-            << item.userPatronymicName << "|";
+    /*
+     * Кому уже принадлежит этот номер - запрос по индексу таблицы phone, без просмотра книги.
+     * Сначала дописываем накопленные правки: запрос встанет в очередь БД после них и увидит номера,
+     * добавленные только что.
+     */
+    writeQueue->whenFlushed([this, item, newNumber, addNumber]() {
+        storage.findPhoneOwners(PhoneNumber::toE164(newNumber)).then(this, [this, item, addNumber](const StorageReply &reply) {
+            const QVector<QString> &owners = reply.userIds;
+            if (reply.ok && !owners.isEmpty()) {
+                if (owners.contains(item.userId)) {
+                    QMessageBox::warning(this, "Ошибка", "У этого контакта уже есть такой номер.");
+                    return;
+                }
+                // Владельцев находим в модели по user_id, без поиска по таблице
+                QStringList ownerNames;
+                for (const QString &ownerId : owners) {
+                    int ownerSlot = model->slotOfId(ownerId.toLongLong());
+                    if (ownerSlot < 0) {
+                        ownerNames.append("#" + ownerId);
+                        continue;
+                    }
+                    Item owner = model->itemAt(ownerSlot);
+                    ownerNames.append(QString("#%1 (%2 %3)").arg(ownerId, owner.userLastName, owner.userFirstName));
+                }
+                QMessageBox::StandardButton answer = QMessageBox::question(this, "Внимание!",
+                    "Этот номер уже записан у контакта " + ownerNames.join(", ") + ". Всё равно добавить?");
+                if (answer != QMessageBox::Yes) return;
+            }
+            addNumber();
+        });
+    });
+}
+
 
-        // Объединяем номера телефонов через запятую
-        QStringList userPhonesListList = QStringList::fromVector(item.userPhonesList);
-        out << userPhonesListList.join(",") << "|";
 
-        out << item.userEmail << "|"
-            << item.userBirthday << "\n";
+void AddressBook::importAddressBook() {
+    if (!storage.isOpen()) {
+        QMessageBox::warning(this, "Ошибка", "Нет соединения с БД.");
+        return;
+    }
+    if (importThread) {
+        QMessageBox::information(this, "Импорт", "Импорт уже идёт.");
+        return;
     }
 
-    file.close();
+    QString fileName = QFileDialog::getOpenFileName(this, "Импорт контактов", QString(),
+                                                    "Контакты (*.csv *.vcf *.txt);;CSV (*.csv);;vCard (*.vcf);;Все файлы (*)");
+    if (fileName.isEmpty()) return;
+
+    // Несохранённые правки пишем до импорта, чтобы они не смешались с его транзакциями
+    writeQueue->whenFlushed([this, fileName]() { startImport(fileName); });
 }
 
-void AddressBook::addPhoneNumber() {
-    int currentRow = table->currentRow();
-    if (currentRow < 0) {
-        QMessageBox::warning(this, "Ошибка", "Выберите контакт для добавления номера.");
-        return;
-    }
+void AddressBook::startImport(const QString &fileName) {
+    if (importThread) return;
+    importErrors.clear();
 
-    QString newNumber = QInputDialog::getText(this, "Добавить номер телефона", "Введите номер телефона (+7XXXXXXXXXX):").trimmed();
+    importThread = new QThread(this);
+    AddressBookImporter *importer = new AddressBookImporter(storage.databasePath(), fileName);
+    importer->moveToThread(importThread);
 
-    // Проверка формата номера
-    QRegularExpression phoneRegex("^\\+7\\d{10}$");
-    if (!phoneRegex.match(newNumber).hasMatch()) {
-        QMessageBox::warning(this, "Ошибка", "Телефон должен быть в формате +7XXXXXXXXXX.");
-        return;
-    }
+    connect(importThread, &QThread::started, importer, &AddressBookImporter::import);
+
+    // Записанные в БД контакты сразу появляются в таблице. В режиме экономии памяти их покажет поиск.
+    connect(importer, &AddressBookImporter::batchImported, this, [this](const QVector<Item> &items) {
+        if (!(lowMemoryMode && storage.hasFullTextSearch())) model->appendLoadedItems(items);
+    });
+
+    connect(importer, &AddressBookImporter::rowErrors, this, [this](const QStringList &errors) {
+        for (const QString &error : errors) {
+            if (importErrors.size() >= MaxShownImportErrors) break;
+            importErrors.append(error);
+        }
+    });
+
+    connect(importer, &AddressBookImporter::progress, this, [this](int rowsRead, int imported, int rejected) {
+        statusBar()->showMessage(QString("Импорт: прочитано %1, добавлено %2, с ошибками %3").arg(rowsRead).arg(imported).arg(rejected));
+    });
+
+    connect(importer, &AddressBookImporter::finished, this, [this](int imported, int rejected) {
+        statusBar()->showMessage(QString("Импорт завершён: добавлено %1, с ошибками %2").arg(imported).arg(rejected), 5000);
+        if (rejected > 0) {
+            QString details = importErrors.join("\n");
+            if (rejected > importErrors.size()) details += QString("\n... и ещё %1").arg(rejected - importErrors.size());
+            QMessageBox::warning(this, "Импорт", QString("Не импортировано записей: %1\n\n").arg(rejected) + details);
+        }
+    });
 
-    QString itemKey = table->item(currentRow, 0)->text() + " " +
-                      table->item(currentRow, 1)->text() + " " +
-                      table->item(currentRow, 2)->text();
+    connect(importer, &AddressBookImporter::failed, this, [this](const QString &errText) {
+        QMessageBox::critical(this, "Ошибка импорта!", errText);
+    });
 
-    if (!items.contains(itemKey)) {
-        QMessageBox::warning(this, "Ошибка", "Контакт не найден.");
+    connect(importer, &AddressBookImporter::finished, importThread, &QThread::quit);
+    connect(importer, &AddressBookImporter::failed, importThread, &QThread::quit);
+    connect(importThread, &QThread::finished, importer, &QObject::deleteLater);
+    connect(importThread, &QThread::finished, importThread, &QObject::deleteLater);
+
+    importThread->start();
+}
+
+void AddressBook::exportAddressBook() {
+    if (!storage.isOpen()) {
+        QMessageBox::warning(this, "Ошибка", "Нет соединения с БД.");
+        return;
+    }
+    if (exportThread) {
+        QMessageBox::information(this, "Экспорт", "Экспорт уже идёт.");
         return;
     }
 
-    Item &item = items[itemKey];
+    // Если сейчас показаны результаты поиска, можно выгрузить только их
+    QString query;
+    if (!currentSearch.isEmpty()) {
+        QMessageBox::StandardButton answer = QMessageBox::question(this, "Экспорт",
+            "Экспортировать только найденные контакты (\"" + currentSearch + "\")?",
+            QMessageBox::Yes | QMessageBox::No | QMessageBox::Cancel);
+        if (answer == QMessageBox::Cancel) return;
+        if (answer == QMessageBox::Yes) query = currentSearch;
+    }
 
-    if (item.userPhonesList.size() >= 100) {
-        QMessageBox::warning(this, "Ошибка", "Нельзя добавить больше 100 номеров.");
+    QString fileName = QFileDialog::getSaveFileName(this, "Экспорт контактов", "contacts.csv",
+                                                    "CSV (*.csv);;vCard (*.vcf);;JSON Lines (*.jsonl)");
+    if (fileName.isEmpty()) return;
+
+    // Экспорт читает БД своим соединением, поэтому запускаем его, когда несохранённые правки будут там
+    writeQueue->whenFlushed([this, fileName, query]() { startExport(fileName, query); });
+}
+
+void AddressBook::startExport(const QString &fileName, const QString &query) {
+    if (exportThread) return;
+
+    exportThread = new QThread(this);
+    AddressBookExporter *exporter = new AddressBookExporter(storage.databasePath(), fileName, query);
+    exporter->moveToThread(exportThread);
+
+    connect(exportThread, &QThread::started, exporter, &AddressBookExporter::exportItems);
+
+    connect(exporter, &AddressBookExporter::progress, this, [this](int rowsWritten) {
+        statusBar()->showMessage(QString("Экспорт: записано контактов %1").arg(rowsWritten));
+    });
+
+    connect(exporter, &AddressBookExporter::finished, this, [this](int rowsWritten) {
+        statusBar()->showMessage(QString("Экспорт завершён, записано контактов: %1").arg(rowsWritten), 5000);
+    });
+
+    connect(exporter, &AddressBookExporter::failed, this, [this](const QString &errText) {
+        QMessageBox::critical(this, "Ошибка экспорта!", errText);
+    });
+
+    connect(exporter, &AddressBookExporter::finished, exportThread, &QThread::quit);
+    connect(exporter, &AddressBookExporter::failed, exportThread, &QThread::quit);
+    connect(exportThread, &QThread::finished, exporter, &QObject::deleteLater);
+    connect(exportThread, &QThread::finished, exportThread, &QObject::deleteLater);
+
+    exportThread->start();
+}
+
+void AddressBook::findDuplicates() {
+    if (duplicateSearch.isRunning()) return;
+
+    // Повторы ищутся по книге в памяти; в режиме экономии памяти для этого есть addressbook-cli dedupe
+    if (lowMemoryMode && storage.hasFullTextSearch()) {
+        QMessageBox::information(this, "Повторы", "В режиме экономии памяти книга не загружена целиком.\n"
+                                 "Найти повторы можно командой addressbook-cli dedupe.");
+        return;
+    }
+    if (loaderThread) {
+        QMessageBox::information(this, "Повторы", "Книга ещё загружается, попробуйте, когда загрузка закончится.");
         return;
     }
 
-    item.userPhonesList.append(newNumber);
+    const ContactsModel::SearchSnapshot snapshot = model->searchSnapshot();
+    const ContactStore contacts = snapshot.contacts;
+    duplicatesButton->setEnabled(false);
+    statusBar()->showMessage("Поиск повторов...");
 
-    // Обновляем отображение в таблице
-    table->setItem(currentRow, 3, new QTableWidgetItem(QStringList::fromVector(item.userPhonesList).join(", "))); // Отображаем все номера
+    duplicateSearch = QtConcurrent::run([contacts](QPromise<QVector<DuplicateFinder::Group>> &promise) {
+        QVector<DuplicateFinder::Group> groups = DuplicateFinder(contacts).find([&promise]() { return promise.isCanceled(); });
+        if (!promise.isCanceled()) promise.addResult(groups);
+    });
 
-    saveAddressBook();
+    const quint64 contentRevision = snapshot.contentRevision;
+    duplicateSearch.then(this, [this, contacts, contentRevision](const QVector<DuplicateFinder::Group> &groups) {
+        duplicatesButton->setEnabled(true);
+        statusBar()->clearMessage();
+
+        if (groups.isEmpty()) {
+            QMessageBox::information(this, "Повторы", "Повторов не найдено.");
+            return;
+        }
+
+        // Каждая группа - отдельный пункт: пользователь снимает отметку с тех, что сливать не нужно
+        QDialog dialog(this);
+        dialog.setWindowTitle("Повторы");
+        QVBoxLayout *layout = new QVBoxLayout(&dialog);
+        layout->addWidget(new QLabel(QString("Найдено групп повторов: %1. Отмеченные группы будут объединены в одну запись каждая.")
+                                         .arg(groups.size()), &dialog));
+
+        QListWidget *groupList = new QListWidget(&dialog);
+        for (const DuplicateFinder::Group &group : groups) {
+            QStringList names;
+            for (int slot : group.slotList) {
+                names.append(QString("%1 %2 %3").arg(contacts.lastName(slot), contacts.firstName(slot), contacts.patronymic(slot)).simplified());
+            }
+            QListWidgetItem *entry = new QListWidgetItem(QString("[%1] ").arg(group.score) + names.join(" = "), groupList);
+            entry->setFlags(entry->flags() | Qt::ItemIsUserCheckable);
+            entry->setCheckState(Qt::Checked);
+        }
+        layout->addWidget(groupList);
+
+        QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+        buttons->button(QDialogButtonBox::Ok)->setText("Объединить отмеченные");
+        connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+        connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+        layout->addWidget(buttons);
+        dialog.resize(640, 480);
+        if (dialog.exec() != QDialog::Accepted) return;
+
+        // Пока пользователь смотрел на список, книгу могли изменить: слоты снимка уже не те
+        if (model->contentRevision() != contentRevision) {
+            QMessageBox::warning(this, "Повторы", "Книга изменилась, пока шёл поиск. Запустите поиск повторов ещё раз.");
+            return;
+        }
 
-    QMessageBox::information(this, "Успех", "Номер телефона успешно добавлен!");
+        QVector<int> keepers;
+        QVector<Item> merged;
+        QVector<int> removedSlots;
+        for (int i = 0; i < groups.size(); ++i) {
+            if (groupList->item(i)->checkState() != Qt::Checked) continue;
+            const DuplicateFinder::Group &group = groups[i];
+            keepers.append(group.slotList.first());
+            merged.append(group.merged);
+            removedSlots += group.slotList.mid(1);
+        }
+        if (keepers.isEmpty()) return;
+
+        model->applyEdits(keepers, merged, removedSlots);
+        writeQueue->changed(keepers.size() + removedSlots.size());
+        saveAddressBook();
+        statusBar()->showMessage(QString("Объединено повторов: %1").arg(removedSlots.size()), 5000);
+    });
 }
 
+void AddressBook::showUpcomingBirthdays(bool checked) {
+    if (!checked) {
+        // Снова показываем то, что было до напоминаний: найденное строкой поиска или всю книгу
+        liveSearch->setQuery(searchInput->text());
+        return;
+    }
+
+    const QDate today = QDate::currentDate();
+    auto showMessage = [this, today](int count) {
+        statusBar()->showMessage(QString("Дни рождения с %1 по %2: %3")
+                                 .arg(today.toString("dd-MM-yyyy"), today.addDays(UpcomingBirthdayDays - 1).toString("dd-MM-yyyy"))
+                                 .arg(count));
+    };
+
+    // В режиме экономии памяти спрашиваем БД по индексу дат, когда все правки уже записаны
+    if (lowMemoryMode && storage.hasFullTextSearch()) {
+        writeQueue->whenFlushed([this, today, showMessage]() {
+            storage.upcomingBirthdays(today, UpcomingBirthdayDays).then(this, [this, showMessage](const StorageReply &reply) {
+                if (!birthdaysButton->isChecked()) return;
+                if (!reply.ok) {
+                    statusBar()->showMessage("Ошибка запроса дней рождения: " + reply.errorText, 5000);
+                    return;
+                }
+                model->setItems(reply.items);
+                showMessage(reply.items.size());
+            });
+        });
+        return;
+    }
 
+    // Слоты уже идут по дате дня рождения, так и показываем
+    QVector<int> slotList;
+    for (const BirthdayIndex::Upcoming &upcoming : model->upcomingBirthdays(today, UpcomingBirthdayDays)) {
+        slotList.append(upcoming.slot);
+    }
+    model->setFilter(slotList, true);
+    showMessage(slotList.size());
+}
@@ -2,8 +2,10 @@
 #define ADDRESSBOOK_H
 
 #include <QMainWindow>
-#include <QTableWidget>
+#include <QTableView>
 #include <QPushButton>
+#include <QLineEdit>
+#include <QCheckBox>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QMessageBox>
@@ -14,25 +16,38 @@
 #include <QFile>
 
 #include "UI_Dialogs.h"
-
-struct Item {
-    QString userId;
-    QString userLastName;
-    QString userFirstName;
-    QString userPatronymicName;
-    QString userEmail;
-    QString userBirthday;
-    QVector<QString> userPhonesList;
-};
+#include "Item.hpp"
+#include "ContactsModel.hpp"
+#include "AsyncStorage.hpp"
+#include "WriteQueue.hpp"
+#include "ChangeWatcher.hpp"
+#include "EventLoopMonitor.hpp"
+#include "LiveSearch.hpp"
+#include "DuplicateFinder.hpp"
+#include "AddressBookLoader.hpp"
+#include "AddressBookImporter.hpp"
+#include "AddressBookExporter.hpp"
+#include <QFuture>
+#include <QPointer>
+#include <QThread>
+#include <functional>
 
 
 class AddressBook : public QMainWindow {
     Q_OBJECT
 
 public:
-    AddressBook(QWidget *parent = nullptr);
+    // lowMemoryMode: книга целиком в память не загружается, в таблице только результаты поиска в БД (FTS5)
+    // durability - когда правки записываются в БД (см. WriteQueue)
+    // snapshotCache: открывать книгу из снимка на диске (ContactSnapshot) и обновлять снимок при выходе
+    AddressBook(QWidget *parent = nullptr, bool lowMemoryMode = false,
+                WriteQueue::Durability durability = WriteQueue::Durability::Grouped, bool snapshotCache = false);
     ~AddressBook();
 
+protected:
+    // Со снимком окно закрывается, когда дописаны все правки: снимок пишется только без несохранённого
+    void closeEvent(QCloseEvent *event) override;
+
 // Объявляем список слотов
 private slots:
     // Слот для добавления нового айтема в книгу
@@ -44,10 +59,7 @@ private slots:
     // Слот для удаления айтема из книги
     void delAddressBookItem();
 
-    // Слот для поиска айтема в книге
-    void searchAddressBookItem();
-
-    // Слот для загрузки данных в память (потом нужно будет решение для загрузки из файла или из базы)
+    // Слот для загрузки данных в память. Загрузка идёт в фоне, страницами по user_id.
     void loadAddressBook();
 
     // Слот для сохрнения айтемов книги (в файл или в БД)
@@ -56,21 +68,99 @@ private slots:
     // Добавление нового номера телефона
     void addPhoneNumber();
 
+    // Импорт контактов из файла (CSV, vCard, старый формат "|"). Идёт в фоне, порциями.
+    void importAddressBook();
+
+    // Экспорт книги (или только найденного) в CSV, vCard или JSON Lines. Идёт в фоне, прямо из БД.
+    void exportAddressBook();
+
+    // Поиск повторов по всей книге (в фоне, по снимку модели) и их слияние
+    void findDuplicates();
+
+    // Напоминания: показать только контакты с днём рождения в ближайшие дни (checked = false - снова всё)
+    void showUpcomingBirthdays(bool checked);
+
 private:
-    // Виджет нужен для табличного отображения данных
-    QTableWidget *table;
+    // Представление для табличного отображения данных
+    QTableView *table;
+
+    // Модель с контактами, таблица берёт из неё только видимые строки
+    ContactsModel *model;
+
+    // Сессия БД в отдельном потоке: запросы уходят туда, ответы приходят через QFuture
+    AsyncStorage storage;
+
+    // Когда и какими группами правки уходят в БД. Импорт и экспорт читают БД своими соединениями,
+    // поэтому запускаются через whenFlushed, когда все правки уже записаны.
+    WriteQueue *writeQueue;
+
+    // Правки, сделанные в ту же БД из других окон, попадают в таблицу без перезагрузки книги
+    ChangeWatcher *changeWatcher;
+
+    // Замер задержек цикла событий GUI
+    EventLoopMonitor *eventLoopMonitor;
+
+    // Режим экономии памяти: поиск идёт в БД, в модели только страница найденного
+    bool lowMemoryMode;
+
+    // Книга открывается из снимка на диске, если он есть и он от этой БД
+    bool snapshotCache;
+
+    // Закрытие уже ждало записи правок (второй раз не ждём, даже если запись не удалась)
+    bool flushedBeforeClose = false;
+
+    // Сколько найденных контактов показывать в режиме экономии памяти
+    static constexpr int SearchResultPageSize = 1000;
+
+    // За сколько дней вперёд показывать дни рождения
+    static constexpr int UpcomingBirthdayDays = 14;
+
+    // Поток фоновой загрузки книги (живёт, пока загрузка не закончится)
+    QPointer<QThread> loaderThread;
+
+    // Поток импорта из файла (живёт, пока импорт не закончится)
+    QPointer<QThread> importThread;
+
+    // Первые ошибки импорта, показываются по окончании
+    QStringList importErrors;
+    static constexpr int MaxShownImportErrors = 20;
+
+    // Поток экспорта в файл
+    QPointer<QThread> exportThread;
+
+    // Идущий поиск повторов
+    QFuture<QVector<DuplicateFinder::Group>> duplicateSearch;
+
+    // Запрос текущего поиска (пусто, если показаны все контакты)
+    QString currentSearch;
+
+    LiveSearch *liveSearch;
 
     QPushButton *addButton;
     QPushButton *editButton;
     QPushButton *deleteButton;
-    QPushButton *searchButton;
+    QLineEdit *searchInput;
+    QCheckBox *fuzzySearchBox;
     QPushButton *loadButton;
     QPushButton *addPhoneNumberButton;
-
-    // Можно было бы заюзать и QHash, но в QMap у нас будет сортировка.
-    QMap<QString, Item> items;
+    QPushButton *importButton;
+    QPushButton *exportButton;
+    QPushButton *duplicatesButton;
+    QPushButton *birthdaysButton;
 
     void setupUI();
+
+    // Поиск по мере ввода в строке поиска (нужна открытая БД, чтобы выбрать, где искать)
+    void setupSearch();
+
+    // Открыть книгу из снимка; false - снимка нет или он не подходит, книга читается из БД
+    bool loadSnapshot();
+
+    // Записать снимок книги (если всё записано в БД и книга загружена целиком)
+    void writeSnapshot();
+
+    void startImport(const QString &fileName);
+    void startExport(const QString &fileName, const QString &query);
 };
 
 #endif // ADDRESSBOOK_H
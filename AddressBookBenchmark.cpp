@@ -0,0 +1,511 @@
+#include "AddressBookBenchmark.hpp"
+#include "AddressBookLoader.hpp"
+#include "AddressBookStorage.hpp"
+#include "AsyncStorage.hpp"
+#include "ContactScanner.hpp"
+#include "DuplicateFinder.hpp"
+#include "WriteQueue.hpp"
+#include "ChangeWatcher.hpp"
+#include "ContactSnapshot.hpp"
+#include "ContactsModel.hpp"
+#include <QCoreApplication>
+#include <QDate>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QJsonObject>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+const QStringList LastNames = {
+    "Иванов", "Смирнов", "Кузнецов", "Попов", "Васильев", "Петров", "Соколов", "Михайлов", "Новиков", "Фёдоров",
+    "Морозов", "Волков", "Алексеев", "Лебедев", "Семёнов", "Егоров", "Павлов", "Козлов", "Степанов", "Николаев",
+    "Орлов", "Андреев", "Макаров", "Никитин", "Захаров", "Зайцев", "Соловьёв", "Борисов", "Яковлев", "Григорьев",
+    "Романов", "Воробьёв", "Сергеев", "Кузьмин", "Фролов", "Александров", "Дмитриев", "Королёв", "Гусев", "Киселёв"
+};
+
+const QStringList FirstNames = {
+    "Александр", "Сергей", "Дмитрий", "Андрей", "Алексей", "Максим", "Евгений", "Иван", "Михаил", "Артём",
+    "Николай", "Владимир", "Павел", "Роман", "Олег", "Игорь", "Денис", "Виктор", "Юрий", "Антон"
+};
+
+const QStringList Patronymics = {
+    "Александрович", "Сергеевич", "Дмитриевич", "Андреевич", "Алексеевич", "Максимович", "Евгеньевич",
+    "Иванович", "Михайлович", "Николаевич", "Владимирович", "Павлович", "Романович", "Олегович", "Игоревич"
+};
+
+// Окно напоминаний о днях рождения, как в окне книги
+constexpr int BirthdayWindowDays = 14;
+
+qint64 elapsedMicros(const QElapsedTimer &timer) {
+    return timer.nsecsElapsed() / 1000;
+}
+
+}
+
+AddressBookBenchmark::AddressBookBenchmark(const Options &options) : options(options), random(options.seed) {
+}
+
+QString AddressBookBenchmark::lastError() const {
+    return errorText;
+}
+
+QJsonDocument AddressBookBenchmark::results() const {
+    QJsonObject root;
+    root["format"] = 1;
+    root["qt"] = QString(qVersion());
+    root["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    root["seed"] = qint64(options.seed);
+    root["results"] = metrics;
+    return QJsonDocument(root);
+}
+
+bool AddressBookBenchmark::run() {
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        errorText = "Не удалось создать временный каталог: " + dir.errorString();
+        return false;
+    }
+
+    for (int size : options.sizes) {
+        // Каждый размер начинается с одной и той же последовательности случайных чисел
+        random.seed(options.seed);
+        if (!runSize(size, dir.filePath(QString("bench_%1.db").arg(size)))) return false;
+    }
+    return true;
+}
+
+Item AddressBookBenchmark::randomItem() {
+    Item item;
+    item.userLastName = LastNames[random.bounded(LastNames.size())];
+    item.userFirstName = FirstNames[random.bounded(FirstNames.size())];
+    item.userPatronymicName = Patronymics[random.bounded(Patronymics.size())];
+
+    int phoneCount = 1 + random.bounded(3);
+    for (int i = 0; i < phoneCount; ++i) {
+        item.userPhonesList.append(QString("+79%1").arg(random.bounded(1000000000), 9, 10, QChar('0')));
+    }
+
+    item.userEmail = QString("user%1@example.com").arg(random.bounded(100000000));
+    QDate birthday = QDate(1950, 1, 1).addDays(random.bounded(20000));
+    item.userBirthday = birthday.toString("dd-MM-yyyy");
+    item.state = ItemState::Added;
+    return item;
+}
+
+void AddressBookBenchmark::addMetric(int size, const QString &name, double value, const QString &unit) {
+    QJsonObject metric;
+    metric["contacts"] = size;
+    metric["name"] = name;
+    metric["value"] = value;
+    metric["unit"] = unit;
+    metrics.append(metric);
+
+    QTextStream(stderr) << size << "\t" << name << "\t" << value << " " << unit << "\n";
+}
+
+void AddressBookBenchmark::addLatency(int size, const QString &name, QVector<qint64> samples) {
+    if (samples.isEmpty()) return;
+    std::sort(samples.begin(), samples.end());
+
+    auto percentile = [&samples](double percent) {
+        int index = int(percent / 100.0 * (samples.size() - 1) + 0.5);
+        return double(samples[index]);
+    };
+    addMetric(size, name + "_p50", percentile(50), "us");
+    addMetric(size, name + "_p90", percentile(90), "us");
+    addMetric(size, name + "_p99", percentile(99), "us");
+    addMetric(size, name + "_max", double(samples.constLast()), "us");
+}
+
+bool AddressBookBenchmark::generate(const QString &databasePath, int size) {
+    AddressBookStorage storage("address_book_bench_generate");
+    if (!storage.open(databasePath)) {
+        errorText = storage.lastError();
+        return false;
+    }
+
+    // Порциями по транзакции, как это делает импорт
+    static constexpr int BatchSize = 10000;
+    for (int done = 0; done < size;) {
+        if (!storage.beginTransaction()) {
+            errorText = storage.lastError();
+            return false;
+        }
+        int batchEnd = std::min(size, done + BatchSize);
+        for (; done < batchEnd; ++done) {
+            QString userId;
+            if (!storage.insertItem(randomItem(), userId)) {
+                errorText = storage.lastError();
+                storage.rollback();
+                return false;
+            }
+        }
+        if (!storage.commit()) {
+            errorText = storage.lastError();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool AddressBookBenchmark::load(const QString &databasePath, ContactsModel &model) {
+    AddressBookLoader loader(databasePath);
+    bool ok = true;
+    QObject::connect(&loader, &AddressBookLoader::pageLoaded, [&model](const QVector<Item> &items) {
+        model.appendLoadedItems(items);
+    });
+    QObject::connect(&loader, &AddressBookLoader::failed, [this, &ok](const QString &errText) {
+        errorText = errText;
+        ok = false;
+    });
+    loader.load();
+    return ok;
+}
+
+bool AddressBookBenchmark::runSize(int size, const QString &databasePath) {
+    QElapsedTimer timer;
+
+    timer.start();
+    if (!generate(databasePath, size)) return false;
+    qint64 generateMicros = elapsedMicros(timer);
+    addMetric(size, "insert_total", generateMicros / 1000.0, "ms");
+    addMetric(size, "insert_rate", size * 1e6 / std::max<qint64>(generateMicros, 1), "rows/s");
+
+    /*
+     * Первая загрузка - свежее соединение с пустым кэшем страниц SQLite. Кэш файлов ОС
+     * отсюда не сбросить, поэтому "холодная" загрузка означает холодный процесс, а не холодный диск.
+     */
+    {
+        ContactsModel model;
+        timer.restart();
+        if (!load(databasePath, model)) return false;
+        addMetric(size, "load_cold", elapsedMicros(timer) / 1000.0, "ms");
+    }
+
+    ContactsModel model;
+    timer.restart();
+    if (!load(databasePath, model)) return false;
+    addMetric(size, "load_warm", elapsedMicros(timer) / 1000.0, "ms");
+    addMetric(size, "model_memory", double(model.memoryUsage()), "bytes");
+
+    if (model.contactCount() != size) {
+        errorText = QString("Загружено %1 контактов из %2").arg(model.contactCount()).arg(size);
+        return false;
+    }
+
+    /*
+     * Снимок книги на диске: запись и открытие (отображение файла, колонки целиком, модель без сборки Item).
+     * Индексы поиска после открытия строятся в фоне, их время - отдельно.
+     */
+    const QString snapshotPath = ContactSnapshot::pathFor(databasePath);
+    timer.restart();
+    if (!ContactSnapshot::write(snapshotPath, model.searchSnapshot().contacts, 0, QUuid::createUuid(), errorText)) return false;
+    addMetric(size, "snapshot_write", elapsedMicros(timer) / 1000.0, "ms");
+    {
+        ContactsModel snapshotModel;
+        timer.restart();
+        ContactSnapshot snapshot;
+        ContactStore contacts;
+        if (!snapshot.open(snapshotPath) || !snapshot.read(contacts)) {
+            errorText = snapshot.lastError();
+            return false;
+        }
+        snapshotModel.setContacts(contacts);
+        addMetric(size, "snapshot_load", elapsedMicros(timer) / 1000.0, "ms");
+
+        if (snapshotModel.contactCount() != size) {
+            errorText = QString("Из снимка прочитано %1 контактов из %2").arg(snapshotModel.contactCount()).arg(size);
+            return false;
+        }
+
+        QEventLoop loop;
+        QObject::connect(&snapshotModel, &ContactsModel::indexReady, &loop, &QEventLoop::quit);
+        if (!snapshotModel.isIndexReady()) loop.exec();
+        addMetric(size, "snapshot_index", elapsedMicros(timer) / 1000.0, "ms");
+    }
+
+    // Сортировка: первая по колонке строит её порядок, повторная берёт готовый
+    timer.restart();
+    model.sort(ContactsModel::BirthdayColumn);
+    addMetric(size, "sort_first", elapsedMicros(timer) / 1000.0, "ms");
+    model.sort(ContactsModel::LastNameColumn);
+    timer.restart();
+    model.sort(ContactsModel::BirthdayColumn, Qt::DescendingOrder);
+    addMetric(size, "sort_again", elapsedMicros(timer) / 1000.0, "ms");
+
+    // Запросы готовим заранее: префикс фамилии, фамилия с именем, e-mail
+    QStringList queries;
+    queries.reserve(options.searches);
+    for (int i = 0; i < options.searches; ++i) {
+        Item item = model.item(random.bounded(size));
+        switch (i % 3) {
+        case 0: queries.append(item.userLastName.left(3)); break;
+        case 1: queries.append(item.userLastName + " " + item.userFirstName); break;
+        default: queries.append(item.userEmail); break;
+        }
+    }
+
+    QVector<qint64> samples;
+    samples.reserve(queries.size());
+    for (const QString &query : queries) {
+        timer.restart();
+        QVector<int> found = model.search(query);
+        samples.append(elapsedMicros(timer));
+        Q_UNUSED(found);
+    }
+    addLatency(size, "search_memory", samples);
+
+    // Просмотр подстроки по всем контактам: цифры из середины номера, кусок e-mail
+    {
+        ContactScanner scanner(model.searchSnapshot().contacts);
+        samples.clear();
+        for (int i = 0; i < options.searches / 10 + 1; ++i) {
+            Item item = model.item(random.bounded(size));
+            QString query = i % 2 == 0 ? item.userPhonesList.constFirst().mid(5, 5) : item.userEmail.mid(4, 6);
+            timer.restart();
+            QVector<int> found = scanner.scan(query);
+            samples.append(elapsedMicros(timer));
+            Q_UNUSED(found);
+        }
+        addLatency(size, "search_scan", samples);
+    }
+
+    // Нечёткий поиск: фамилия с опечаткой (одна буква заменена) и фамилия с именем латиницей
+    {
+        const ContactsModel::SearchSnapshot snapshot = model.searchSnapshot();
+        samples.clear();
+        for (int i = 0; i < options.searches; ++i) {
+            Item item = model.item(random.bounded(size));
+            QString query;
+            if (i % 2 == 0) {
+                query = item.userLastName;
+                query[1 + random.bounded(query.size() - 1)] = QChar(0x043E);
+            } else {
+                query = FuzzyIndex::transliterate(item.userLastName.toLower() + " " + item.userFirstName.toLower());
+            }
+            timer.restart();
+            QVector<FuzzyIndex::Match> found = snapshot.fuzzy.search(query);
+            samples.append(elapsedMicros(timer));
+            Q_UNUSED(found);
+        }
+        addLatency(size, "search_fuzzy", samples);
+    }
+
+    // Поиск повторов по всей книге (раскладка по блокам и сравнение внутри блоков)
+    {
+        DuplicateFinder finder(model.searchSnapshot().contacts);
+        timer.restart();
+        QVector<DuplicateFinder::Group> groups = finder.find();
+        addMetric(size, "dedupe", elapsedMicros(timer) / 1000.0, "ms");
+        addMetric(size, "dedupe_groups", groups.size(), "groups");
+    }
+
+    // Напоминания о днях рождения: первый запрос строит индекс дат, дальше - бинарный поиск и проход по найденному.
+    // Окна начинаются в случайный день года, часть из них переходит через Новый год.
+    QVector<QDate> birthdayWindows;
+    birthdayWindows.reserve(options.searches);
+    for (int i = 0; i < options.searches; ++i) {
+        birthdayWindows.append(QDate(2024, 1, 1).addDays(random.bounded(366)));
+    }
+    {
+        timer.restart();
+        QVector<BirthdayIndex::Upcoming> upcoming = model.upcomingBirthdays(birthdayWindows.constFirst(), BirthdayWindowDays);
+        addMetric(size, "birthdays_build", elapsedMicros(timer) / 1000.0, "ms");
+        Q_UNUSED(upcoming);
+
+        samples.clear();
+        for (const QDate &from : birthdayWindows) {
+            timer.restart();
+            upcoming = model.upcomingBirthdays(from, BirthdayWindowDays);
+            samples.append(elapsedMicros(timer));
+        }
+        addLatency(size, "birthdays_memory", samples);
+
+        samples.clear();
+        for (int i = 0; i < options.searches; ++i) {
+            const int firstYear = 1950 + random.bounded(50);
+            timer.restart();
+            QVector<int> born = model.bornBetween(QDate(firstYear, 1, 1), QDate(firstYear + 5, 12, 31));
+            samples.append(elapsedMicros(timer));
+            Q_UNUSED(born);
+        }
+        addLatency(size, "born_memory", samples);
+    }
+
+    AsyncStorage storage("address_book_bench");
+    StorageReply reply = storage.open(databasePath).result();
+    if (!reply.ok) {
+        errorText = reply.errorText;
+        return false;
+    }
+
+    if (storage.hasFullTextSearch()) {
+        samples.clear();
+        for (const QString &query : queries) {
+            timer.restart();
+            reply = storage.searchFullText(query, 1000).result();
+            samples.append(elapsedMicros(timer));
+            if (!reply.ok) {
+                errorText = reply.errorText;
+                return false;
+            }
+        }
+        addLatency(size, "search_fts", samples);
+    }
+
+    // Те же окна дней рождения в БД, по индексу birth_md
+    samples.clear();
+    for (const QDate &from : birthdayWindows) {
+        timer.restart();
+        reply = storage.upcomingBirthdays(from, BirthdayWindowDays).result();
+        samples.append(elapsedMicros(timer));
+        if (!reply.ok) {
+            errorText = reply.errorText;
+            return false;
+        }
+    }
+    addLatency(size, "birthdays_sql", samples);
+
+    // Правка одного контакта: модель, сохранение в потоке БД, снятие пометки - как в окне
+    samples.clear();
+    for (int i = 0; i < options.edits; ++i) {
+        int row = random.bounded(size);
+        Item item = model.item(row);
+        item.userEmail = QString("edit%1@example.com").arg(i);
+
+        timer.restart();
+        model.updateItem(row, item);
+        ContactsModel::PendingChanges changes = model.takeChanges();
+        reply = storage.save(changes.removedIds, changes.removedVersions, changes.items).result();
+        if (!reply.ok) {
+            errorText = reply.errorText;
+            return false;
+        }
+        model.markSaved(changes, reply.userIds, reply.versions);
+        samples.append(elapsedMicros(timer));
+    }
+    addLatency(size, "edit_save", samples);
+
+    // Сохранение всей книги: каждая запись изменена, всё уходит одной транзакцией
+    for (int row = 0; row < size; ++row) {
+        model.updateItem(row, model.item(row));
+    }
+    timer.restart();
+    ContactsModel::PendingChanges changes = model.takeChanges();
+    reply = storage.save(changes.removedIds, changes.removedVersions, changes.items).result();
+    if (!reply.ok) {
+        errorText = reply.errorText;
+        return false;
+    }
+    model.markSaved(changes, reply.userIds, reply.versions);
+    addMetric(size, "save_full", elapsedMicros(timer) / 1000.0, "ms");
+
+    /*
+     * Поток правок через очередь записи, как в окне: в strict каждая правка ждёт своей транзакции,
+     * в grouped правки идут подряд, а очередь пишет их группами. Коммитов столько же, сколько fsync журнала.
+     */
+    for (WriteQueue::Durability durability : {WriteQueue::Durability::Strict, WriteQueue::Durability::Grouped}) {
+        const bool strict = durability == WriteQueue::Durability::Strict;
+        WriteQueue queue(&model, &storage);
+        queue.setDurability(durability);
+
+        bool ok = true;
+        QObject::connect(&queue, &WriteQueue::failed, [this, &ok](const QString &errText) {
+            errorText = errText;
+            ok = false;
+        });
+        auto waitFlushed = [&queue]() {
+            bool done = false;
+            QEventLoop loop;
+            queue.whenFlushed([&done, &loop]() {
+                done = true;
+                loop.quit();
+            });
+            if (!done) loop.exec();
+        };
+
+        timer.restart();
+        for (int i = 0; i < options.edits && ok; ++i) {
+            int row = random.bounded(size);
+            Item item = model.item(row);
+            item.userEmail = QString("queue%1@example.com").arg(i);
+            model.updateItem(row, item);
+            queue.changed();
+            if (strict) {
+                waitFlushed();
+            } else {
+                QCoreApplication::processEvents();
+            }
+        }
+        waitFlushed();
+        if (!ok) return false;
+
+        const qint64 micros = elapsedMicros(timer);
+        const QString name = strict ? "write_strict" : "write_grouped";
+        addMetric(size, name + "_rate", options.edits * 1e6 / std::max<qint64>(micros, 1), "ops/s");
+        addMetric(size, name + "_commits", queue.transactionCount(), "fsync");
+    }
+
+    /*
+     * Правки из другого окна: другое соединение меняет контакты одной транзакцией, а модель дочитывает
+     * их из журнала изменений, как ChangeWatcher. Проверка без чужих правок - только PRAGMA data_version.
+     */
+    AddressBookStorage other("address_book_bench_other");
+    qint64 changeSeq = 0;
+    if (!other.open(databasePath) || !other.lastChange(changeSeq)) {
+        errorText = other.lastError();
+        return false;
+    }
+    reply = storage.pollChanges(changeSeq, ChangeWatcher::PageSize, -1).result();
+    if (!reply.ok) {
+        errorText = reply.errorText;
+        return false;
+    }
+    changeSeq = reply.changeSeq;
+
+    timer.restart();
+    StorageReply idle = storage.pollChanges(changeSeq, ChangeWatcher::PageSize, reply.dataVersion).result();
+    addMetric(size, "sync_idle", double(elapsedMicros(timer)), "us");
+    if (!idle.ok) {
+        errorText = idle.errorText;
+        return false;
+    }
+
+    if (!other.beginTransaction()) {
+        errorText = other.lastError();
+        return false;
+    }
+    for (int i = 0; i < options.edits; ++i) {
+        Item item = model.item(random.bounded(size));
+        item.userLastName = QString("Синхронизация%1").arg(i);
+        bool written = false;
+        if (!other.updateItem(item, written)) {
+            errorText = other.lastError();
+            other.rollback();
+            return false;
+        }
+        // Тот же контакт мог выпасть дважды: вторая правка по старой версии не запишется
+    }
+    if (!other.commit()) {
+        errorText = other.lastError();
+        return false;
+    }
+
+    timer.restart();
+    reply = storage.pollChanges(changeSeq, ChangeWatcher::PageSize, idle.dataVersion).result();
+    if (!reply.ok) {
+        errorText = reply.errorText;
+        return false;
+    }
+    int applied = model.applyRemoteChanges(reply.items, reply.removedIds);
+    addMetric(size, "sync_changes", elapsedMicros(timer) / 1000.0, "ms");
+    addMetric(size, "sync_rows", applied, "rows");
+
+    return true;
+}
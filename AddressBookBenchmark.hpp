@@ -0,0 +1,69 @@
+#ifndef ADDRESSBOOKBENCHMARK_H
+#define ADDRESSBOOKBENCHMARK_H
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QRandomGenerator>
+#include <QString>
+#include <QVector>
+
+#include "Item.hpp"
+
+class ContactsModel;
+
+/*
+ * Замеры производительности книги на синтетических БД разного размера.
+ * Для каждого размера во временном каталоге создаётся БД со случайными (но одинаковыми
+ * от запуска к запуску) контактами, и через те же классы, что работают в окне, замеряются:
+ *  - вставка при создании книги;
+ *  - загрузка в модель: первая (свежее соединение, пустой кэш SQLite) и повторная;
+ *  - снимок книги на диске: запись, открытие и фоновое построение индексов поиска;
+ *  - поиск по индексу в памяти, нечёткий, просмотром подстроки во всех ядрах и по FTS5 в БД (перцентили задержки);
+ *  - поиск повторов по всей книге;
+ *  - дни рождения в ближайшие две недели (в памяти и по индексу в БД) и по диапазону лет рождения (перцентили задержки);
+ *  - правка одного контакта с сохранением (перцентили задержки);
+ *  - сохранение всей книги одной транзакцией;
+ *  - поток правок через очередь записи: правок в секунду и коммитов (fsync) по транзакции на правку и на группу;
+ *  - подхват правок из другого окна: проверка без изменений и чтение журнала с правкой модели.
+ * Результаты - JSON, чтобы сравнивать сборки скриптом.
+ */
+class AddressBookBenchmark {
+public:
+    struct Options {
+        QVector<int> sizes = {10000, 100000, 1000000};
+        int searches = 1000;
+        int edits = 200;
+        quint32 seed = 42;
+    };
+
+    explicit AddressBookBenchmark(const Options &options);
+
+    // Прогнать замеры для всех размеров. При ошибке - false, текст в lastError().
+    bool run();
+
+    QJsonDocument results() const;
+    QString lastError() const;
+
+private:
+    bool runSize(int size, const QString &databasePath);
+
+    // Создать БД из size случайных контактов
+    bool generate(const QString &databasePath, int size);
+
+    // Загрузить книгу в модель так же, как это делает окно (AddressBookLoader)
+    bool load(const QString &databasePath, ContactsModel &model);
+
+    Item randomItem();
+
+    void addMetric(int size, const QString &name, double value, const QString &unit);
+
+    // Перцентили p50/p90/p99 и максимум по замерам в микросекундах
+    void addLatency(int size, const QString &name, QVector<qint64> samples);
+
+    Options options;
+    QRandomGenerator random;
+    QJsonArray metrics;
+    QString errorText;
+};
+
+#endif // ADDRESSBOOKBENCHMARK_H
@@ -0,0 +1,363 @@
+#include "AddressBookCli.hpp"
+#include "AddressBookStorage.hpp"
+#include "BirthdayIndex.hpp"
+#include "AddressBookImporter.hpp"
+#include "AddressBookExporter.hpp"
+#include "ContactFileWriter.hpp"
+#include "ContactStore.hpp"
+#include "DuplicateFinder.hpp"
+#include "Trace.hpp"
+#include <QCommandLineParser>
+#include <QDate>
+#include <QFileInfo>
+#include <QObject>
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+// Размер файла БД вместе с журналом WAL
+qint64 databaseSize(const QString &path) {
+    return QFileInfo(path).size() + QFileInfo(path + "-wal").size();
+}
+
+}
+
+AddressBookCli::AddressBookCli() : databasePath(AddressBookStorage::DefaultDatabasePath), err(stderr) {
+}
+
+int AddressBookCli::run(const QStringList &arguments) {
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Адресная книга из командной строки");
+    parser.addHelpOption();
+    parser.addPositionalArgument("command", "query, import, export, dedupe, compact, birthdays или born");
+    parser.addPositionalArgument("argument", "Запрос (query), имя файла (import, export; \"-\" - стандартный вывод), "
+                                             "число дней (birthdays) или годы рождения (born)");
+
+    QCommandLineOption dbOption("db", "Путь к БД", "path", AddressBookStorage::DefaultDatabasePath);
+    QCommandLineOption limitOption("limit", "Сколько контактов вывести (query), 0 - все", "N", "0");
+    QCommandLineOption formatOption("format", "Формат вывода query: csv, vcf или jsonl", "format", "csv");
+    QCommandLineOption queryOption("query", "Экспортировать только найденное по запросу", "query");
+    QCommandLineOption applyOption("apply", "Объединить найденные повторы (dedupe), иначе только показать");
+    QCommandLineOption fromOption("from", "С какого дня искать дни рождения (birthdays), по умолчанию сегодня", "dd-MM-yyyy");
+    QCommandLineOption statsOption("stats", "Вывести статистику замеров (SQL, загрузка, поиск) в конце");
+    QCommandLineOption traceOption("trace", "Записать события в формате chrome://tracing", "file");
+    parser.addOptions({dbOption, limitOption, formatOption, queryOption, applyOption, fromOption, statsOption, traceOption});
+
+    if (!parser.parse(arguments)) {
+        err << parser.errorText() << "\n";
+        return UsageError;
+    }
+    if (parser.isSet("help")) {
+        err << parser.helpText();
+        return Success;
+    }
+
+    databasePath = parser.value(dbOption);
+    const QStringList positional = parser.positionalArguments();
+    const QString command = positional.value(0);
+    const QString argument = positional.value(1);
+
+    bool limitOk = false;
+    int limit = parser.value(limitOption).toInt(&limitOk);
+    if (!limitOk || limit < 0) {
+        err << "Неверное значение --limit: " << parser.value(limitOption) << "\n";
+        return UsageError;
+    }
+
+    Trace::setEnabled(parser.isSet(statsOption) || parser.isSet(traceOption));
+
+    int result = UsageError;
+    if (command == "query") {
+        result = query(argument, limit, parser.value(formatOption));
+    } else if (command == "import" && !argument.isEmpty()) {
+        result = importFile(argument);
+    } else if (command == "export" && !argument.isEmpty()) {
+        result = exportFile(argument, parser.value(queryOption));
+    } else if (command == "dedupe") {
+        result = dedupe(parser.isSet(applyOption));
+    } else if (command == "compact") {
+        result = compact();
+    } else if (command == "birthdays") {
+        result = birthdays(argument, parser.value(fromOption));
+    } else if (command == "born" && !argument.isEmpty()) {
+        result = born(argument, parser.value(formatOption));
+    } else {
+        err << parser.helpText();
+        return UsageError;
+    }
+
+    if (parser.isSet(statsOption)) err << Trace::stats() << "\n";
+    if (parser.isSet(traceOption)) {
+        QString errText;
+        if (!Trace::writeChromeTrace(parser.value(traceOption), errText)) {
+            err << errText << "\n";
+            if (result == Success) result = Failure;
+        }
+    }
+    return result;
+}
+
+int AddressBookCli::query(const QString &terms, int limit, const QString &format) {
+    const QString lowerFormat = format.toLower();
+    if (lowerFormat != "csv" && lowerFormat != "vcf" && lowerFormat != "jsonl") {
+        err << "Неизвестный формат: " << format << "\n";
+        return UsageError;
+    }
+
+    AddressBookStorage storage("address_book_cli");
+    if (!storage.open(databasePath)) {
+        err << storage.lastError() << "\n";
+        return Failure;
+    }
+
+    // Формат берём по "расширению", чтобы правила выбора были те же, что и у экспорта в файл
+    ContactFileWriter writer("-", ContactFileWriter::formatForFile("query." + lowerFormat));
+    if (!writer.open()) {
+        err << writer.lastError() << "\n";
+        return Failure;
+    }
+
+    // Контакты идут из курсора прямо в вывод, книга в памяти не собирается
+    int written = 0;
+    bool writeFailed = false;
+    bool ret = storage.scanItems(terms, [&](const Item &item) {
+        if (!writer.writeItem(item)) {
+            writeFailed = true;
+            return false;
+        }
+        return limit == 0 || ++written < limit;
+    });
+
+    if (!ret || writeFailed) {
+        err << (writeFailed ? writer.lastError() : storage.lastError()) << "\n";
+        writer.close();
+        return Failure;
+    }
+    if (!writer.close()) {
+        err << writer.lastError() << "\n";
+        return Failure;
+    }
+    return Success;
+}
+
+int AddressBookCli::importFile(const QString &fileName) {
+    // Тот же импортёр, что и в окне, только вызывается прямо в этом потоке
+    AddressBookImporter importer(databasePath, fileName);
+
+    int result = Success;
+    QObject::connect(&importer, &AddressBookImporter::rowErrors, [this](const QStringList &errors) {
+        for (const QString &error : errors) err << error << "\n";
+    });
+    QObject::connect(&importer, &AddressBookImporter::finished, [this](int imported, int rejected) {
+        err << "Импортировано: " << imported << ", с ошибками: " << rejected << "\n";
+    });
+    QObject::connect(&importer, &AddressBookImporter::failed, [this, &result](const QString &errText) {
+        err << errText << "\n";
+        result = Failure;
+    });
+
+    importer.import();
+    return result;
+}
+
+int AddressBookCli::exportFile(const QString &fileName, const QString &terms) {
+    AddressBookExporter exporter(databasePath, fileName, terms);
+
+    int result = Success;
+    QObject::connect(&exporter, &AddressBookExporter::finished, [this](int rowsWritten) {
+        err << "Экспортировано: " << rowsWritten << "\n";
+    });
+    QObject::connect(&exporter, &AddressBookExporter::failed, [this, &result](const QString &errText) {
+        err << errText << "\n";
+        result = Failure;
+    });
+
+    exporter.exportItems();
+    return result;
+}
+
+int AddressBookCli::dedupe(bool apply) {
+    AddressBookStorage storage("address_book_cli");
+    if (!storage.open(databasePath)) {
+        err << storage.lastError() << "\n";
+        return Failure;
+    }
+
+    // Вся книга в компактном хранилище: миллионы контактов занимают десятки мегабайт, а не гигабайты Item
+    ContactStore contacts;
+    bool ret = storage.scanItems(QString(), [&contacts](const Item &item) {
+        contacts.append(item);
+        return true;
+    });
+    if (!ret) {
+        err << storage.lastError() << "\n";
+        return Failure;
+    }
+
+    const QVector<DuplicateFinder::Group> groups = DuplicateFinder(contacts).find();
+
+    // Пары "повтор<TAB>оставляемый контакт<TAB>уверенность", удобно разбирать в скриптах
+    QTextStream out(stdout);
+    int duplicateCount = 0;
+    for (const DuplicateFinder::Group &group : groups) {
+        const qint64 keeperId = contacts.id(group.slotList.first());
+        for (int i = 1; i < group.slotList.size(); ++i) {
+            out << contacts.id(group.slotList[i]) << '\t' << keeperId << '\t' << group.score << "\n";
+            ++duplicateCount;
+        }
+    }
+    out.flush();
+
+    err << "Найдено повторов: " << duplicateCount << " в " << groups.size() << " группах\n";
+    if (!apply || groups.isEmpty()) return Success;
+
+    // Одной транзакцией: оставляемый контакт получает объединённые данные, повторы удаляются
+    if (!storage.beginTransaction()) {
+        err << storage.lastError() << "\n";
+        return Failure;
+    }
+    for (const DuplicateFinder::Group &group : groups) {
+        bool written = false;
+        bool ok = storage.updateItem(group.merged, written);
+        if (ok && !written) {
+            // Контакт изменили, пока искали повторы: сливать по устаревшим данным нельзя
+            err << "Контакт #" << group.merged.userId << " изменён во время поиска повторов, запустите dedupe ещё раз\n";
+            storage.rollback();
+            return Failure;
+        }
+        for (int i = 1; ok && written && i < group.slotList.size(); ++i) {
+            const int slot = group.slotList[i];
+            ok = storage.removeItem(QString::number(contacts.id(slot)), contacts.version(slot), written);
+            if (ok && !written) {
+                // Повтор изменили или удалили, пока шёл поиск: удалять его по устаревшим данным нельзя
+                err << "Контакт #" << contacts.id(slot) << " изменён во время поиска повторов, запустите dedupe ещё раз\n";
+                storage.rollback();
+                return Failure;
+            }
+        }
+        if (!ok) {
+            err << storage.lastError() << "\n";
+            storage.rollback();
+            return Failure;
+        }
+    }
+    if (!storage.commit()) {
+        err << storage.lastError() << "\n";
+        storage.rollback();
+        return Failure;
+    }
+
+    err << "Удалено повторов: " << duplicateCount << "\n";
+    return Success;
+}
+
+int AddressBookCli::compact() {
+    AddressBookStorage storage("address_book_cli");
+    if (!storage.open(databasePath)) {
+        err << storage.lastError() << "\n";
+        return Failure;
+    }
+
+    qint64 sizeBefore = databaseSize(databasePath);
+    if (!storage.compact()) {
+        err << storage.lastError() << "\n";
+        return Failure;
+    }
+    qint64 sizeAfter = databaseSize(databasePath);
+
+    err << "Размер БД: " << sizeBefore << " -> " << sizeAfter << " байт\n";
+    return Success;
+}
+
+int AddressBookCli::birthdays(const QString &days, const QString &from) {
+    int dayCount = 14;
+    if (!days.isEmpty()) {
+        bool ok = false;
+        dayCount = days.toInt(&ok);
+        if (!ok || dayCount < 1 || dayCount > BirthdayIndex::MaxDays) {
+            err << "Неверное число дней: " << days << " (от 1 до " << BirthdayIndex::MaxDays << ")\n";
+            return UsageError;
+        }
+    }
+    const QDate fromDate = from.isEmpty() ? QDate::currentDate() : QDate::fromString(from, "dd-MM-yyyy");
+    if (!fromDate.isValid()) {
+        err << "Неверная дата --from: " << from << "\n";
+        return UsageError;
+    }
+
+    AddressBookStorage storage("address_book_cli");
+    if (!storage.open(databasePath)) {
+        err << storage.lastError() << "\n";
+        return Failure;
+    }
+
+    QVector<Item> items;
+    if (!storage.upcomingBirthdays(fromDate, dayCount, items)) {
+        err << storage.lastError() << "\n";
+        return Failure;
+    }
+
+    // Строки "дата<TAB>сколько исполнится<TAB>user_id<TAB>ФИО<TAB>телефоны", по дате
+    QTextStream out(stdout);
+    for (const Item &item : items) {
+        const QDate birthDate = AddressBookStorage::birthDate(item.userBirthday);
+        const QDate date = BirthdayIndex::nextBirthday(birthDate, fromDate);
+        const QString name = QStringList{item.userLastName, item.userFirstName, item.userPatronymicName}.join(' ').simplified();
+        out << date.toString("dd-MM-yyyy") << '\t' << date.year() - birthDate.year() << '\t' << item.userId << '\t'
+            << name << '\t' << QStringList::fromVector(item.userPhonesList).join(",") << "\n";
+    }
+    out.flush();
+
+    err << "Дней рождения за " << dayCount << " дн. с " << fromDate.toString("dd-MM-yyyy") << ": " << items.size() << "\n";
+    return Success;
+}
+
+int AddressBookCli::born(const QString &years, const QString &format) {
+    // "1990" или "1990-1995"
+    const QStringList parts = years.split('-');
+    bool firstOk = false;
+    bool lastOk = false;
+    const int firstYear = parts.first().toInt(&firstOk);
+    const int lastYear = parts.last().toInt(&lastOk);
+    if (parts.size() > 2 || !firstOk || !lastOk || firstYear < 1 || lastYear < firstYear || lastYear > 9999) {
+        err << "Неверные годы рождения: " << years << "\n";
+        return UsageError;
+    }
+
+    const QString lowerFormat = format.toLower();
+    if (lowerFormat != "csv" && lowerFormat != "vcf" && lowerFormat != "jsonl") {
+        err << "Неизвестный формат: " << format << "\n";
+        return UsageError;
+    }
+
+    AddressBookStorage storage("address_book_cli");
+    if (!storage.open(databasePath)) {
+        err << storage.lastError() << "\n";
+        return Failure;
+    }
+
+    QVector<Item> items;
+    if (!storage.bornBetween(QDate(firstYear, 1, 1), QDate(lastYear, 12, 31), items)) {
+        err << storage.lastError() << "\n";
+        return Failure;
+    }
+
+    ContactFileWriter writer("-", ContactFileWriter::formatForFile("born." + lowerFormat));
+    if (!writer.open()) {
+        err << writer.lastError() << "\n";
+        return Failure;
+    }
+    for (const Item &item : items) {
+        if (!writer.writeItem(item)) {
+            err << writer.lastError() << "\n";
+            writer.close();
+            return Failure;
+        }
+    }
+    if (!writer.close()) {
+        err << writer.lastError() << "\n";
+        return Failure;
+    }
+    return Success;
+}
@@ -0,0 +1,51 @@
+#ifndef ADDRESSBOOKCLI_H
+#define ADDRESSBOOKCLI_H
+
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+
+/*
+ * Консольная утилита addressbook-cli: те же БД, поиск, проверка, импорт и экспорт,
+ * что и у окна, но без виджетов, чтобы книгу можно было обрабатывать из скриптов
+ * и на серверах без графики.
+ *
+ *   addressbook-cli [--db путь] query <запрос> [--limit N] [--format csv|vcf|jsonl]
+ *   addressbook-cli [--db путь] import <файл>
+ *   addressbook-cli [--db путь] export <файл|-> [--query запрос]
+ *   addressbook-cli [--db путь] dedupe [--apply]
+ *   addressbook-cli [--db путь] compact
+ *   addressbook-cli [--db путь] birthdays [дней] [--from дд-ММ-гггг]
+ *   addressbook-cli [--db путь] born <год>[-<год>] [--format csv|vcf|jsonl]
+ *
+ * --stats печатает статистику замеров, --trace файл - события для chrome://tracing.
+ * Данные идут в стандартный вывод, сообщения и ошибки - в стандартный поток ошибок.
+ */
+class AddressBookCli {
+public:
+    // Коды завершения программы
+    enum ExitCode {
+        Success = 0,
+        Failure = 1,
+        UsageError = 2
+    };
+
+    AddressBookCli();
+
+    // arguments - как у QCoreApplication::arguments(), с именем программы
+    int run(const QStringList &arguments);
+
+private:
+    int query(const QString &terms, int limit, const QString &format);
+    int importFile(const QString &fileName);
+    int exportFile(const QString &fileName, const QString &terms);
+    int dedupe(bool apply);
+    int compact();
+    int birthdays(const QString &days, const QString &from);
+    int born(const QString &years, const QString &format);
+
+    QString databasePath;
+    QTextStream err;
+};
+
+#endif // ADDRESSBOOKCLI_H
@@ -0,0 +1,52 @@
+#include "AddressBookExporter.hpp"
+#include "AddressBookStorage.hpp"
+#include "ContactFileWriter.hpp"
+#include "Trace.hpp"
+#include <QThread>
+
+AddressBookExporter::AddressBookExporter(const QString &databasePath, const QString &fileName, const QString &query, QObject *parent)
+    : QObject(parent), databasePath(databasePath), fileName(fileName), query(query) {
+}
+
+void AddressBookExporter::exportItems() {
+    int rowsWritten = 0;
+
+    {
+        AddressBookStorage storage("address_book_export");
+        if (!storage.open(databasePath)) {
+            emit failed(storage.lastError());
+            return;
+        }
+
+        ContactFileWriter writer(fileName, ContactFileWriter::formatForFile(fileName));
+        if (!writer.open()) {
+            emit failed(writer.lastError());
+            return;
+        }
+
+        // Контакт из курсора сразу уходит в файл, ничего не накапливается
+        bool writeFailed = false;
+        bool ret = storage.scanItems(query, [&](const Item &item) {
+            if (!writer.writeItem(item)) {
+                writeFailed = true;
+                return false;
+            }
+            if (++rowsWritten % ProgressInterval == 0) emit progress(rowsWritten);
+            return !QThread::currentThread()->isInterruptionRequested();
+        });
+
+        if (!ret || writeFailed) {
+            QString errText = writeFailed ? writer.lastError() : storage.lastError();
+            writer.close();
+            emit failed(errText);
+            return;
+        }
+        if (!writer.close()) {
+            emit failed(writer.lastError());
+            return;
+        }
+    }
+
+    Trace::count("rows.exported", rowsWritten);
+    emit finished(rowsWritten);
+}
@@ -0,0 +1,40 @@
+#ifndef ADDRESSBOOKEXPORTER_H
+#define ADDRESSBOOKEXPORTER_H
+
+#include <QObject>
+#include <QString>
+
+/*
+ * Экспорт адресной книги в файл (CSV, vCard 4.0, JSON Lines).
+ * Объект переносится в отдельный QThread и читает БД через собственное соединение
+ * одним курсором, а каждый прочитанный контакт сразу пишет в файл.
+ * Память не растёт с размером книги: в ней только текущая строка и буфер записи.
+ */
+class AddressBookExporter : public QObject {
+    Q_OBJECT
+
+public:
+    // Как часто сообщать о прогрессе (в контактах)
+    static constexpr int ProgressInterval = 10000;
+
+    // query - фильтр в синтаксисе поиска, пустой - экспортировать всю книгу
+    AddressBookExporter(const QString &databasePath, const QString &fileName, const QString &query, QObject *parent = nullptr);
+
+public slots:
+    // Выполнить экспорт. Выполняется в потоке, куда перенесён объект.
+    void exportItems();
+
+signals:
+    void progress(int rowsWritten);
+
+    void finished(int rowsWritten);
+
+    void failed(const QString &errText);
+
+private:
+    QString databasePath;
+    QString fileName;
+    QString query;
+};
+
+#endif // ADDRESSBOOKEXPORTER_H
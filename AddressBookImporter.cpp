@@ -0,0 +1,97 @@
+#include "AddressBookImporter.hpp"
+#include "AddressBookStorage.hpp"
+#include "ContactFileReader.hpp"
+#include "ItemValidator.hpp"
+#include "Trace.hpp"
+#include <QThread>
+#include <QtConcurrent/QtConcurrentMap>
+
+AddressBookImporter::AddressBookImporter(const QString &databasePath, const QString &fileName, QObject *parent)
+    : QObject(parent), databasePath(databasePath), fileName(fileName) {
+}
+
+void AddressBookImporter::import() {
+    int rowsRead = 0;
+    int imported = 0;
+    int rejected = 0;
+
+    {
+        ContactFileReader reader(fileName, ContactFileReader::formatForFile(fileName));
+        if (!reader.open()) {
+            emit failed(reader.lastError());
+            return;
+        }
+
+        // Своё соединение, как у загрузчика: соединение SQLite нельзя делить между потоками
+        AddressBookStorage storage("address_book_import");
+        if (!storage.open(databasePath)) {
+            emit failed(storage.lastError());
+            return;
+        }
+
+        // Дата рождения сравнивается с сегодняшней, берём её один раз на весь импорт
+        const QDate today = QDate::currentDate();
+
+        QVector<ImportRecord> current;
+        bool more = reader.readChunk(current, ChunkSize);
+
+        while (!current.isEmpty() && !QThread::currentThread()->isInterruptionRequested()) {
+            // Проверка порции идёт в пуле потоков, а этот поток тем временем читает следующую
+            QFuture<void> validation = QtConcurrent::map(current, [today](ImportRecord &record) {
+                if (record.error.isEmpty()) record.error = ItemValidator::errorText(ItemValidator::check(record.item, today));
+            });
+
+            QVector<ImportRecord> next;
+            if (more) more = reader.readChunk(next, ChunkSize);
+
+            validation.waitForFinished();
+
+            // Вся порция - одна транзакция, то есть один fsync на ChunkSize записей
+            if (!storage.beginTransaction()) {
+                emit failed(storage.lastError());
+                return;
+            }
+
+            QVector<Item> saved;
+            saved.reserve(current.size());
+            QStringList errors;
+
+            for (ImportRecord &record : current) {
+                if (!record.error.isEmpty()) {
+                    errors.append(QString("Строка %1: %2").arg(record.line).arg(record.error));
+                    continue;
+                }
+
+                QString userId;
+                if (!storage.insertItem(record.item, userId)) {
+                    QString errText = storage.lastError();
+                    storage.rollback();
+                    emit failed(QString("Ошибка записи (строка %1): %2").arg(record.line).arg(errText));
+                    return;
+                }
+                record.item.userId = userId;
+                saved.append(record.item);
+            }
+
+            if (!storage.commit()) {
+                QString errText = storage.lastError();
+                storage.rollback();
+                emit failed(errText);
+                return;
+            }
+
+            rowsRead += current.size();
+            imported += saved.size();
+            rejected += errors.size();
+
+            Trace::count("rows.imported", saved.size());
+            if (!saved.isEmpty()) emit batchImported(saved);
+            if (!errors.isEmpty()) emit rowErrors(errors);
+            emit progress(rowsRead, imported, rejected);
+
+            current = std::move(next);
+        }
+    }
+
+    emit finished(imported, rejected);
+}
@@ -0,0 +1,48 @@
+#ifndef ADDRESSBOOKIMPORTER_H
+#define ADDRESSBOOKIMPORTER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "Item.hpp"
+
+/*
+ * Массовый импорт контактов из файла (CSV, vCard или старый формат "|").
+ * Объект переносится в отдельный QThread, как и AddressBookLoader, и пишет в БД
+ * через собственное соединение. Файл читается порциями; пока пул потоков проверяет
+ * одну порцию, читается следующая, а корректные записи порции вставляются одной транзакцией.
+ */
+class AddressBookImporter : public QObject {
+    Q_OBJECT
+
+public:
+    // Записей в одной порции (и в одной транзакции)
+    static constexpr int ChunkSize = 5000;
+
+    AddressBookImporter(const QString &databasePath, const QString &fileName, QObject *parent = nullptr);
+
+public slots:
+    // Импортировать весь файл. Выполняется в потоке, куда перенесён объект.
+    void import();
+
+signals:
+    // Очередная порция записана в БД, у контактов уже есть user_id
+    void batchImported(const QVector<Item> &items);
+
+    // Ошибки в записях очередной порции ("Строка N: текст ошибки")
+    void rowErrors(const QStringList &errors);
+
+    void progress(int rowsRead, int imported, int rejected);
+
+    void finished(int imported, int rejected);
+
+    void failed(const QString &errText);
+
+private:
+    QString databasePath;
+    QString fileName;
+};
+
+#endif // ADDRESSBOOKIMPORTER_H
@@ -0,0 +1,60 @@
+#include "AddressBookLoader.hpp"
+#include "AddressBookStorage.hpp"
+#include "Trace.hpp"
+#include <QThread>
+
+AddressBookLoader::AddressBookLoader(const QString &databasePath, QObject *parent)
+    : QObject(parent), databasePath(databasePath) {
+}
+
+void AddressBookLoader::load() {
+    int totalRows = 0;
+    qint64 changeSeq = 0;
+
+    // Соединение SQLite нельзя делить между потоками, поэтому у загрузчика своё.
+    // Оно создаётся и закрывается здесь же, в потоке загрузчика.
+    {
+        AddressBookStorage storage("address_book_loader");
+        if (!storage.open(databasePath)) {
+            emit failed(storage.lastError());
+            return;
+        }
+
+        // Номер изменения в журнале берём до чтения: всё, что изменят во время загрузки,
+        // окно потом дочитает из журнала (повторно прочитанное ничего не испортит - у записи та же версия)
+        if (!storage.lastChange(changeSeq)) {
+            emit failed(storage.lastError());
+            return;
+        }
+
+        // Верхнюю границу фиксируем заранее: всё, что добавят после старта загрузки,
+        // уже есть в модели, и читать это второй раз нельзя.
+        qint64 upToUserId = 0;
+        if (!storage.maxUserId(upToUserId)) {
+            emit failed(storage.lastError());
+            return;
+        }
+
+        qint64 lastUserId = 0;
+        int pageSize = FirstPageSize;
+        while (lastUserId < upToUserId && !QThread::currentThread()->isInterruptionRequested()) {
+            QVector<Item> page;
+            page.reserve(pageSize);
+            if (!storage.loadPage(lastUserId, upToUserId, pageSize, page)) {
+                emit failed(storage.lastError());
+                return;
+            }
+            if (page.isEmpty()) break;
+
+            // Следующая страница начнётся сразу после последнего прочитанного user_id
+            lastUserId = page.constLast().userId.toLongLong();
+            totalRows += page.size();
+            Trace::count("rows.loaded", page.size());
+            emit pageLoaded(page);
+
+            pageSize = PageSize;
+        }
+    }
+
+    emit finished(totalRows, changeSeq);
+}
@@ -0,0 +1,44 @@
+#ifndef ADDRESSBOOKLOADER_H
+#define ADDRESSBOOKLOADER_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+#include "Item.hpp"
+
+/*
+ * Фоновая загрузка адресной книги.
+ * Объект переносится в отдельный QThread и читает БД страницами по user_id
+ * через собственное соединение. Первая страница маленькая, чтобы таблица
+ * заполнилась сразу, остальные крупнее и приходят по мере чтения.
+ */
+class AddressBookLoader : public QObject {
+    Q_OBJECT
+
+public:
+    // Первая страница - примерно один экран таблицы
+    static constexpr int FirstPageSize = 200;
+    static constexpr int PageSize = 10000;
+
+    explicit AddressBookLoader(const QString &databasePath, QObject *parent = nullptr);
+
+public slots:
+    // Прочитать всю книгу. Выполняется в потоке, куда перенесён объект.
+    void load();
+
+signals:
+    // Очередная страница контактов, упорядоченных по user_id
+    void pageLoaded(const QVector<Item> &items);
+
+    // Загрузка закончилась (totalRows - сколько строк прочитано).
+    // changeSeq - номер последнего изменения в журнале на момент начала загрузки, с него окно следит за чужими правками.
+    void finished(int totalRows, qint64 changeSeq);
+
+    void failed(const QString &errText);
+
+private:
+    QString databasePath;
+};
+
+#endif // ADDRESSBOOKLOADER_H
@@ -0,0 +1,929 @@
+#include "AddressBookStorage.hpp"
+#include "BirthdayIndex.hpp"
+#include "SearchIndex.hpp"
+#include "PhoneNumber.hpp"
+#include "Trace.hpp"
+#include <QSet>
+#include <QtSql/QSqlError>
+#include <QStringList>
+#include <QVariant>
+
+const QString AddressBookStorage::DefaultDatabasePath = "C:/sqlite_db/address_book.db";
+
+// Номера колонок в запросах SELECT, чтобы не искать их по имени для каждой строки
+namespace {
+enum SelectColumn {
+    SelectUserId,
+    SelectLastName,
+    SelectFirstName,
+    SelectPatronymic,
+    SelectPhoneList,
+    SelectEmail,
+    SelectBirthday,
+    SelectVersion
+};
+
+// Собрать контакт из текущей строки запроса с колонками в порядке SelectColumn
+Item readItem(const QSqlQuery &query) {
+    Item item;
+    item.userId = query.value(SelectUserId).toString();
+    item.userLastName = query.value(SelectLastName).toString();
+    item.userFirstName = query.value(SelectFirstName).toString();
+    item.userPatronymicName = query.value(SelectPatronymic).toString();
+    item.userEmail = query.value(SelectEmail).toString();
+    item.userBirthday = query.value(SelectBirthday).toString();
+    item.userPhonesList = query.value(SelectPhoneList).toString().split(",", Qt::SkipEmptyParts).toVector();
+    item.version = query.value(SelectVersion).toUInt();
+    return item;
+}
+
+// Значения колонок birth_date и birth_md (NULL, если даты нет)
+QVariant birthDateValue(const QDate &date) {
+    return date.isValid() ? QVariant(date.toString(Qt::ISODate)) : QVariant(QMetaType::fromType<QString>());
+}
+
+QVariant birthMonthDayValue(const QDate &date) {
+    return date.isValid() ? QVariant(date.month() * 100 + date.day()) : QVariant(QMetaType::fromType<int>());
+}
+}
+
+AddressBookStorage::AddressBookStorage(const QString &connectionName) : connectionName(connectionName) {
+}
+
+AddressBookStorage::~AddressBookStorage() {
+    close();
+}
+
+bool AddressBookStorage::open(const QString &databasePath) {
+    if (isOpen()) return true;
+
+    // Соединение именованное, чтобы не мешать другим подключениям по умолчанию
+    db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    db.setDatabaseName(databasePath);
+
+    if (!db.open()) {
+        return fail("Ошибка подключения к БД: " + db.lastError().text());
+    }
+
+    if (!applyPragmas() || !createSchema() || !prepareStatements()) {
+        QString errText = errorText;
+        close();
+        return fail(errText);
+    }
+    return true;
+}
+
+void AddressBookStorage::close() {
+    // Запросы держат ссылку на соединение, поэтому уничтожаем их до removeDatabase
+    insertQuery.reset();
+    updateQuery.reset();
+    deleteQuery.reset();
+    selectPageQuery.reset();
+    selectItemQuery.reset();
+    changesQuery.reset();
+    birthdaysQuery.reset();
+    bornQuery.reset();
+    fullTextQueryStatement.reset();
+    selectPhonesQuery.reset();
+    insertPhoneQuery.reset();
+    deletePhoneQuery.reset();
+    phoneOwnersQuery.reset();
+    fullTextAvailable = false;
+
+    if (db.isValid()) {
+        db.close();
+        db = QSqlDatabase();
+        QSqlDatabase::removeDatabase(connectionName);
+    }
+}
+
+bool AddressBookStorage::isOpen() const {
+    return db.isValid() && db.isOpen();
+}
+
+QString AddressBookStorage::databasePath() const {
+    return db.databaseName();
+}
+
+QString AddressBookStorage::lastError() const {
+    return errorText;
+}
+
+bool AddressBookStorage::fail(const QString &errText) {
+    errorText = errText;
+    return false;
+}
+
+bool AddressBookStorage::applyPragmas() {
+    /*
+     * WAL: читатели не блокируют писателя, а коммит пишет в журнал без перезаписи основного файла.
+     * synchronous=NORMAL в режиме WAL не теряет целостность, но делает fsync реже.
+     * cache_size в минус-килобайтах (64 МБ), mmap_size - чтение страниц через отображение файла в память (256 МБ).
+     */
+    const QStringList pragmas = {
+        "PRAGMA journal_mode=WAL",
+        "PRAGMA synchronous=NORMAL",
+        "PRAGMA cache_size=-65536",
+        "PRAGMA mmap_size=268435456",
+        "PRAGMA temp_store=MEMORY",
+        // Нужно для ON DELETE CASCADE в таблице phone
+        "PRAGMA foreign_keys=ON"
+    };
+
+    QSqlQuery query(db);
+    for (const QString &pragma : pragmas) {
+        if (!query.exec(pragma)) {
+            return fail("Ошибка настройки БД (" + pragma + "): " + query.lastError().text());
+        }
+    }
+    return true;
+}
+
+bool AddressBookStorage::createSchema() {
+    QSqlQuery query(db);
+    QString queryStr = "CREATE TABLE IF NOT EXISTS address_book (user_id INTEGER PRIMARY KEY, lastname VARCHAR(80), "
+                       "firstname VARCHAR(80), patronymic VARCHAR(80), "
+                       "phone_list VARCHAR(120), email VARCHAR(80), birthday VARCHAR(30), "
+                       "version INTEGER NOT NULL DEFAULT 1, birth_date TEXT, birth_md INTEGER, phone_tokens TEXT);";
+    if (!query.exec(queryStr)) {
+        return fail("Ошибка создания таблицы адресной книги в БД: " + query.lastError().text());
+    }
+
+    if (!addVersionColumn() || !addBirthDateColumns() || !createChangeLog() || !createPhoneTable() ||
+        !addPhoneTokensColumn() || !createMetaTable()) {
+        return false;
+    }
+
+    // Без полнотекстового индекса книга тоже работает, просто не будет поиска на стороне БД
+    fullTextAvailable = createFullTextIndex();
+    return true;
+}
+
+bool AddressBookStorage::addVersionColumn() {
+    QSqlQuery query(db);
+    if (!query.exec("PRAGMA table_info(address_book)")) {
+        return fail("Ошибка запроса к БД: " + query.lastError().text());
+    }
+    while (query.next()) {
+        if (query.value(1).toString() == "version") return true;
+    }
+    query.finish();
+
+    // Книга создана до появления версий: у всех записей будет версия 1
+    if (!query.exec("ALTER TABLE address_book ADD COLUMN version INTEGER NOT NULL DEFAULT 1")) {
+        return fail("Ошибка добавления версий записей в БД: " + query.lastError().text());
+    }
+    return true;
+}
+
+bool AddressBookStorage::addBirthDateColumns() {
+    QSqlQuery query(db);
+    if (!query.exec("PRAGMA table_info(address_book)")) {
+        return fail("Ошибка запроса к БД: " + query.lastError().text());
+    }
+    bool existed = false;
+    while (query.next()) {
+        if (query.value(1).toString() == "birth_date") existed = true;
+    }
+    query.finish();
+
+    if (!existed) {
+        if (!query.exec("ALTER TABLE address_book ADD COLUMN birth_date TEXT") ||
+            !query.exec("ALTER TABLE address_book ADD COLUMN birth_md INTEGER")) {
+            return fail("Ошибка добавления дат рождения в БД: " + query.lastError().text());
+        }
+    }
+
+    // В индексе по birth_md за месяцем и днём идёт user_id, так что ORDER BY birth_md, user_id не сортирует
+    if (!query.exec("CREATE INDEX IF NOT EXISTS address_book_birth_md_idx ON address_book(birth_md)") ||
+        !query.exec("CREATE INDEX IF NOT EXISTS address_book_birth_date_idx ON address_book(birth_date)")) {
+        return fail("Ошибка создания индекса дат рождения в БД: " + query.lastError().text());
+    }
+    if (existed) return true;
+
+    // Колонки только что появились: один раз разбираем даты из текста birthday.
+    // Версии записей не меняются: содержимое контактов то же, добавилась только его копия в виде даты
+    if (!db.transaction()) {
+        return fail("Ошибка начала транзакции в БД: " + db.lastError().text());
+    }
+
+    QSqlQuery select(db);
+    select.setForwardOnly(true);
+    QSqlQuery update(db);
+    update.prepare("UPDATE address_book SET birth_date=:birth_date, birth_md=:birth_md WHERE user_id=:user_id");
+
+    if (!select.exec("SELECT user_id, birthday FROM address_book WHERE birthday IS NOT NULL AND birthday <> ''")) {
+        QString errText = select.lastError().text();
+        db.rollback();
+        return fail("Ошибка переноса дат рождения в БД: " + errText);
+    }
+    while (select.next()) {
+        const QDate date = birthDate(select.value(1).toString());
+        if (!date.isValid()) continue;
+
+        update.bindValue(":birth_date", birthDateValue(date));
+        update.bindValue(":birth_md", birthMonthDayValue(date));
+        update.bindValue(":user_id", select.value(0));
+        if (!update.exec()) {
+            QString errText = update.lastError().text();
+            db.rollback();
+            return fail("Ошибка переноса дат рождения в БД: " + errText);
+        }
+    }
+    select.finish();
+
+    if (!db.commit()) {
+        return fail("Ошибка фиксации транзакции в БД: " + db.lastError().text());
+    }
+    return true;
+}
+
+bool AddressBookStorage::addPhoneTokensColumn() {
+    QSqlQuery query(db);
+    if (!query.exec("PRAGMA table_info(address_book)")) {
+        return fail("Ошибка запроса к БД: " + query.lastError().text());
+    }
+    while (query.next()) {
+        if (query.value(1).toString() == "phone_tokens") return true;
+    }
+    query.finish();
+
+    /*
+     * Телефоны в phone_list хранятся как введены, и FTS5 режет "+7(921)999-19-99" на "7", "921", "999"...
+     * В phone_tokens те же номера, что в индексе в памяти: цифры с кодом страны и без него, через пробел.
+     */
+    if (!query.exec("ALTER TABLE address_book ADD COLUMN phone_tokens TEXT")) {
+        return fail("Ошибка добавления колонки телефонов для поиска в БД: " + query.lastError().text());
+    }
+
+    // Колонка только что появилась: один раз заполняем её из phone_list
+    if (!db.transaction()) {
+        return fail("Ошибка начала транзакции в БД: " + db.lastError().text());
+    }
+
+    QSqlQuery select(db);
+    select.setForwardOnly(true);
+    QSqlQuery update(db);
+    update.prepare("UPDATE address_book SET phone_tokens=:phone_tokens WHERE user_id=:user_id");
+
+    if (!select.exec("SELECT user_id, phone_list FROM address_book WHERE phone_list IS NOT NULL AND phone_list <> ''")) {
+        QString errText = select.lastError().text();
+        db.rollback();
+        return fail("Ошибка переноса телефонов в БД: " + errText);
+    }
+    while (select.next()) {
+        const QStringList phones = select.value(1).toString().split(",", Qt::SkipEmptyParts);
+        update.bindValue(":phone_tokens", SearchIndex::phoneTokens(phones.toVector()).join(" "));
+        update.bindValue(":user_id", select.value(0));
+        if (!update.exec()) {
+            QString errText = update.lastError().text();
+            db.rollback();
+            return fail("Ошибка переноса телефонов в БД: " + errText);
+        }
+    }
+    select.finish();
+
+    if (!db.commit()) {
+        return fail("Ошибка фиксации транзакции в БД: " + db.lastError().text());
+    }
+    return true;
+}
+
+bool AddressBookStorage::createChangeLog() {
+    /*
+     * Журнал изменений: по строке на контакт с номером его последнего изменения.
+     * Номера сквозные и растут с каждой записью, так что "что изменилось после seq" - это
+     * поиск по индексу. Строку удалённого контакта журнал оставляет, по ней другие окна узнают об удалении.
+     * Журнал ведут триггеры, поэтому в него попадает любая запись: из окна, импорта, addressbook-cli.
+     * Писатель в SQLite один, поэтому номера идут в порядке коммитов.
+     */
+    const QStringList statements = {
+        "CREATE TABLE IF NOT EXISTS change_log (user_id INTEGER PRIMARY KEY, seq INTEGER NOT NULL)",
+        "CREATE UNIQUE INDEX IF NOT EXISTS change_log_seq_idx ON change_log(seq)",
+
+        "CREATE TRIGGER IF NOT EXISTS address_book_log_insert AFTER INSERT ON address_book BEGIN "
+        "INSERT OR REPLACE INTO change_log(user_id, seq) VALUES (new.user_id, (SELECT IFNULL(MAX(seq), 0) + 1 FROM change_log)); "
+        "END",
+
+        "CREATE TRIGGER IF NOT EXISTS address_book_log_update AFTER UPDATE ON address_book BEGIN "
+        "INSERT OR REPLACE INTO change_log(user_id, seq) VALUES (new.user_id, (SELECT IFNULL(MAX(seq), 0) + 1 FROM change_log)); "
+        "END",
+
+        "CREATE TRIGGER IF NOT EXISTS address_book_log_delete AFTER DELETE ON address_book BEGIN "
+        "INSERT OR REPLACE INTO change_log(user_id, seq) VALUES (old.user_id, (SELECT IFNULL(MAX(seq), 0) + 1 FROM change_log)); "
+        "END"
+    };
+
+    QSqlQuery query(db);
+    for (const QString &statement : statements) {
+        if (!query.exec(statement)) {
+            return fail("Ошибка создания журнала изменений в БД: " + query.lastError().text());
+        }
+    }
+    return true;
+}
+
+bool AddressBookStorage::createMetaTable() {
+    // Сведения о самой БД, а не о контактах: ключ - значение
+    QSqlQuery query(db);
+    if (!query.exec("CREATE TABLE IF NOT EXISTS book_meta (key TEXT PRIMARY KEY, value TEXT)")) {
+        return fail("Ошибка создания таблицы сведений о БД: " + query.lastError().text());
+    }
+    return true;
+}
+
+bool AddressBookStorage::createPhoneTable() {
+    QSqlQuery query(db);
+
+    if (!query.exec("SELECT 1 FROM sqlite_master WHERE type='table' AND name='phone'")) {
+        return fail("Ошибка запроса к БД: " + query.lastError().text());
+    }
+    bool existed = query.next();
+    query.finish();
+
+    // Первичный ключ (user_id, number) даёт телефоны контакта, индекс по number - владельца номера
+    if (!query.exec("CREATE TABLE IF NOT EXISTS phone ("
+                    "user_id INTEGER NOT NULL REFERENCES address_book(user_id) ON DELETE CASCADE, "
+                    "number INTEGER NOT NULL, "
+                    "PRIMARY KEY (user_id, number)) WITHOUT ROWID") ||
+        !query.exec("CREATE INDEX IF NOT EXISTS phone_number_idx ON phone(number)")) {
+        return fail("Ошибка создания таблицы телефонов в БД: " + query.lastError().text());
+    }
+    if (existed) return true;
+
+    // Таблица только что появилась: один раз переносим в неё номера из phone_list
+    if (!db.transaction()) {
+        return fail("Ошибка начала транзакции в БД: " + db.lastError().text());
+    }
+
+    QSqlQuery select(db);
+    select.setForwardOnly(true);
+    QSqlQuery insert(db);
+    insert.prepare("INSERT OR IGNORE INTO phone (user_id, number) VALUES (:user_id, :number)");
+
+    if (!select.exec("SELECT user_id, phone_list FROM address_book WHERE phone_list IS NOT NULL AND phone_list <> ''")) {
+        QString errText = select.lastError().text();
+        db.rollback();
+        return fail("Ошибка переноса телефонов в БД: " + errText);
+    }
+    while (select.next()) {
+        const QStringList phones = select.value(1).toString().split(",", Qt::SkipEmptyParts);
+        for (const QString &phone : phones) {
+            qint64 number = PhoneNumber::toE164(phone);
+            if (number == 0) continue;
+
+            insert.bindValue(":user_id", select.value(0));
+            insert.bindValue(":number", number);
+            if (!insert.exec()) {
+                QString errText = insert.lastError().text();
+                db.rollback();
+                return fail("Ошибка переноса телефонов в БД: " + errText);
+            }
+        }
+    }
+    select.finish();
+
+    if (!db.commit()) {
+        return fail("Ошибка фиксации транзакции в БД: " + db.lastError().text());
+    }
+    return true;
+}
+
+bool AddressBookStorage::createFullTextIndex() {
+    QSqlQuery query(db);
+
+    // Индекс строим заново, только если таблицы FTS ещё не было
+    if (!query.exec("SELECT sql FROM sqlite_master WHERE type='table' AND name='address_book_fts'")) return false;
+    bool existed = query.next();
+    // В индексе прежней версии телефоны лежали как введены (phone_list): такой индекс пересоздаём
+    bool outdated = existed && !query.value(0).toString().contains("phone_tokens");
+    query.finish();
+
+    if (outdated) {
+        const QStringList drops = {
+            "DROP TRIGGER IF EXISTS address_book_fts_insert",
+            "DROP TRIGGER IF EXISTS address_book_fts_delete",
+            "DROP TRIGGER IF EXISTS address_book_fts_update",
+            "DROP TABLE address_book_fts"
+        };
+        for (const QString &drop : drops) {
+            if (!query.exec(drop)) return false;
+        }
+        existed = false;
+    }
+
+    /*
+     * FTS5-таблица с внешним содержимым: сами строки лежат в address_book, а в FTS - только индекс слов.
+     * Телефоны индексируются по phone_tokens, то есть в том же виде, в каком их ищет SearchIndex::queryTokens.
+     * Триггеры поддерживают индекс в актуальном состоянии при любых INSERT/UPDATE/DELETE.
+     */
+    const QStringList statements = {
+        "CREATE VIRTUAL TABLE IF NOT EXISTS address_book_fts USING fts5("
+        "lastname, firstname, patronymic, phone_tokens, email, birthday, "
+        "content='address_book', content_rowid='user_id', tokenize='unicode61 remove_diacritics 2')",
+
+        "CREATE TRIGGER IF NOT EXISTS address_book_fts_insert AFTER INSERT ON address_book BEGIN "
+        "INSERT INTO address_book_fts(rowid, lastname, firstname, patronymic, phone_tokens, email, birthday) "
+        "VALUES (new.user_id, new.lastname, new.firstname, new.patronymic, new.phone_tokens, new.email, new.birthday); "
+        "END",
+
+        "CREATE TRIGGER IF NOT EXISTS address_book_fts_delete AFTER DELETE ON address_book BEGIN "
+        "INSERT INTO address_book_fts(address_book_fts, rowid, lastname, firstname, patronymic, phone_tokens, email, birthday) "
+        "VALUES ('delete', old.user_id, old.lastname, old.firstname, old.patronymic, old.phone_tokens, old.email, old.birthday); "
+        "END",
+
+        "CREATE TRIGGER IF NOT EXISTS address_book_fts_update AFTER UPDATE ON address_book BEGIN "
+        "INSERT INTO address_book_fts(address_book_fts, rowid, lastname, firstname, patronymic, phone_tokens, email, birthday) "
+        "VALUES ('delete', old.user_id, old.lastname, old.firstname, old.patronymic, old.phone_tokens, old.email, old.birthday); "
+        "INSERT INTO address_book_fts(rowid, lastname, firstname, patronymic, phone_tokens, email, birthday) "
+        "VALUES (new.user_id, new.lastname, new.firstname, new.patronymic, new.phone_tokens, new.email, new.birthday); "
+        "END"
+    };
+
+    for (const QString &statement : statements) {
+        if (!query.exec(statement)) return false;
+    }
+
+    // Для уже существующей книги один раз заполняем индекс по всем строкам
+    if (!existed && !query.exec("INSERT INTO address_book_fts(address_book_fts) VALUES ('rebuild')")) return false;
+
+    fullTextQueryStatement = std::make_unique<QSqlQuery>(db);
+    fullTextQueryStatement->setForwardOnly(true);
+    return fullTextQueryStatement->prepare(
+        "SELECT a.user_id, a.lastname, a.firstname, a.patronymic, a.phone_list, a.email, a.birthday, a.version "
+        "FROM address_book_fts f JOIN address_book a ON a.user_id = f.rowid "
+        "WHERE address_book_fts MATCH :query ORDER BY f.rank LIMIT :limit");
+}
+
+bool AddressBookStorage::prepareStatements() {
+    insertQuery = std::make_unique<QSqlQuery>(db);
+    if (!insertQuery->prepare("INSERT INTO address_book (user_id, lastname, firstname, patronymic, phone_list, email, birthday, "
+                              "birth_date, birth_md, phone_tokens) "
+                              "VALUES (NULL, :lastname, :firstname, :patronymic, :phone_list, :email, :birthday, "
+                              ":birth_date, :birth_md, :phone_tokens)")) {
+        return fail("Ошибка подготовки запроса INSERT: " + insertQuery->lastError().text());
+    }
+
+    updateQuery = std::make_unique<QSqlQuery>(db);
+    // Запись обновляется, только если её версия та же, что была прочитана: чужую правку не затираем
+    if (!updateQuery->prepare("UPDATE address_book SET lastname=:lastname, firstname=:firstname, patronymic=:patronymic, "
+                              "phone_list=:phone_list, email=:email, birthday=:birthday, "
+                              "birth_date=:birth_date, birth_md=:birth_md, phone_tokens=:phone_tokens, version=version+1 "
+                              "WHERE user_id=:user_id AND version=:version")) {
+        return fail("Ошибка подготовки запроса UPDATE: " + updateQuery->lastError().text());
+    }
+
+    deleteQuery = std::make_unique<QSqlQuery>(db);
+    // Удаление тоже сверяет версию: запись, изменённую в другом окне, молча не удаляем
+    if (!deleteQuery->prepare("DELETE FROM address_book WHERE user_id=:user_id AND version=:version")) {
+        return fail("Ошибка подготовки запроса DELETE: " + deleteQuery->lastError().text());
+    }
+
+    selectPhonesQuery = std::make_unique<QSqlQuery>(db);
+    selectPhonesQuery->setForwardOnly(true);
+    insertPhoneQuery = std::make_unique<QSqlQuery>(db);
+    deletePhoneQuery = std::make_unique<QSqlQuery>(db);
+    phoneOwnersQuery = std::make_unique<QSqlQuery>(db);
+    phoneOwnersQuery->setForwardOnly(true);
+    if (!selectPhonesQuery->prepare("SELECT number FROM phone WHERE user_id=:user_id") ||
+        !insertPhoneQuery->prepare("INSERT OR IGNORE INTO phone (user_id, number) VALUES (:user_id, :number)") ||
+        !deletePhoneQuery->prepare("DELETE FROM phone WHERE user_id=:user_id AND number=:number") ||
+        !phoneOwnersQuery->prepare("SELECT user_id FROM phone WHERE number=:number")) {
+        return fail("Ошибка подготовки запросов к таблице телефонов");
+    }
+
+    // Колонки перечислены явно, их номера заданы в SelectColumn
+    selectPageQuery = std::make_unique<QSqlQuery>(db);
+    selectPageQuery->setForwardOnly(true);
+    if (!selectPageQuery->prepare("SELECT user_id, lastname, firstname, patronymic, phone_list, email, birthday, version "
+                                  "FROM address_book WHERE user_id > :after_id AND user_id <= :up_to_id "
+                                  "ORDER BY user_id LIMIT :limit")) {
+        return fail("Ошибка подготовки запроса SELECT: " + selectPageQuery->lastError().text());
+    }
+
+    selectItemQuery = std::make_unique<QSqlQuery>(db);
+    selectItemQuery->setForwardOnly(true);
+    if (!selectItemQuery->prepare("SELECT user_id, lastname, firstname, patronymic, phone_list, email, birthday, version "
+                                  "FROM address_book WHERE user_id = :user_id")) {
+        return fail("Ошибка подготовки запроса SELECT: " + selectItemQuery->lastError().text());
+    }
+
+    // Контакты из журнала изменений; у удалённых колонки address_book пустые (LEFT JOIN)
+    changesQuery = std::make_unique<QSqlQuery>(db);
+    changesQuery->setForwardOnly(true);
+    if (!changesQuery->prepare("SELECT c.user_id, a.lastname, a.firstname, a.patronymic, a.phone_list, a.email, a.birthday, a.version, "
+                               "c.seq, a.user_id IS NULL "
+                               "FROM change_log c LEFT JOIN address_book a ON a.user_id = c.user_id "
+                               "WHERE c.seq > :since ORDER BY c.seq LIMIT :limit")) {
+        return fail("Ошибка подготовки запроса к журналу изменений: " + changesQuery->lastError().text());
+    }
+
+    birthdaysQuery = std::make_unique<QSqlQuery>(db);
+    birthdaysQuery->setForwardOnly(true);
+    bornQuery = std::make_unique<QSqlQuery>(db);
+    bornQuery->setForwardOnly(true);
+    if (!birthdaysQuery->prepare("SELECT user_id, lastname, firstname, patronymic, phone_list, email, birthday, version "
+                                 "FROM address_book WHERE birth_md BETWEEN :first AND :last ORDER BY birth_md, user_id") ||
+        !bornQuery->prepare("SELECT user_id, lastname, firstname, patronymic, phone_list, email, birthday, version "
+                            "FROM address_book WHERE birth_date BETWEEN :first AND :last ORDER BY birth_date, user_id")) {
+        return fail("Ошибка подготовки запросов по датам рождения");
+    }
+    return true;
+}
+
+bool AddressBookStorage::setFullSync(bool fullSync) {
+    QSqlQuery query(db);
+    if (!query.exec(fullSync ? "PRAGMA synchronous=FULL" : "PRAGMA synchronous=NORMAL")) {
+        return fail("Ошибка настройки БД (synchronous): " + query.lastError().text());
+    }
+    return true;
+}
+
+bool AddressBookStorage::beginTransaction() {
+    TraceScope trace("sql.begin");
+
+    if (!db.transaction()) {
+        return fail("Ошибка начала транзакции в БД: " + db.lastError().text());
+    }
+    return true;
+}
+
+bool AddressBookStorage::commit() {
+    TraceScope trace("sql.commit");
+
+    if (!db.commit()) {
+        return fail("Ошибка фиксации транзакции в БД: " + db.lastError().text());
+    }
+    return true;
+}
+
+bool AddressBookStorage::rollback() {
+    if (!db.rollback()) {
+        return fail("Ошибка отката транзакции в БД: " + db.lastError().text());
+    }
+    return true;
+}
+
+bool AddressBookStorage::maxUserId(qint64 &userId) {
+    QSqlQuery query(db);
+    if (!query.exec("SELECT MAX(user_id) FROM address_book") || !query.next()) {
+        return fail("Ошибка запроса к таблице в БД: " + query.lastError().text());
+    }
+    // Для пустой таблицы MAX вернёт NULL, toLongLong() даст 0
+    userId = query.value(0).toLongLong();
+    return true;
+}
+
+bool AddressBookStorage::loadPage(qint64 afterUserId, qint64 upToUserId, int limit, QVector<Item> &items) {
+    TraceScope trace("sql.loadPage");
+
+    selectPageQuery->bindValue(":after_id", afterUserId);
+    selectPageQuery->bindValue(":up_to_id", upToUserId);
+    selectPageQuery->bindValue(":limit", limit);
+
+    if (!selectPageQuery->exec()) {
+        return fail("Ошибка запроса к таблице в БД: " + selectPageQuery->lastError().text());
+    }
+
+    while (selectPageQuery->next()) {
+        items.append(readItem(*selectPageQuery));
+    }
+
+    // Отпускаем курсор, чтобы запрос не держал блокировку чтения
+    selectPageQuery->finish();
+    return true;
+}
+
+bool AddressBookStorage::insertItem(const Item &item, QString &userId) {
+    TraceScope trace("sql.insert");
+
+    insertQuery->bindValue(":lastname", item.userLastName);
+    insertQuery->bindValue(":firstname", item.userFirstName);
+    insertQuery->bindValue(":patronymic", item.userPatronymicName);
+    insertQuery->bindValue(":phone_list", QStringList::fromVector(item.userPhonesList).join(",")); // В БД добавляем номера разделяя их запятыми
+    insertQuery->bindValue(":email", item.userEmail);
+    insertQuery->bindValue(":birthday", item.userBirthday);
+    const QDate date = birthDate(item.userBirthday);
+    insertQuery->bindValue(":birth_date", birthDateValue(date));
+    insertQuery->bindValue(":birth_md", birthMonthDayValue(date));
+    insertQuery->bindValue(":phone_tokens", SearchIndex::phoneTokens(item.userPhonesList).join(" "));
+
+    if (!insertQuery->exec()) {
+        return fail("Ошибка добавления записи в таблицу БД: " + insertQuery->lastError().text());
+    }
+
+    // Уникальный идентификатор нового контакта (LAST_INSERT_ID)
+    userId = insertQuery->lastInsertId().toString();
+    return syncPhones(userId, item.userPhonesList);
+}
+
+bool AddressBookStorage::updateItem(const Item &item, bool &written) {
+    TraceScope trace("sql.update");
+    written = false;
+
+    updateQuery->bindValue(":lastname", item.userLastName);
+    updateQuery->bindValue(":firstname", item.userFirstName);
+    updateQuery->bindValue(":patronymic", item.userPatronymicName);
+    updateQuery->bindValue(":phone_list", QStringList::fromVector(item.userPhonesList).join(","));
+    updateQuery->bindValue(":email", item.userEmail);
+    updateQuery->bindValue(":birthday", item.userBirthday);
+    const QDate date = birthDate(item.userBirthday);
+    updateQuery->bindValue(":birth_date", birthDateValue(date));
+    updateQuery->bindValue(":birth_md", birthMonthDayValue(date));
+    updateQuery->bindValue(":phone_tokens", SearchIndex::phoneTokens(item.userPhonesList).join(" "));
+    updateQuery->bindValue(":user_id", item.userId);
+    updateQuery->bindValue(":version", item.version);
+
+    if (!updateQuery->exec()) {
+        return fail("Ошибка обновления записи в таблице БД: " + updateQuery->lastError().text());
+    }
+
+    // Ни одной строки: запись изменили или удалили после того, как мы её прочитали
+    written = updateQuery->numRowsAffected() > 0;
+    if (!written) return true;
+    return syncPhones(item.userId, item.userPhonesList);
+}
+
+bool AddressBookStorage::loadItem(const QString &userId, Item &item, bool &found) {
+    selectItemQuery->bindValue(":user_id", userId);
+    if (!selectItemQuery->exec()) {
+        return fail("Ошибка запроса к таблице в БД: " + selectItemQuery->lastError().text());
+    }
+    found = selectItemQuery->next();
+    if (found) item = readItem(*selectItemQuery);
+    selectItemQuery->finish();
+    return true;
+}
+
+bool AddressBookStorage::dataVersion(qint64 &version) {
+    QSqlQuery query(db);
+    if (!query.exec("PRAGMA data_version") || !query.next()) {
+        return fail("Ошибка запроса к БД (data_version): " + query.lastError().text());
+    }
+    version = query.value(0).toLongLong();
+    return true;
+}
+
+bool AddressBookStorage::lastChange(qint64 &seq) {
+    QSqlQuery query(db);
+    if (!query.exec("SELECT MAX(seq) FROM change_log") || !query.next()) {
+        return fail("Ошибка запроса к журналу изменений: " + query.lastError().text());
+    }
+    // Пустой журнал - NULL, то есть 0
+    seq = query.value(0).toLongLong();
+    return true;
+}
+
+bool AddressBookStorage::snapshotId(QString &id) {
+    QSqlQuery query(db);
+    if (!query.exec("SELECT value FROM book_meta WHERE key='snapshot_id'")) {
+        return fail("Ошибка запроса к БД: " + query.lastError().text());
+    }
+    id = query.next() ? query.value(0).toString() : QString();
+    return true;
+}
+
+bool AddressBookStorage::setSnapshotId(const QString &id) {
+    QSqlQuery query(db);
+    query.prepare("INSERT OR REPLACE INTO book_meta (key, value) VALUES ('snapshot_id', :value)");
+    query.bindValue(":value", id);
+    if (!query.exec()) {
+        return fail("Ошибка записи id снимка книги в БД: " + query.lastError().text());
+    }
+    return true;
+}
+
+bool AddressBookStorage::changesSince(qint64 seq, int limit, QVector<Item> &items, QVector<QString> &removedIds, qint64 &lastSeq) {
+    TraceScope trace("sql.changes");
+
+    changesQuery->bindValue(":since", seq);
+    changesQuery->bindValue(":limit", limit);
+    if (!changesQuery->exec()) {
+        return fail("Ошибка запроса к журналу изменений: " + changesQuery->lastError().text());
+    }
+
+    lastSeq = seq;
+    while (changesQuery->next()) {
+        lastSeq = changesQuery->value(SelectVersion + 1).toLongLong();
+        if (changesQuery->value(SelectVersion + 2).toBool()) {
+            removedIds.append(changesQuery->value(SelectUserId).toString());
+        } else {
+            items.append(readItem(*changesQuery));
+        }
+    }
+    changesQuery->finish();
+    return true;
+}
+
+bool AddressBookStorage::upcomingBirthdays(const QDate &from, int days, QVector<Item> &items) {
+    TraceScope trace("sql.birthdays");
+
+    // Второй диапазон (после Нового года) идёт после первого, так что контакты упорядочены по дню рождения
+    for (const BirthdayIndex::MonthDayRange &range : BirthdayIndex::monthDayRanges(from, days)) {
+        birthdaysQuery->bindValue(":first", range.first);
+        birthdaysQuery->bindValue(":last", range.last);
+        if (!birthdaysQuery->exec()) {
+            return fail("Ошибка запроса дней рождения из БД: " + birthdaysQuery->lastError().text());
+        }
+        while (birthdaysQuery->next()) {
+            items.append(readItem(*birthdaysQuery));
+        }
+        birthdaysQuery->finish();
+    }
+    return true;
+}
+
+bool AddressBookStorage::bornBetween(const QDate &first, const QDate &last, QVector<Item> &items) {
+    TraceScope trace("sql.born");
+    if (!first.isValid() || !last.isValid() || last < first) return true;
+
+    bornQuery->bindValue(":first", birthDateValue(first));
+    bornQuery->bindValue(":last", birthDateValue(last));
+    if (!bornQuery->exec()) {
+        return fail("Ошибка запроса дат рождения из БД: " + bornQuery->lastError().text());
+    }
+    while (bornQuery->next()) {
+        items.append(readItem(*bornQuery));
+    }
+    bornQuery->finish();
+    return true;
+}
+
+QDate AddressBookStorage::birthDate(const QString &birthday) {
+    // Те же правила, что и у ContactStore: датой считается только dd-MM-yyyy без лишних символов
+    if (birthday.size() != 10) return QDate();
+    return QDate::fromString(birthday, "dd-MM-yyyy");
+}
+
+bool AddressBookStorage::removeItem(const QString &userId, quint32 version, bool &written) {
+    TraceScope trace("sql.delete");
+    written = false;
+
+    deleteQuery->bindValue(":user_id", userId);
+    deleteQuery->bindValue(":version", version);
+
+    if (!deleteQuery->exec()) {
+        return fail("Ошибка удаления записи из БД: " + deleteQuery->lastError().text());
+    }
+    written = deleteQuery->numRowsAffected() > 0;
+    return true;
+}
+
+bool AddressBookStorage::syncPhones(const QString &userId, const QVector<QString> &phones) {
+    QSet<qint64> wanted;
+    for (const QString &phone : phones) {
+        qint64 number = PhoneNumber::toE164(phone);
+        if (number != 0) wanted.insert(number);
+    }
+
+    // Что уже лежит в БД у этого контакта (по первичному ключу, без просмотра таблицы)
+    QSet<qint64> stored;
+    selectPhonesQuery->bindValue(":user_id", userId);
+    if (!selectPhonesQuery->exec()) {
+        return fail("Ошибка запроса телефонов из БД: " + selectPhonesQuery->lastError().text());
+    }
+    while (selectPhonesQuery->next()) {
+        stored.insert(selectPhonesQuery->value(0).toLongLong());
+    }
+    selectPhonesQuery->finish();
+
+    // Пишем только разницу: добавление одного номера - одна вставка в phone (строка address_book всё равно переписывается)
+    for (qint64 number : std::as_const(stored)) {
+        if (wanted.contains(number)) continue;
+        deletePhoneQuery->bindValue(":user_id", userId);
+        deletePhoneQuery->bindValue(":number", number);
+        if (!deletePhoneQuery->exec()) {
+            return fail("Ошибка удаления телефона из БД: " + deletePhoneQuery->lastError().text());
+        }
+    }
+    for (qint64 number : std::as_const(wanted)) {
+        if (stored.contains(number)) continue;
+        if (!addPhone(userId, number)) return false;
+    }
+    return true;
+}
+
+bool AddressBookStorage::addPhone(const QString &userId, qint64 number) {
+    insertPhoneQuery->bindValue(":user_id", userId);
+    insertPhoneQuery->bindValue(":number", number);
+    if (!insertPhoneQuery->exec()) {
+        return fail("Ошибка добавления телефона в БД: " + insertPhoneQuery->lastError().text());
+    }
+    return true;
+}
+
+bool AddressBookStorage::findPhoneOwners(qint64 number, QVector<QString> &userIds) {
+    TraceScope trace("sql.phoneOwners");
+
+    phoneOwnersQuery->bindValue(":number", number);
+    if (!phoneOwnersQuery->exec()) {
+        return fail("Ошибка поиска владельца телефона в БД: " + phoneOwnersQuery->lastError().text());
+    }
+    while (phoneOwnersQuery->next()) {
+        userIds.append(phoneOwnersQuery->value(0).toString());
+    }
+    phoneOwnersQuery->finish();
+    return true;
+}
+
+bool AddressBookStorage::hasFullTextSearch() const {
+    return fullTextAvailable;
+}
+
+bool AddressBookStorage::compact() {
+    TraceScope trace("sql.compact");
+
+    const QStringList statements = {
+        fullTextAvailable ? "INSERT INTO address_book_fts(address_book_fts) VALUES ('optimize')" : QString(),
+        "VACUUM",
+        "PRAGMA wal_checkpoint(TRUNCATE)",
+        "PRAGMA optimize"
+    };
+
+    QSqlQuery query(db);
+    for (const QString &statement : statements) {
+        if (statement.isEmpty()) continue;
+        if (!query.exec(statement)) {
+            return fail("Ошибка обслуживания БД (" + statement + "): " + query.lastError().text());
+        }
+        query.finish();
+    }
+    return true;
+}
+
+QString AddressBookStorage::fullTextQuery(const QString &query) {
+    QStringList groups;
+
+    const QStringList terms = query.split(",", Qt::SkipEmptyParts);
+    for (const QString &term : terms) {
+        // Слова разбираем так же, как и в индексе в памяти
+        const QStringList tokens = SearchIndex::queryTokens(term);
+
+        QStringList prefixes;
+        for (QString token : tokens) {
+            if (token.isEmpty()) continue;
+            // Слово в кавычках, чтобы символы из синтаксиса FTS5 не трактовались как операторы
+            token.replace("\"", "\"\"");
+            prefixes.append("\"" + token + "\"*");
+        }
+        if (!prefixes.isEmpty()) groups.append("(" + prefixes.join(" AND ") + ")");
+    }
+    return groups.join(" OR ");
+}
+
+bool AddressBookStorage::searchFullText(const QString &query, int limit, QVector<Item> &items) {
+    TraceScope trace("sql.search");
+
+    if (!fullTextAvailable) {
+        return fail("Полнотекстовый поиск недоступен: SQLite собран без FTS5.");
+    }
+
+    QString matchQuery = fullTextQuery(query);
+    if (matchQuery.isEmpty()) return true;
+
+    fullTextQueryStatement->bindValue(":query", matchQuery);
+    fullTextQueryStatement->bindValue(":limit", limit);
+    if (!fullTextQueryStatement->exec()) {
+        return fail("Ошибка полнотекстового поиска в БД: " + fullTextQueryStatement->lastError().text());
+    }
+
+    while (fullTextQueryStatement->next()) {
+        items.append(readItem(*fullTextQueryStatement));
+    }
+    fullTextQueryStatement->finish();
+    return true;
+}
+
+bool AddressBookStorage::scanItems(const QString &query, const std::function<bool(const Item &)> &function) {
+    TraceScope trace("sql.scan");
+
+    QString matchQuery = query.trimmed().isEmpty() ? QString() : fullTextQuery(query);
+    bool filterInDatabase = !matchQuery.isEmpty() && fullTextAvailable;
+
+    // Курсор только вперёд: драйвер не держит уже прочитанные строки
+    QSqlQuery select(db);
+    select.setForwardOnly(true);
+    if (filterInDatabase) {
+        select.prepare("SELECT a.user_id, a.lastname, a.firstname, a.patronymic, a.phone_list, a.email, a.birthday, a.version "
+                       "FROM address_book_fts f JOIN address_book a ON a.user_id = f.rowid "
+                       "WHERE address_book_fts MATCH :query ORDER BY a.user_id");
+        select.bindValue(":query", matchQuery);
+    } else {
+        select.prepare("SELECT user_id, lastname, firstname, patronymic, phone_list, email, birthday, version "
+                       "FROM address_book ORDER BY user_id");
+    }
+    if (!select.exec()) {
+        return fail("Ошибка запроса к таблице в БД: " + select.lastError().text());
+    }
+
+    // Без FTS5 фильтруем на лету по тем же правилам, что и индекс в памяти
+    bool filterHere = !query.trimmed().isEmpty() && !filterInDatabase;
+
+    while (select.next()) {
+        Item item = readItem(select);
+        if (filterHere && !SearchIndex::matches(item, query)) continue;
+        if (!function(item)) break;
+    }
+    select.finish();
+    return true;
+}
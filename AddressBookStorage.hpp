@@ -0,0 +1,194 @@
+#ifndef ADDRESSBOOKSTORAGE_H
+#define ADDRESSBOOKSTORAGE_H
+
+#include <QDate>
+#include <QString>
+#include <QVector>
+#include <QtSql/QSqlDatabase>
+#include <QSqlQuery>
+#include <functional>
+#include <memory>
+
+#include "Item.hpp"
+
+/*
+ * Долгоживущая сессия работы с БД адресной книги.
+ * Соединение открывается один раз, PRAGMA применяются один раз, а запросы
+ * INSERT/UPDATE/DELETE/SELECT подготавливаются заранее и потом только
+ * получают новые значения параметров.
+ *
+ * Методы возвращают false при ошибке, текст ошибки можно получить через lastError().
+ */
+class AddressBookStorage {
+public:
+    // Путь к БД по умолчанию
+    static const QString DefaultDatabasePath;
+
+    explicit AddressBookStorage(const QString &connectionName = "address_book");
+    ~AddressBookStorage();
+
+    AddressBookStorage(const AddressBookStorage &) = delete;
+    AddressBookStorage &operator=(const AddressBookStorage &) = delete;
+
+    // Открыть БД, настроить её, создать таблицу (если её нет) и подготовить запросы
+    bool open(const QString &databasePath = DefaultDatabasePath);
+    void close();
+    bool isOpen() const;
+
+    // Путь к открытой БД (нужен, чтобы другие потоки открыли свои соединения к тому же файлу)
+    QString databasePath() const;
+
+    QString lastError() const;
+
+    /*
+     * synchronous=FULL: fsync журнала на каждый коммит, записанная транзакция переживёт сбой питания.
+     * По умолчанию NORMAL: целостность та же, но последние транзакции при сбое могут пропасть.
+     */
+    bool setFullSync(bool fullSync);
+
+    // Транзакции, чтобы пачку изменений записать одним fsync
+    bool beginTransaction();
+    bool commit();
+    bool rollback();
+
+    // Наибольший user_id в таблице (0, если таблица пуста)
+    bool maxUserId(qint64 &userId);
+
+    /*
+     * Прочитать страницу контактов с user_id в диапазоне (afterUserId, upToUserId], упорядоченных по user_id.
+     * Это keyset-пагинация: каждая страница начинается поиском по первичному ключу, без OFFSET,
+     * поэтому стоимость страницы не зависит от её номера.
+     */
+    bool loadPage(qint64 afterUserId, qint64 upToUserId, int limit, QVector<Item> &items);
+
+    // Вставить новый контакт, в userId вернётся выданный базой user_id
+    bool insertItem(const Item &item, QString &userId);
+
+    /*
+     * Обновить контакт по его user_id. Запись пишется, только если в БД та же версия, что в item.version,
+     * и версия при этом растёт на 1. Иначе её уже изменили или удалили в другом окне:
+     * written = false, и в БД ничего не меняется.
+     */
+    bool updateItem(const Item &item, bool &written);
+
+    // Прочитать один контакт по user_id (found = false, если его нет)
+    bool loadItem(const QString &userId, Item &item, bool &found);
+
+    /*
+     * Удалить контакт по user_id (его телефоны удалятся каскадно). Как и при обновлении, запись удаляется,
+     * только если в БД та же версия, что была прочитана: written = false - запись успели изменить или уже удалили.
+     */
+    bool removeItem(const QString &userId, quint32 version, bool &written);
+
+    /*
+     * Телефоны хранятся ещё и в отдельной таблице phone (user_id, number) с номером в E.164 как INTEGER
+     * и индексом по номеру. Колонка phone_list остаётся как готовая строка для таблицы,
+     * а FTS индексирует phone_tokens - цифры номеров с кодом страны и без него.
+     */
+
+    // Добавить контакту один номер: одна строка в phone
+    bool addPhone(const QString &userId, qint64 number);
+
+    // Кому принадлежит номер (поиск по индексу, O(log n))
+    bool findPhoneOwners(qint64 number, QVector<QString> &userIds);
+
+    /*
+     * Изменения, сделанные другими соединениями (другие окна, импорт, addressbook-cli).
+     * PRAGMA data_version меняется, когда кто-то другой закоммитил в файл; это дешёвая проверка без чтения таблиц.
+     * Что именно поменялось, видно по журналу change_log: по строке на контакт с номером последнего изменения.
+     */
+    bool dataVersion(qint64 &version);
+
+    // Номер последнего изменения в журнале (0, если журнал пуст)
+    bool lastChange(qint64 &seq);
+
+    // id последнего записанного снимка книги (ContactSnapshot); пустой, если снимок из этой БД не писали
+    bool snapshotId(QString &id);
+    bool setSnapshotId(const QString &id);
+
+    // Контакты, изменённые после seq (не больше limit, по порядку изменений): живые - в items,
+    // удалённые - в removedIds; lastSeq - номер последнего прочитанного изменения
+    bool changesSince(qint64 seq, int limit, QVector<Item> &items, QVector<QString> &removedIds, qint64 &lastSeq);
+
+    /*
+     * Дата рождения хранится ещё и как настоящая дата: birth_date (ISO yyyy-MM-dd) и birth_md (месяц * 100 + день),
+     * обе с индексом. Колонка birthday остаётся текстом как его ввели (там может быть и не дата).
+     * Запросы ниже - поиск по индексу и чтение найденного, O(log n + k), без разбора дат по всей таблице.
+     */
+
+    // Контакты с днём рождения в окне из days дней начиная с from (через Новый год - двумя диапазонами), по дню рождения
+    bool upcomingBirthdays(const QDate &from, int days, QVector<Item> &items);
+
+    // Контакты, родившиеся в [first, last], по дате рождения
+    bool bornBetween(const QDate &first, const QDate &last, QVector<Item> &items);
+
+    // Дата рождения из текста dd-MM-yyyy (пустая QDate, если это не дата)
+    static QDate birthDate(const QString &birthday);
+
+    // Есть ли полнотекстовый индекс FTS5 (SQLite может быть собран без него)
+    bool hasFullTextSearch() const;
+
+    /*
+     * Поиск прямо в БД через FTS5, без загрузки книги в память.
+     * Синтаксис запроса тот же, что и у SearchIndex: термины через запятую - ИЛИ,
+     * слова через пробел - И, каждое слово - префикс. Результаты упорядочены по релевантности (bm25),
+     * возвращается не больше limit контактов.
+     */
+    bool searchFullText(const QString &query, int limit, QVector<Item> &items);
+
+    /*
+     * Пройти по контактам одним forward-only курсором в порядке user_id, не собирая их в память.
+     * query - фильтр в синтаксисе поиска (пустой - все контакты). Если function вернёт false, обход прекращается.
+     */
+    bool scanItems(const QString &query, const std::function<bool(const Item &)> &function);
+
+    /*
+     * Обслуживание файла БД: слить сегменты индекса FTS5, пересобрать файл без пустых страниц (VACUUM),
+     * обнулить журнал WAL и обновить статистику планировщика. Долгая операция, пишет в БД монопольно.
+     */
+    bool compact();
+
+    // Перевести пользовательский запрос в синтаксис MATCH для FTS5
+    static QString fullTextQuery(const QString &query);
+
+private:
+    bool applyPragmas();
+    bool createSchema();
+    bool addVersionColumn();
+    bool addBirthDateColumns();
+    bool addPhoneTokensColumn();
+    bool createChangeLog();
+    bool createMetaTable();
+    bool createFullTextIndex();
+    bool createPhoneTable();
+
+    // Привести строки phone контакта к списку номеров: удалить лишние, добавить недостающие
+    bool syncPhones(const QString &userId, const QVector<QString> &phones);
+    bool prepareStatements();
+
+    // Запомнить текст ошибки и вернуть false
+    bool fail(const QString &errText);
+
+    QString connectionName;
+    QSqlDatabase db;
+    QString errorText;
+
+    // Подготовленные запросы живут столько же, сколько соединение
+    std::unique_ptr<QSqlQuery> insertQuery;
+    std::unique_ptr<QSqlQuery> updateQuery;
+    std::unique_ptr<QSqlQuery> deleteQuery;
+    std::unique_ptr<QSqlQuery> selectPageQuery;
+    std::unique_ptr<QSqlQuery> selectItemQuery;
+    std::unique_ptr<QSqlQuery> changesQuery;
+    std::unique_ptr<QSqlQuery> birthdaysQuery;
+    std::unique_ptr<QSqlQuery> bornQuery;
+    std::unique_ptr<QSqlQuery> fullTextQueryStatement;
+    std::unique_ptr<QSqlQuery> selectPhonesQuery;
+    std::unique_ptr<QSqlQuery> insertPhoneQuery;
+    std::unique_ptr<QSqlQuery> deletePhoneQuery;
+    std::unique_ptr<QSqlQuery> phoneOwnersQuery;
+
+    bool fullTextAvailable = false;
+};
+
+#endif // ADDRESSBOOKSTORAGE_H
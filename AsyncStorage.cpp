@@ -0,0 +1,237 @@
+#include "AsyncStorage.hpp"
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QtConcurrent/QtConcurrentRun>
+
+AsyncStorage::AsyncStorage(const QString &connectionName) : connectionName(connectionName) {
+    // Один поток, который не завершается по простою: соединение SQLite привязано к потоку, где создано
+    pool.setMaxThreadCount(1);
+    pool.setExpiryTimeout(-1);
+}
+
+AsyncStorage::~AsyncStorage() {
+    // Закрываем соединение там же, где открывали, после всех поставленных в очередь операций
+    QFuture<void> closing = QtConcurrent::run(&pool, [this]() { storage.reset(); });
+    closing.waitForFinished();
+    pool.waitForDone();
+}
+
+template<typename Function>
+QFuture<StorageReply> AsyncStorage::run(Function function) {
+    return QtConcurrent::run(&pool, [this, function]() {
+        QElapsedTimer timer;
+        timer.start();
+
+        StorageReply reply;
+        if (!storage || !storage->isOpen()) {
+            reply.ok = false;
+            reply.errorText = "Нет соединения с БД.";
+        } else {
+            function(*storage, reply);
+        }
+
+        histogram.record(timer.nsecsElapsed() / 1000);
+        return reply;
+    });
+}
+
+QFuture<StorageReply> AsyncStorage::open(const QString &databasePath) {
+    return QtConcurrent::run(&pool, [this, databasePath]() {
+        StorageReply reply;
+        storage = std::make_unique<AddressBookStorage>(connectionName);
+        if (!storage->open(databasePath)) {
+            reply.ok = false;
+            reply.errorText = storage->lastError();
+        }
+
+        QMutexLocker locker(&infoMutex);
+        opened = reply.ok;
+        fullTextSearch = reply.ok && storage->hasFullTextSearch();
+        path = databasePath;
+        return reply;
+    });
+}
+
+bool AsyncStorage::isOpen() const {
+    QMutexLocker locker(&infoMutex);
+    return opened;
+}
+
+QString AsyncStorage::databasePath() const {
+    QMutexLocker locker(&infoMutex);
+    return path;
+}
+
+bool AsyncStorage::hasFullTextSearch() const {
+    QMutexLocker locker(&infoMutex);
+    return fullTextSearch;
+}
+
+QFuture<StorageReply> AsyncStorage::setFullSync(bool fullSync) {
+    return run([fullSync](AddressBookStorage &storage, StorageReply &reply) {
+        if (!storage.setFullSync(fullSync)) {
+            reply.ok = false;
+            reply.errorText = storage.lastError();
+        }
+    });
+}
+
+QFuture<StorageReply> AsyncStorage::save(const QVector<QString> &removedIds, const QVector<quint32> &removedVersions,
+                                         const QVector<Item> &items) {
+    return run([removedIds, removedVersions, items](AddressBookStorage &storage, StorageReply &reply) {
+        // Если что-то не записалось, откатываем всю транзакцию
+        auto fail = [&]() {
+            reply.ok = false;
+            reply.errorText = storage.lastError();
+            reply.userIds.clear();
+            reply.versions.clear();
+            reply.items.clear();
+            reply.removedIds.clear();
+            reply.conflicts = 0;
+            storage.rollback();
+        };
+
+        if (!storage.beginTransaction()) {
+            reply.ok = false;
+            reply.errorText = storage.lastError();
+            return;
+        }
+
+        for (int i = 0; i < removedIds.size(); ++i) {
+            bool written = false;
+            if (!storage.removeItem(removedIds[i], removedVersions.value(i), written)) return fail();
+            if (written) continue;
+
+            // Запись изменили в другом окне после того, как мы её прочитали: она остаётся, и в модель вернётся
+            // её текущее содержимое. Если её там уже удалили, удалять нечего и конфликта нет.
+            Item current;
+            bool found = false;
+            if (!storage.loadItem(removedIds[i], current, found)) return fail();
+            if (!found) continue;
+            reply.items.append(current);
+            ++reply.conflicts;
+        }
+
+        reply.userIds.reserve(items.size());
+        reply.versions.reserve(items.size());
+        for (const Item &item : items) {
+            QString userId;
+            if (item.state == ItemState::Added) {
+                if (!storage.insertItem(item, userId)) return fail();
+                reply.userIds.append(userId);
+                reply.versions.append(1);
+                continue;
+            }
+
+            bool written = false;
+            if (!storage.updateItem(item, written)) return fail();
+            reply.userIds.append(userId);
+            reply.versions.append(written ? item.version + 1 : 0);
+            if (written) continue;
+
+            // Запись изменили в другом окне раньше нас: побеждает то, что уже в БД
+            Item current;
+            bool found = false;
+            if (!storage.loadItem(item.userId, current, found)) return fail();
+            if (found) {
+                reply.items.append(current);
+            } else {
+                reply.removedIds.append(item.userId);
+            }
+            ++reply.conflicts;
+        }
+
+        if (!storage.commit()) fail();
+    });
+}
+
+QFuture<StorageReply> AsyncStorage::insertItem(const Item &item) {
+    Item added = item;
+    added.state = ItemState::Added;
+    return save({}, {}, {added});
+}
+
+QFuture<StorageReply> AsyncStorage::updateItem(const Item &item) {
+    Item modified = item;
+    modified.state = ItemState::Modified;
+    return save({}, {}, {modified});
+}
+
+QFuture<StorageReply> AsyncStorage::removeItem(const QString &userId, quint32 version) {
+    return save({userId}, {version}, {});
+}
+
+QFuture<StorageReply> AsyncStorage::loadPage(qint64 afterUserId, qint64 upToUserId, int limit) {
+    return run([afterUserId, upToUserId, limit](AddressBookStorage &storage, StorageReply &reply) {
+        if (!storage.loadPage(afterUserId, upToUserId, limit, reply.items)) {
+            reply.ok = false;
+            reply.errorText = storage.lastError();
+        }
+    });
+}
+
+QFuture<StorageReply> AsyncStorage::searchFullText(const QString &query, int limit) {
+    return run([query, limit](AddressBookStorage &storage, StorageReply &reply) {
+        if (!storage.searchFullText(query, limit, reply.items)) {
+            reply.ok = false;
+            reply.errorText = storage.lastError();
+        }
+    });
+}
+
+QFuture<StorageReply> AsyncStorage::findPhoneOwners(qint64 number) {
+    return run([number](AddressBookStorage &storage, StorageReply &reply) {
+        if (!storage.findPhoneOwners(number, reply.userIds)) {
+            reply.ok = false;
+            reply.errorText = storage.lastError();
+        }
+    });
+}
+
+QFuture<StorageReply> AsyncStorage::upcomingBirthdays(const QDate &from, int days) {
+    return run([from, days](AddressBookStorage &storage, StorageReply &reply) {
+        if (!storage.upcomingBirthdays(from, days, reply.items)) {
+            reply.ok = false;
+            reply.errorText = storage.lastError();
+        }
+    });
+}
+
+QFuture<StorageReply> AsyncStorage::lastChange() {
+    return run([](AddressBookStorage &storage, StorageReply &reply) {
+        if (!storage.lastChange(reply.changeSeq) || !storage.snapshotId(reply.snapshotId)) {
+            reply.ok = false;
+            reply.errorText = storage.lastError();
+        }
+    });
+}
+
+QFuture<StorageReply> AsyncStorage::setSnapshotId(const QString &id) {
+    return run([id](AddressBookStorage &storage, StorageReply &reply) {
+        if (!storage.setSnapshotId(id)) {
+            reply.ok = false;
+            reply.errorText = storage.lastError();
+        }
+    });
+}
+
+QFuture<StorageReply> AsyncStorage::pollChanges(qint64 since, int limit, qint64 knownDataVersion) {
+    return run([since, limit, knownDataVersion](AddressBookStorage &storage, StorageReply &reply) {
+        reply.changeSeq = since;
+        if (!storage.dataVersion(reply.dataVersion)) {
+            reply.ok = false;
+            reply.errorText = storage.lastError();
+            return;
+        }
+        if (reply.dataVersion == knownDataVersion) return;
+
+        if (!storage.changesSince(since, limit, reply.items, reply.removedIds, reply.changeSeq)) {
+            reply.ok = false;
+            reply.errorText = storage.lastError();
+        }
+    });
+}
+
+const LatencyHistogram &AsyncStorage::latency() const {
+    return histogram;
+}
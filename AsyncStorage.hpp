@@ -0,0 +1,124 @@
+#ifndef ASYNCSTORAGE_H
+#define ASYNCSTORAGE_H
+
+#include <QFuture>
+#include <QMutex>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+#include <memory>
+
+#include "Item.hpp"
+#include "AddressBookStorage.hpp"
+#include "LatencyHistogram.hpp"
+
+// Результат операции с БД
+struct StorageReply {
+    bool ok = true;
+    QString errorText;
+
+    // Найденные или прочитанные контакты
+    QVector<Item> items;
+
+    // save: user_id для каждой записанной записи (новые - выданный базой, у изменённых - пусто);
+    // findPhoneOwners: владельцы номера
+    QVector<QString> userIds;
+
+    // save: версия каждой записи в БД после сохранения (0 - запись не записана: её успели изменить в другом окне).
+    // Такие записи - конфликты, их текущее содержимое из БД лежит в items или, если их удалили, в removedIds.
+    // Удаление записи, которую успели изменить, тоже конфликт: запись остаётся в БД и возвращается в items.
+    QVector<quint32> versions;
+    int conflicts = 0;
+
+    // pollChanges: user_id контактов, удалённых другими соединениями
+    QVector<QString> removedIds;
+
+    // pollChanges: номер последнего прочитанного изменения журнала и PRAGMA data_version
+    qint64 changeSeq = 0;
+    qint64 dataVersion = 0;
+
+    // lastChange: id последнего снимка книги, записанного из этой БД
+    QString snapshotId;
+};
+
+/*
+ * Асинхронная обёртка над AddressBookStorage.
+ * Сессия БД живёт в отдельном потоке (пул из одного потока, который не завершается),
+ * все запросы выполняются там по очереди, а вызывающий сразу получает QFuture.
+ * GUI продолжает работу в QFuture::then(this, ...), так что цикл событий не ждёт диска.
+ * Операции выполняются строго в порядке вызова: поиск после save увидит сохранённое.
+ */
+class AsyncStorage {
+public:
+    explicit AsyncStorage(const QString &connectionName = "address_book");
+
+    // Дожидается всех операций и закрывает соединение в потоке БД
+    ~AsyncStorage();
+
+    AsyncStorage(const AsyncStorage &) = delete;
+    AsyncStorage &operator=(const AsyncStorage &) = delete;
+
+    QFuture<StorageReply> open(const QString &databasePath = AddressBookStorage::DefaultDatabasePath);
+
+    // Сведения об открытой БД (известны после завершения open)
+    bool isOpen() const;
+    QString databasePath() const;
+    bool hasFullTextSearch() const;
+
+    // fsync на каждый коммит (см. AddressBookStorage::setFullSync)
+    QFuture<StorageReply> setFullSync(bool fullSync);
+
+    /*
+     * Одна транзакция: удалить removedIds (removedVersions - их прочитанные версии), затем вставить
+     * (state == Added) или обновить items. Ни обновление, ни удаление не затирают чужую более новую версию
+     * записи: такая запись пропускается (конфликт), а в ответ кладётся то, что сейчас лежит в БД.
+     */
+    QFuture<StorageReply> save(const QVector<QString> &removedIds, const QVector<quint32> &removedVersions,
+                               const QVector<Item> &items);
+
+    QFuture<StorageReply> insertItem(const Item &item);
+    QFuture<StorageReply> updateItem(const Item &item);
+    QFuture<StorageReply> removeItem(const QString &userId, quint32 version);
+
+    QFuture<StorageReply> loadPage(qint64 afterUserId, qint64 upToUserId, int limit);
+    QFuture<StorageReply> searchFullText(const QString &query, int limit);
+    QFuture<StorageReply> findPhoneOwners(qint64 number);
+
+    // Контакты с днём рождения в окне из days дней начиная с from, по дню рождения (в items)
+    QFuture<StorageReply> upcomingBirthdays(const QDate &from, int days);
+
+    // Номер последнего изменения в журнале (в changeSeq) и id последнего снимка (в snapshotId), с ними сверяется снимок книги
+    QFuture<StorageReply> lastChange();
+
+    // Запомнить в БД id снимка, который сейчас будет записан
+    QFuture<StorageReply> setSnapshotId(const QString &id);
+
+    /*
+     * Чужие изменения после since, не больше limit. Если PRAGMA data_version равна knownDataVersion,
+     * никто другой в БД не писал и журнал не читается вовсе; knownDataVersion < 0 - читать в любом случае.
+     */
+    QFuture<StorageReply> pollChanges(qint64 since, int limit, qint64 knownDataVersion);
+
+    // Время выполнения операций в потоке БД (от начала до конца, без ожидания в очереди)
+    const LatencyHistogram &latency() const;
+
+private:
+    // Выполнить function(storage, reply) в потоке БД
+    template<typename Function>
+    QFuture<StorageReply> run(Function function);
+
+    QString connectionName;
+    QThreadPool pool;
+
+    // Создаётся, используется и удаляется только в потоке БД
+    std::unique_ptr<AddressBookStorage> storage;
+
+    mutable QMutex infoMutex;
+    bool opened = false;
+    bool fullTextSearch = false;
+    QString path;
+
+    LatencyHistogram histogram;
+};
+
+#endif // ASYNCSTORAGE_H
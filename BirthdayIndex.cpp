@@ -0,0 +1,180 @@
+#include "BirthdayIndex.hpp"
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+constexpr int MonthDayBits = 9;     // месяц << 5 | день - младшие 9 бит упакованной даты
+constexpr quint32 MonthDayMask = (1u << MonthDayBits) - 1;
+
+quint64 keyOf(quint32 value, int slot) {
+    return quint64(value) << 32 | quint32(slot);
+}
+
+quint32 valueOf(quint64 key) {
+    return quint32(key >> 32);
+}
+
+int slotOf(quint64 key) {
+    return int(quint32(key));
+}
+
+quint32 packMonthDay(int month, int day) {
+    return quint32(month) << 5 | quint32(day);
+}
+
+int monthDay(const QDate &date) {
+    return date.month() * 100 + date.day();
+}
+
+// Вставить отсортированную пачку ключей в отсортированный список одним слиянием
+void mergeKeys(QVector<quint64> &keys, QVector<quint64> added) {
+    std::sort(added.begin(), added.end());
+    QVector<quint64> merged;
+    merged.reserve(keys.size() + added.size());
+    std::merge(keys.cbegin(), keys.cend(), added.cbegin(), added.cend(), std::back_inserter(merged));
+    keys = std::move(merged);
+}
+
+void eraseKey(QVector<quint64> &keys, quint64 key) {
+    auto pos = std::lower_bound(keys.begin(), keys.end(), key);
+    if (pos != keys.end() && *pos == key) keys.erase(pos);
+}
+
+}
+
+QVector<BirthdayIndex::MonthDayRange> BirthdayIndex::monthDayRanges(const QDate &from, int days) {
+    if (!from.isValid() || days <= 0) return {};
+
+    // Окно длиннее года повторяло бы те же дни
+    const QDate last = from.addDays(std::min(days, MaxDays) - 1);
+    int lastMonthDay = monthDay(last);
+    if (lastMonthDay == 228 && !QDate::isLeapYear(last.year())) lastMonthDay = 229;
+
+    if (last.year() == from.year()) return {{monthDay(from), lastMonthDay}};
+    return {{monthDay(from), 1231}, {101, lastMonthDay}};
+}
+
+QDate BirthdayIndex::birthdayIn(int year, int month, int day) {
+    if (month == 2 && day == 29 && !QDate::isLeapYear(year)) return QDate(year, 2, 28);
+    return QDate(year, month, day);
+}
+
+QDate BirthdayIndex::nextBirthday(const QDate &birthDate, const QDate &from) {
+    if (!birthDate.isValid() || !from.isValid()) return QDate();
+    QDate date = birthdayIn(from.year(), birthDate.month(), birthDate.day());
+    if (date < from) date = birthdayIn(from.year() + 1, birthDate.month(), birthDate.day());
+    return date;
+}
+
+BirthdayIndex::BirthdayIndex(const ContactStore &store) : store(store) {
+}
+
+bool BirthdayIndex::keys(int slot, quint64 &monthDayKey, quint64 &dateKey) const {
+    const quint32 packed = store.packedBirthday(slot);
+    if (packed == 0 || (packed & ContactStore::BirthdayIsText)) return false;
+
+    monthDayKey = keyOf(packed & MonthDayMask, slot);
+    dateKey = keyOf(packed, slot);
+    return true;
+}
+
+void BirthdayIndex::build(const QVector<int> &liveSlots) {
+    if (built) return;
+
+    byMonthDay.clear();
+    byDate.clear();
+    byMonthDay.reserve(liveSlots.size());
+    byDate.reserve(liveSlots.size());
+    for (int slot : liveSlots) {
+        quint64 monthDayKey, dateKey;
+        if (!keys(slot, monthDayKey, dateKey)) continue;
+        byMonthDay.append(monthDayKey);
+        byDate.append(dateKey);
+    }
+    std::sort(byMonthDay.begin(), byMonthDay.end());
+    std::sort(byDate.begin(), byDate.end());
+    built = true;
+}
+
+bool BirthdayIndex::isBuilt() const {
+    return built;
+}
+
+QVector<BirthdayIndex::Upcoming> BirthdayIndex::upcoming(const QDate &from, int days) const {
+    QVector<Upcoming> result;
+    const QVector<MonthDayRange> ranges = monthDayRanges(from, days);
+
+    for (int i = 0; i < ranges.size(); ++i) {
+        // Второй диапазон - уже следующий год
+        const int year = from.year() + i;
+        const quint32 last = packMonthDay(ranges[i].last / 100, ranges[i].last % 100);
+
+        auto it = std::lower_bound(byMonthDay.cbegin(), byMonthDay.cend(),
+                                   keyOf(packMonthDay(ranges[i].first / 100, ranges[i].first % 100), 0));
+        for (; it != byMonthDay.cend() && valueOf(*it) <= last; ++it) {
+            const int slot = slotOf(*it);
+            const quint32 packed = store.packedBirthday(slot);
+            const QDate date = birthdayIn(year, (packed >> 5) & 0xf, packed & 0x1f);
+            result.append(Upcoming{slot, date, year - int(packed >> 9)});
+        }
+    }
+    return result;
+}
+
+QVector<int> BirthdayIndex::bornBetween(const QDate &first, const QDate &last) const {
+    QVector<int> result;
+    if (!first.isValid() || !last.isValid() || last < first) return result;
+
+    auto pack = [](const QDate &date) { return quint32(date.year()) << 9 | packMonthDay(date.month(), date.day()); };
+    const quint32 lastPacked = pack(last);
+
+    auto it = std::lower_bound(byDate.cbegin(), byDate.cend(), keyOf(pack(first), 0));
+    for (; it != byDate.cend() && valueOf(*it) <= lastPacked; ++it) {
+        result.append(slotOf(*it));
+    }
+    return result;
+}
+
+void BirthdayIndex::insert(int slot) {
+    if (!built) return;
+
+    quint64 monthDayKey, dateKey;
+    if (!keys(slot, monthDayKey, dateKey)) return;
+    byMonthDay.insert(std::lower_bound(byMonthDay.begin(), byMonthDay.end(), monthDayKey), monthDayKey);
+    byDate.insert(std::lower_bound(byDate.begin(), byDate.end(), dateKey), dateKey);
+}
+
+void BirthdayIndex::insert(const QVector<int> &slotList) {
+    if (!built || slotList.isEmpty()) return;
+
+    QVector<quint64> monthDayKeys, dateKeys;
+    monthDayKeys.reserve(slotList.size());
+    dateKeys.reserve(slotList.size());
+    for (int slot : slotList) {
+        quint64 monthDayKey, dateKey;
+        if (!keys(slot, monthDayKey, dateKey)) continue;
+        monthDayKeys.append(monthDayKey);
+        dateKeys.append(dateKey);
+    }
+    if (monthDayKeys.isEmpty()) return;
+
+    mergeKeys(byMonthDay, std::move(monthDayKeys));
+    mergeKeys(byDate, std::move(dateKeys));
+}
+
+void BirthdayIndex::remove(int slot) {
+    if (!built) return;
+
+    // Слот входит в ключ, так что lower_bound находит ровно его
+    quint64 monthDayKey, dateKey;
+    if (!keys(slot, monthDayKey, dateKey)) return;
+    eraseKey(byMonthDay, monthDayKey);
+    eraseKey(byDate, dateKey);
+}
+
+void BirthdayIndex::clear() {
+    byMonthDay.clear();
+    byDate.clear();
+    built = false;
+}
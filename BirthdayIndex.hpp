@@ -0,0 +1,86 @@
+#ifndef BIRTHDAYINDEX_H
+#define BIRTHDAYINDEX_H
+
+#include <QDate>
+#include <QVector>
+
+#include "ContactStore.hpp"
+
+/*
+ * Индекс дней рождения для напоминаний: "у кого день рождения в ближайшие 14 дней",
+ * "кто родился в 1990-1995 годах".
+ * Два отсортированных списка ключей (ключ << 32 | слот) из упакованных дат ContactStore:
+ *  - по месяцу и дню (день в году без учёта года) - для ближайших дней рождения;
+ *  - по полной дате - для диапазонов дат рождения.
+ * Запрос - это бинарный поиск начала и проход до конца диапазона, O(log n + k).
+ * Окно через Новый год - два диапазона: до 31 декабря и с 1 января.
+ * Даты, записанные произвольным текстом, и пустые в индекс не попадают.
+ *
+ * Как и ColumnOrder, индекс строится при первом запросе, а дальше поддерживается при каждой правке.
+ */
+class BirthdayIndex {
+public:
+    // Самое длинное окно напоминаний
+    static constexpr int MaxDays = 366;
+
+    // Диапазон дней в году: месяц * 100 + день, границы включительно
+    struct MonthDayRange {
+        int first;
+        int last;
+    };
+
+    // Ближайший день рождения контакта
+    struct Upcoming {
+        int slot;
+        QDate date;     // когда празднуется в этом окне
+        int age;        // сколько исполнится
+    };
+
+    /*
+     * Дни в году, попадающие в окно из days дней начиная с from (не больше двух диапазонов).
+     * Окно длиннее MaxDays обрезается до MaxDays. Тем, кто родился 29 февраля, в невисокосный год день рождения
+     * празднуют 28 февраля, поэтому окно, которое кончается 28 февраля такого года, захватывает и 29-е.
+     */
+    static QVector<MonthDayRange> monthDayRanges(const QDate &from, int days);
+
+    // День рождения в году year (29 февраля в невисокосный год - 28 февраля)
+    static QDate birthdayIn(int year, int month, int day);
+
+    // Ближайший день рождения начиная с from (включительно)
+    static QDate nextBirthday(const QDate &birthDate, const QDate &from);
+
+    explicit BirthdayIndex(const ContactStore &store);
+
+    // Построить индекс из живых слотов, если он ещё не построен
+    void build(const QVector<int> &liveSlots);
+    bool isBuilt() const;
+
+    // Дни рождения в окне из days дней начиная с from, по дате, а в один день - по слоту
+    QVector<Upcoming> upcoming(const QDate &from, int days) const;
+
+    // Слоты контактов, родившихся в [first, last], по дате рождения
+    QVector<int> bornBetween(const QDate &first, const QDate &last) const;
+
+    // Добавить слот в построенный индекс. Контакт уже должен лежать в хранилище.
+    void insert(int slot);
+
+    // Добавить пачку слотов: сортируется только пачка, потом одно слияние
+    void insert(const QVector<int> &slotList);
+
+    // Убрать слот. Вызывать, пока в хранилище ещё старые данные контакта.
+    void remove(int slot);
+
+    // Забыть индекс (хранилище очищено)
+    void clear();
+
+private:
+    // Ключ слота в списке по месяцу и дню и в списке по дате; false - настоящей даты у контакта нет
+    bool keys(int slot, quint64 &monthDayKey, quint64 &dateKey) const;
+
+    const ContactStore &store;
+    QVector<quint64> byMonthDay;    // (месяц << 5 | день) << 32 | слот
+    QVector<quint64> byDate;        // (год << 9 | месяц << 5 | день) << 32 | слот
+    bool built = false;
+};
+
+#endif // BIRTHDAYINDEX_H
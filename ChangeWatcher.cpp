@@ -0,0 +1,62 @@
+#include "ChangeWatcher.hpp"
+#include "AsyncStorage.hpp"
+#include "ContactsModel.hpp"
+#include "Trace.hpp"
+
+ChangeWatcher::ChangeWatcher(ContactsModel *model, AsyncStorage *storage, QObject *parent)
+    : QObject(parent), model(model), storage(storage) {
+    timer.setInterval(DefaultIntervalMs);
+    connect(&timer, &QTimer::timeout, this, &ChangeWatcher::poll);
+}
+
+void ChangeWatcher::start(qint64 changeSeq) {
+    this->changeSeq = changeSeq;
+    dataVersion = -1;
+    timer.start();
+
+    // Всё, что изменили, пока книга загружалась, дочитываем сразу
+    poll();
+}
+
+void ChangeWatcher::stop() {
+    timer.stop();
+}
+
+bool ChangeWatcher::isActive() const {
+    return timer.isActive();
+}
+
+void ChangeWatcher::setInterval(int intervalMs) {
+    timer.setInterval(qMax(1, intervalMs));
+}
+
+qint64 ChangeWatcher::lastChangeSeq() const {
+    return changeSeq;
+}
+
+void ChangeWatcher::poll() {
+    if (polling || !timer.isActive()) return;
+    polling = true;
+
+    // Запрос встаёт в очередь потока БД после наших сохранений, так что ответ на них модель получит раньше
+    storage->pollChanges(changeSeq, PageSize, dataVersion).then(this, [this](const StorageReply &reply) {
+        polling = false;
+        if (!reply.ok) {
+            emit failed(reply.errorText);
+            return;
+        }
+
+        // Порция заполнена целиком - в журнале есть ещё, и следующую читаем, даже если data_version не изменится
+        const int changeCount = reply.items.size() + reply.removedIds.size();
+        const bool morePages = changeCount >= PageSize;
+        dataVersion = morePages ? -1 : reply.dataVersion;
+        changeSeq = reply.changeSeq;
+
+        if (changeCount > 0) {
+            Trace::count("sync.changes", changeCount);
+            int applied = model->applyRemoteChanges(reply.items, reply.removedIds);
+            if (applied > 0) emit changesApplied(applied);
+        }
+        if (morePages) poll();
+    });
+}
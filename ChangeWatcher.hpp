@@ -0,0 +1,65 @@
+#ifndef CHANGEWATCHER_H
+#define CHANGEWATCHER_H
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+class AsyncStorage;
+class ContactsModel;
+
+/*
+ * Слежение за изменениями, которые в ту же БД записали другие: другие окна, импорт, addressbook-cli.
+ * Раз в интервал в потоке БД проверяется PRAGMA data_version - это одно чтение заголовка файла.
+ * Только если она изменилась, из журнала change_log читаются контакты, изменённые после
+ * последней синхронизации, и модель правится на месте: изменённые записи заменяются,
+ * удалённые убираются, новые дописываются. Книга целиком не перечитывается никогда.
+ *
+ * Свои несохранённые правки модель при этом не трогает; если чужая правка оказалась раньше,
+ * это заметит запись в БД (см. WriteQueue::conflicted).
+ */
+class ChangeWatcher : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int DefaultIntervalMs = 1000;
+
+    // Сколько изменений читать за раз: после большого чужого импорта модель дочитывает журнал порциями
+    static constexpr int PageSize = 10000;
+
+    ChangeWatcher(ContactsModel *model, AsyncStorage *storage, QObject *parent = nullptr);
+
+    // Начать слежение: в модели уже есть всё, что было в БД на момент изменения changeSeq
+    void start(qint64 changeSeq);
+    void stop();
+    bool isActive() const;
+
+    void setInterval(int intervalMs);
+
+    // Проверить изменения сейчас, не дожидаясь таймера
+    void poll();
+
+    // До какого изменения журнала модель синхронизирована
+    qint64 lastChangeSeq() const;
+
+signals:
+    // В модель внесено count чужих изменений
+    void changesApplied(int count);
+
+    void failed(const QString &errText);
+
+private:
+    ContactsModel *model;
+    AsyncStorage *storage;
+    QTimer timer;
+
+    qint64 changeSeq = 0;
+
+    // PRAGMA data_version на момент прошлой проверки (-1 - журнал нужно прочитать в любом случае)
+    qint64 dataVersion = -1;
+
+    // Проверка уже стоит в очереди БД
+    bool polling = false;
+};
+
+#endif // CHANGEWATCHER_H
@@ -0,0 +1,212 @@
+#include "ColumnOrder.hpp"
+#include <QCollatorSortKey>
+#include <QtAlgorithms>
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+namespace {
+
+template<typename T>
+int compareValues(T a, T b) {
+    return a < b ? -1 : (b < a ? 1 : 0);
+}
+
+}
+
+ColumnOrder::ColumnOrder(const ContactStore &store) : store(store) {
+}
+
+void ColumnOrder::updateRanks() {
+    const int known = ranks.size();
+    const int count = store.stringCount();
+    if (count == known) return;
+
+    // Новые строки сортируем по QCollatorSortKey: ключ считается один раз на строку, а не на каждое сравнение
+    std::vector<QCollatorSortKey> keys;
+    keys.reserve(count - known);
+    QVector<quint32> added;
+    added.reserve(count - known);
+    for (int id = known; id < count; ++id) {
+        keys.push_back(collator.sortKey(store.stringView(id).toString()));
+        added.append(quint32(id));
+    }
+    std::sort(added.begin(), added.end(), [&keys, known](quint32 a, quint32 b) {
+        return keys[a - known].compare(keys[b - known]) < 0;
+    });
+    ranks.resize(count);
+
+    auto byCollation = [this](quint32 a, quint32 b) { return collator.compare(store.stringView(a), store.stringView(b)) < 0; };
+
+    // Старые строки друг относительно друга не переставляются, поэтому готовые порядки остаются верными.
+    // Много новых строк (первая сортировка, страница загрузки) - одно слияние и перенумерация
+    const int depth = 32 - qCountLeadingZeroBits(quint32(known) | 1u);
+    if (qint64(added.size()) * depth >= known) {
+        QVector<quint32> merged;
+        merged.reserve(count);
+        std::merge(collatedStrings.cbegin(), collatedStrings.cend(), added.cbegin(), added.cend(), std::back_inserter(merged), byCollation);
+        collatedStrings = std::move(merged);
+        renumberRanks();
+        return;
+    }
+
+    // Несколько новых строк (правка): место каждой - бинарным поиском, ранг - середина промежутка между соседями
+    for (quint32 id : std::as_const(added)) {
+        const int pos = int(std::lower_bound(collatedStrings.cbegin(), collatedStrings.cend(), id, byCollation) - collatedStrings.cbegin());
+        collatedStrings.insert(pos, id);
+
+        const quint64 low = pos > 0 ? ranks[collatedStrings[pos - 1]] : 0;
+        const quint64 high = pos + 1 < collatedStrings.size() ? ranks[collatedStrings[pos + 1]] : MaxRank + 1;
+        if (high - low < 2) {
+            // Промежуток кончился: раздаём ранги заново с равными промежутками
+            renumberRanks();
+            continue;
+        }
+        ranks[id] = quint32(low + (high - low) / 2);
+    }
+}
+
+void ColumnOrder::renumberRanks() {
+    // Ранги с промежутками, чтобы новые строки вставали между соседями без перенумерации
+    const quint64 gap = std::max<quint64>(1, (MaxRank + 1) / quint64(collatedStrings.size() + 1));
+    for (int i = 0; i < collatedStrings.size(); ++i) {
+        ranks[collatedStrings[i]] = quint32(quint64(i + 1) * gap);
+    }
+}
+
+int ColumnOrder::compareStrings(quint32 a, quint32 b) const {
+    return compareValues(ranks.at(a), ranks.at(b));
+}
+
+int ColumnOrder::comparePhones(int a, int b) const {
+    // Как в ячейке: по первому номеру, при равенстве - по следующим; без телефонов - первыми
+    const int countA = store.phoneCount(a);
+    const int countB = store.phoneCount(b);
+    for (int i = 0; i < countA && i < countB; ++i) {
+        qint64 numberA = store.phoneE164(a, i);
+        qint64 numberB = store.phoneE164(b, i);
+        int cmp;
+        if (numberA != 0 && numberB != 0) {
+            cmp = compareValues(numberA, numberB);
+        } else if (numberA != 0 || numberB != 0) {
+            cmp = numberA != 0 ? -1 : 1;
+        } else {
+            cmp = compareStrings(store.phoneTextId(a, i), store.phoneTextId(b, i));
+        }
+        if (cmp != 0) return cmp;
+    }
+    return compareValues(countA, countB);
+}
+
+int ColumnOrder::compareBirthdays(int a, int b) const {
+    const quint32 packedA = store.packedBirthday(a);
+    const quint32 packedB = store.packedBirthday(b);
+    const bool textA = packedA & ContactStore::BirthdayIsText;
+    const bool textB = packedB & ContactStore::BirthdayIsText;
+
+    // Пустая дата - 0, поэтому она и так меньше всех
+    if (!textA && !textB) return compareValues(packedA, packedB);
+    if (textA != textB) return textA ? 1 : -1;
+    return compareStrings(packedA & ~ContactStore::BirthdayIsText, packedB & ~ContactStore::BirthdayIsText);
+}
+
+int ColumnOrder::compare(int key, int a, int b) const {
+    int cmp = 0;
+    switch (key) {
+    case IdKey:
+        return compareValues(store.id(a), store.id(b));
+    case LastNameKey:
+        cmp = compareStrings(store.lastNameId(a), store.lastNameId(b));
+        if (cmp == 0) cmp = compareStrings(store.firstNameId(a), store.firstNameId(b));
+        if (cmp == 0) cmp = compareStrings(store.patronymicId(a), store.patronymicId(b));
+        return cmp;
+    case FirstNameKey:
+        cmp = compareStrings(store.firstNameId(a), store.firstNameId(b));
+        if (cmp == 0) cmp = compareStrings(store.lastNameId(a), store.lastNameId(b));
+        if (cmp == 0) cmp = compareStrings(store.patronymicId(a), store.patronymicId(b));
+        return cmp;
+    case PatronymicKey:
+        cmp = compareStrings(store.patronymicId(a), store.patronymicId(b));
+        if (cmp == 0) cmp = compareStrings(store.lastNameId(a), store.lastNameId(b));
+        if (cmp == 0) cmp = compareStrings(store.firstNameId(a), store.firstNameId(b));
+        return cmp;
+    case PhonesKey:
+        return comparePhones(a, b);
+    case EmailKey:
+        return compareStrings(store.emailId(a), store.emailId(b));
+    case BirthdayKey:
+        return compareBirthdays(a, b);
+    }
+    return 0;
+}
+
+bool ColumnOrder::less(int key, int a, int b) const {
+    int cmp = compare(key, a, b);
+    return cmp != 0 ? cmp < 0 : a < b;
+}
+
+bool ColumnOrder::anyBuilt() const {
+    return std::find(built.cbegin(), built.cend(), true) != built.cend();
+}
+
+const QVector<int> &ColumnOrder::orderedSlots(int key, const QVector<int> &liveSlots) {
+    if (!built[key]) {
+        updateRanks();
+        QVector<int> &slotList = sorted[key];
+        slotList = liveSlots;
+        std::sort(slotList.begin(), slotList.end(), [this, key](int a, int b) { return less(key, a, b); });
+        built[key] = true;
+    }
+    return sorted[key];
+}
+
+void ColumnOrder::insert(int slot) {
+    // Пока ни по одной колонке не сортировали, поддерживать нечего (в том числе ранги строк)
+    if (!anyBuilt()) return;
+    updateRanks();
+
+    for (int key = 0; key < KeyCount; ++key) {
+        if (!built[key]) continue;
+        QVector<int> &slotList = sorted[key];
+        auto pos = std::lower_bound(slotList.begin(), slotList.end(), slot, [this, key](int a, int b) { return less(key, a, b); });
+        slotList.insert(pos, slot);
+    }
+}
+
+void ColumnOrder::insert(QVector<int> slotList) {
+    if (slotList.isEmpty() || !anyBuilt()) return;
+    updateRanks();
+
+    for (int key = 0; key < KeyCount; ++key) {
+        if (!built[key]) continue;
+        auto byKey = [this, key](int a, int b) { return less(key, a, b); };
+        std::sort(slotList.begin(), slotList.end(), byKey);
+
+        QVector<int> merged;
+        merged.reserve(sorted[key].size() + slotList.size());
+        std::merge(sorted[key].cbegin(), sorted[key].cend(), slotList.cbegin(), slotList.cend(), std::back_inserter(merged), byKey);
+        sorted[key] = std::move(merged);
+    }
+}
+
+void ColumnOrder::remove(int slot) {
+    if (!anyBuilt()) return;
+    updateRanks();
+
+    // Слот входит в ключ, так что lower_bound находит ровно его
+    for (int key = 0; key < KeyCount; ++key) {
+        if (!built[key]) continue;
+        QVector<int> &slotList = sorted[key];
+        auto pos = std::lower_bound(slotList.begin(), slotList.end(), slot, [this, key](int a, int b) { return less(key, a, b); });
+        if (pos != slotList.end() && *pos == slot) slotList.erase(pos);
+    }
+}
+
+void ColumnOrder::clear() {
+    for (int key = 0; key < KeyCount; ++key) {
+        sorted[key].clear();
+        built[key] = false;
+    }
+    collatedStrings.clear();
+    ranks.clear();
+}
@@ -0,0 +1,84 @@
+#ifndef COLUMNORDER_H
+#define COLUMNORDER_H
+
+#include <QCollator>
+#include <QVector>
+#include <array>
+
+#include "ContactStore.hpp"
+
+/*
+ * Порядок слотов по каждой колонке таблицы.
+ * Сравниваются не тексты ячеек, а типизированные ключи прямо из колонок ContactStore:
+ *  - user_id - как число (у несохранённых записей номера ещё нет, они идут первыми);
+ *  - дата рождения - упакованная дата, то есть по году, месяцу и дню; даты, записанные
+ *    произвольным текстом, идут после настоящих;
+ *  - телефоны - номера E.164 как числа, нестандартные записи после них;
+ *  - ФИО и e-mail - по правилам языка (QCollator). Каждой строке пула выдаётся ранг - число, которое
+ *    растёт в порядке строк, - и при сортировке сравниваются два целых числа. Ранги раздаются
+ *    с промежутками: новая строка после правки получает ранг между соседями (их находит бинарный поиск),
+ *    и все ранги пересчитываются, только когда промежуток кончился.
+ *
+ * Порядок по колонке строится при первой сортировке по ней, а дальше поддерживается при каждой
+ * правке, так что повторный клик по заголовку - это проход по готовому списку.
+ * Одинаковые ключи различает номер слота.
+ */
+class ColumnOrder {
+public:
+    // Ключи в порядке колонок ContactsModel
+    enum Key {
+        IdKey,
+        LastNameKey,        // фамилия, имя, отчество
+        FirstNameKey,       // имя, фамилия, отчество
+        PatronymicKey,      // отчество, фамилия, имя
+        PhonesKey,
+        EmailKey,
+        BirthdayKey,
+        KeyCount
+    };
+
+    explicit ColumnOrder(const ContactStore &store);
+
+    // Все живые слоты по возрастанию ключа. Если порядок по этому ключу ещё не строился, он строится из liveSlots.
+    const QVector<int> &orderedSlots(int key, const QVector<int> &liveSlots);
+
+    // Добавить слот во все построенные порядки. Контакт уже должен лежать в хранилище.
+    void insert(int slot);
+
+    // Добавить пачку слотов: сортируется только пачка, потом одно слияние с каждым порядком
+    void insert(QVector<int> slotList);
+
+    // Убрать слот. Вызывать, пока в хранилище ещё старые данные контакта.
+    void remove(int slot);
+
+    // Забыть все порядки и ранги строк (хранилище очищено)
+    void clear();
+
+private:
+    // Выдать ранги строкам, которые появились в пуле после прошлого вызова
+    void updateRanks();
+
+    // Заново раздать ранги всем строкам по collatedStrings, с равными промежутками
+    void renumberRanks();
+
+    int compare(int key, int a, int b) const;
+    int compareStrings(quint32 a, quint32 b) const;
+    int comparePhones(int a, int b) const;
+    int compareBirthdays(int a, int b) const;
+    bool less(int key, int a, int b) const;
+
+    bool anyBuilt() const;
+
+    const ContactStore &store;
+    QCollator collator;
+
+    // Номера строк пула по правилам языка и обратное отображение: номер строки -> ранг
+    QVector<quint32> collatedStrings;
+    QVector<quint32> ranks;
+    static constexpr quint64 MaxRank = 0xffffffffu;
+
+    std::array<QVector<int>, KeyCount> sorted;
+    std::array<bool, KeyCount> built{};
+};
+
+#endif // COLUMNORDER_H
@@ -0,0 +1,309 @@
+#include "ContactFileReader.hpp"
+#include <QDate>
+#include <QFileInfo>
+#include <QRegularExpression>
+
+namespace {
+
+// Телефоны в одном поле разделяются запятой или точкой с запятой
+QVector<QString> splitPhones(const QString &text) {
+    static const QRegularExpression separator("[,;]");
+    QVector<QString> phones;
+    const QStringList parts = text.split(separator, Qt::SkipEmptyParts);
+    for (const QString &part : parts) {
+        QString phone = part.trimmed();
+        if (!phone.isEmpty()) phones.append(phone);
+    }
+    return phones;
+}
+
+// Экранирование значений vCard: \, \; \n \\
+QString unescapeVCard(const QString &value) {
+    QString result;
+    result.reserve(value.size());
+    for (int i = 0; i < value.size(); ++i) {
+        if (value[i] == '\\' && i + 1 < value.size()) {
+            QChar next = value[++i];
+            result.append(next == 'n' || next == 'N' ? QChar('\n') : next);
+        } else {
+            result.append(value[i]);
+        }
+    }
+    return result;
+}
+
+// Разбить значение vCard по ";" с учётом экранирования "\;"
+QStringList splitVCardValue(const QString &value) {
+    QStringList parts;
+    QString part;
+    for (int i = 0; i < value.size(); ++i) {
+        if (value[i] == '\\' && i + 1 < value.size()) {
+            part.append(value[i]);
+            part.append(value[++i]);
+        } else if (value[i] == ';') {
+            parts.append(unescapeVCard(part));
+            part.clear();
+        } else {
+            part.append(value[i]);
+        }
+    }
+    parts.append(unescapeVCard(part));
+    return parts;
+}
+
+// BDAY из vCard (1990-07-13 или 19900713) в формат книги dd-MM-yyyy
+QString vCardBirthday(const QString &value) {
+    QDate date = QDate::fromString(value, "yyyy-MM-dd");
+    if (!date.isValid()) date = QDate::fromString(value, "yyyyMMdd");
+    return date.isValid() ? date.toString("dd-MM-yyyy") : value;
+}
+
+}
+
+ContactFileReader::Format ContactFileReader::formatForFile(const QString &fileName) {
+    QString suffix = QFileInfo(fileName).suffix().toLower();
+    if (suffix == "csv") return Csv;
+    if (suffix == "vcf" || suffix == "vcard") return VCard;
+    return Pipe;
+}
+
+ContactFileReader::ContactFileReader(const QString &fileName, Format format) : file(fileName), format(format) {
+}
+
+bool ContactFileReader::open() {
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        errorText = "Не удалось открыть файл для чтения: " + file.errorString();
+        return false;
+    }
+    in.setDevice(&file);
+    return true;
+}
+
+QString ContactFileReader::lastError() const {
+    return errorText;
+}
+
+qint64 ContactFileReader::bytesRead() const {
+    // QTextStream читает файл блоками, так что это оценка с точностью до блока
+    return file.pos();
+}
+
+qint64 ContactFileReader::fileSize() const {
+    return file.size();
+}
+
+bool ContactFileReader::readLine(QString &line) {
+    if (in.atEnd()) return false;
+    line = in.readLine();
+    ++lineNumber;
+    return true;
+}
+
+bool ContactFileReader::readChunk(QVector<ImportRecord> &records, int maxRecords) {
+    records.clear();
+    records.reserve(maxRecords);
+
+    while (records.size() < maxRecords) {
+        ImportRecord record;
+        bool ok = false;
+        switch (format) {
+        case Csv:   ok = readCsvRecord(record); break;
+        case VCard: ok = readVCardRecord(record); break;
+        case Pipe:  ok = readPipeRecord(record); break;
+        }
+        if (!ok) return false;
+        records.append(record);
+    }
+    return true;
+}
+
+bool ContactFileReader::readCsvFields(QStringList &fields) {
+    QString line;
+    if (!readLine(line)) return false;
+
+    // Разделитель определяем по первой строке: ";" (так сохраняет русский Excel) или ","
+    if (!csvHeaderChecked) {
+        csvDelimiter = line.count(';') > line.count(',') ? QChar(';') : QChar(',');
+    }
+
+    fields.clear();
+    QString field;
+    bool quoted = false;
+    int i = 0;
+    while (true) {
+        for (; i < line.size(); ++i) {
+            QChar ch = line[i];
+            if (quoted) {
+                if (ch == '"') {
+                    // "" внутри кавычек - это сама кавычка
+                    if (i + 1 < line.size() && line[i + 1] == '"') {
+                        field.append('"');
+                        ++i;
+                    } else {
+                        quoted = false;
+                    }
+                } else {
+                    field.append(ch);
+                }
+            } else if (ch == '"') {
+                quoted = true;
+            } else if (ch == csvDelimiter) {
+                fields.append(field);
+                field.clear();
+            } else {
+                field.append(ch);
+            }
+        }
+
+        // Кавычка не закрыта - поле продолжается на следующей строке
+        if (!quoted || !readLine(line)) break;
+        field.append('\n');
+        i = 0;
+    }
+    fields.append(field);
+    return true;
+}
+
+bool ContactFileReader::readCsvRecord(ImportRecord &record) {
+    QStringList fields;
+    while (true) {
+        record.line = lineNumber + 1;
+        if (!readCsvFields(fields)) return false;
+
+        // Пустые строки пропускаем
+        if (fields.size() == 1 && fields[0].trimmed().isEmpty()) continue;
+
+        if (!csvHeaderChecked) {
+            csvHeaderChecked = true;
+
+            // Если первая строка - заголовок, берём из него номера колонок
+            int recognized = 0;
+            for (int c = 0; c < fields.size(); ++c) {
+                QString name = fields[c].trimmed().toLower();
+                if (name == "lastname" || name == "фамилия") { csvLastName = c; ++recognized; }
+                else if (name == "firstname" || name == "имя") { csvFirstName = c; ++recognized; }
+                else if (name == "patronymic" || name == "отчество") { csvPatronymic = c; ++recognized; }
+                else if (name == "phone" || name == "phones" || name == "phone_list" || name == "телефон") { csvPhones = c; ++recognized; }
+                else if (name == "email" || name == "e-mail") { csvEmail = c; ++recognized; }
+                else if (name == "birthday" || name == "дата рождения") { csvBirthday = c; ++recognized; }
+            }
+            if (recognized >= 2) continue;
+        }
+        break;
+    }
+
+    auto field = [&fields](int column) {
+        return column < fields.size() ? fields[column].trimmed() : QString();
+    };
+
+    record.item.userLastName = field(csvLastName);
+    record.item.userFirstName = field(csvFirstName);
+    record.item.userPatronymicName = field(csvPatronymic);
+    record.item.userPhonesList = splitPhones(field(csvPhones));
+    record.item.userEmail = field(csvEmail);
+    record.item.userBirthday = field(csvBirthday);
+
+    if (fields.size() < 6) {
+        record.error = QString("Ожидалось 6 колонок, найдено %1.").arg(fields.size());
+    }
+    return true;
+}
+
+bool ContactFileReader::readVCardLine(QString &line) {
+    if (hasPendingLine) {
+        line = pendingLine;
+        hasPendingLine = false;
+    } else if (!readLine(line)) {
+        return false;
+    }
+
+    // Длинные строки vCard переносятся: продолжение начинается с пробела или табуляции
+    QString next;
+    while (readLine(next)) {
+        if (next.startsWith(' ') || next.startsWith('\t')) {
+            line.append(next.mid(1));
+        } else {
+            pendingLine = next;
+            hasPendingLine = true;
+            break;
+        }
+    }
+    return true;
+}
+
+bool ContactFileReader::readVCardRecord(ImportRecord &record) {
+    QString line;
+
+    // Пропускаем всё до начала карточки
+    do {
+        if (!readVCardLine(line)) return false;
+    } while (line.trimmed().compare("BEGIN:VCARD", Qt::CaseInsensitive) != 0);
+    record.line = lineNumber - (hasPendingLine ? 1 : 0);
+
+    QString formattedName;
+    bool hasName = false;
+    while (true) {
+        if (!readVCardLine(line)) {
+            record.error = "Карточка vCard не закрыта (нет END:VCARD).";
+            return true;
+        }
+        if (line.trimmed().compare("END:VCARD", Qt::CaseInsensitive) == 0) break;
+
+        int colon = line.indexOf(':');
+        if (colon < 0) continue;
+
+        // Имя свойства без параметров (TEL;TYPE=cell) и без группы (item1.EMAIL)
+        QString name = line.left(colon).section(';', 0, 0).section('.', -1).toUpper();
+        QString value = line.mid(colon + 1);
+
+        if (name == "N") {
+            QStringList parts = splitVCardValue(value);
+            record.item.userLastName = parts.value(0).trimmed();
+            record.item.userFirstName = parts.value(1).trimmed();
+            record.item.userPatronymicName = parts.value(2).trimmed();
+            hasName = true;
+        } else if (name == "FN") {
+            formattedName = unescapeVCard(value).trimmed();
+        } else if (name == "TEL") {
+            // В vCard 4.0 телефон может быть записан как tel:+7...
+            QString phone = unescapeVCard(value).trimmed();
+            if (phone.startsWith("tel:", Qt::CaseInsensitive)) phone = phone.mid(4);
+            if (!phone.isEmpty()) record.item.userPhonesList.append(phone);
+        } else if (name == "EMAIL") {
+            if (record.item.userEmail.isEmpty()) record.item.userEmail = unescapeVCard(value).trimmed();
+        } else if (name == "BDAY") {
+            record.item.userBirthday = vCardBirthday(value.trimmed());
+        }
+    }
+
+    // Если структурированного имени нет, берём FN в порядке "Фамилия Имя Отчество"
+    if (!hasName && !formattedName.isEmpty()) {
+        QStringList parts = formattedName.split(' ', Qt::SkipEmptyParts);
+        record.item.userLastName = parts.value(0);
+        record.item.userFirstName = parts.value(1);
+        record.item.userPatronymicName = parts.mid(2).join(' ');
+    }
+    return true;
+}
+
+bool ContactFileReader::readPipeRecord(ImportRecord &record) {
+    QString line;
+    do {
+        if (!readLine(line)) return false;
+    } while (line.trimmed().isEmpty());
+    record.line = lineNumber;
+
+    QStringList fields = line.split("|");
+    if (fields.size() < 6) {
+        record.error = QString("Ожидалось 6 полей через \"|\", найдено %1.").arg(fields.size());
+        return true;
+    }
+
+    record.item.userLastName = fields[0].trimmed();
+    record.item.userFirstName = fields[1].trimmed();
+    record.item.userPatronymicName = fields[2].trimmed();
+    record.item.userPhonesList = splitPhones(fields[3]);
+    record.item.userEmail = fields[4].trimmed();
+    record.item.userBirthday = fields[5].trimmed();
+    return true;
+}
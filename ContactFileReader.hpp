@@ -0,0 +1,81 @@
+#ifndef CONTACTFILEREADER_H
+#define CONTACTFILEREADER_H
+
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+#include <QVector>
+
+#include "Item.hpp"
+
+// Одна запись из файла импорта
+struct ImportRecord {
+    int line = 0;       // строка файла, где начинается запись
+    Item item;
+    QString error;      // пусто, если запись корректна
+};
+
+/*
+ * Потоковое чтение контактов из файла: CSV, vCard и старый формат "|"
+ * (Фамилия|Имя|Отчество|телефоны через запятую|e-mail|дата рождения).
+ * Файл читается порциями, в памяти одновременно только одна порция.
+ */
+class ContactFileReader {
+public:
+    enum Format {
+        Csv,
+        VCard,
+        Pipe
+    };
+
+    // Формат по расширению файла (.csv, .vcf/.vcard, остальное - старый формат "|")
+    static Format formatForFile(const QString &fileName);
+
+    ContactFileReader(const QString &fileName, Format format);
+
+    bool open();
+    QString lastError() const;
+
+    // Прочитать до maxRecords записей. Возвращает false, когда файл закончился.
+    bool readChunk(QVector<ImportRecord> &records, int maxRecords);
+
+    // Сколько байт файла уже прочитано (для прогресса)
+    qint64 bytesRead() const;
+    qint64 fileSize() const;
+
+private:
+    bool readLine(QString &line);
+
+    bool readCsvRecord(ImportRecord &record);
+    bool readVCardRecord(ImportRecord &record);
+    bool readPipeRecord(ImportRecord &record);
+
+    // Разобрать строку CSV с учётом кавычек. Поле в кавычках может занимать несколько строк.
+    bool readCsvFields(QStringList &fields);
+
+    // Прочитать строку vCard, склеив её продолжения
+    bool readVCardLine(QString &line);
+
+    QFile file;
+    QTextStream in;
+    Format format;
+    QString errorText;
+    int lineNumber = 0;
+
+    // Номера колонок CSV (по заголовку или по умолчанию)
+    int csvLastName = 0;
+    int csvFirstName = 1;
+    int csvPatronymic = 2;
+    int csvPhones = 3;
+    int csvEmail = 4;
+    int csvBirthday = 5;
+    bool csvHeaderChecked = false;
+    QChar csvDelimiter = ',';
+
+    // Строка vCard, прочитанная наперёд при склейке перенесённых строк
+    QString pendingLine;
+    bool hasPendingLine = false;
+};
+
+#endif // CONTACTFILEREADER_H
@@ -0,0 +1,177 @@
+#include "ContactFileWriter.hpp"
+#include "PhoneNumber.hpp"
+#include <QDate>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+#include <cstdio>
+
+namespace {
+
+// Поле CSV: в кавычках, если в нём есть запятая, кавычка или перевод строки
+QString csvField(const QString &value) {
+    if (!value.contains(',') && !value.contains('"') && !value.contains('\n') && !value.contains('\r')) return value;
+    QString quoted = value;
+    quoted.replace("\"", "\"\"");
+    return "\"" + quoted + "\"";
+}
+
+// Текстовое значение vCard: \ , ; и перевод строки экранируются
+QString vCardText(const QString &value) {
+    QString escaped;
+    escaped.reserve(value.size());
+    for (QChar ch : value) {
+        if (ch == '\\' || ch == ',' || ch == ';') {
+            escaped.append('\\');
+            escaped.append(ch);
+        } else if (ch == '\n') {
+            escaped.append("\\n");
+        } else if (ch != '\r') {
+            escaped.append(ch);
+        }
+    }
+    return escaped;
+}
+
+}
+
+ContactFileWriter::Format ContactFileWriter::formatForFile(const QString &fileName) {
+    QString suffix = QFileInfo(fileName).suffix().toLower();
+    if (suffix == "vcf" || suffix == "vcard") return VCard;
+    if (suffix == "jsonl" || suffix == "json") return JsonLines;
+    return Csv;
+}
+
+ContactFileWriter::ContactFileWriter(const QString &fileName, Format format) : file(fileName), format(format) {
+}
+
+bool ContactFileWriter::open() {
+    // Без QIODevice::Text: переводы строк пишем сами (CRLF там, где его требует формат).
+    // Имя "-" - стандартный вывод, чтобы консольная утилита могла писать в конвейер.
+    bool opened = file.fileName() == "-" ? file.open(stdout, QIODevice::WriteOnly)
+                                         : file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    if (!opened) {
+        errorText = "Не удалось открыть файл для записи: " + file.errorString();
+        return false;
+    }
+    out.setDevice(&file);
+
+    // Заголовок с именами колонок, по нему ContactFileReader найдёт колонки при импорте
+    if (format == Csv) {
+        out << "id,lastname,firstname,patronymic,phones,email,birthday\r\n";
+    }
+    return true;
+}
+
+bool ContactFileWriter::writeItem(const Item &item) {
+    switch (format) {
+    case Csv:       writeCsv(item); break;
+    case VCard:     writeVCard(item); break;
+    case JsonLines: writeJson(item); break;
+    }
+
+    if (out.status() != QTextStream::Ok) {
+        errorText = "Ошибка записи в файл: " + file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool ContactFileWriter::close() {
+    out.flush();
+    bool ok = out.status() == QTextStream::Ok && file.error() == QFileDevice::NoError;
+    if (!ok) errorText = "Ошибка записи в файл: " + file.errorString();
+    file.close();
+    return ok;
+}
+
+QString ContactFileWriter::lastError() const {
+    return errorText;
+}
+
+void ContactFileWriter::writeCsv(const Item &item) {
+    // Телефоны через ";", чтобы поле не приходилось брать в кавычки
+    out << csvField(item.userId) << ','
+        << csvField(item.userLastName) << ','
+        << csvField(item.userFirstName) << ','
+        << csvField(item.userPatronymicName) << ','
+        << csvField(QStringList::fromVector(item.userPhonesList).join(";")) << ','
+        << csvField(item.userEmail) << ','
+        << csvField(item.userBirthday) << "\r\n";
+}
+
+void ContactFileWriter::writeVCardLine(const QString &line) {
+    // По RFC 6350 строка не длиннее 75 октетов UTF-8, продолжение начинается с пробела (он тоже считается).
+    // Режем только между символами: суррогатная пара остаётся целой
+    static constexpr int MaxOctets = 75;
+    QStringView rest(line);
+    int limit = MaxOctets;
+    bool continuation = false;
+    while (true) {
+        qsizetype end = 0;
+        int octets = 0;
+        while (end < rest.size()) {
+            const bool pair = rest[end].isHighSurrogate() && end + 1 < rest.size() && rest[end + 1].isLowSurrogate();
+            const char16_t unit = rest[end].unicode();
+            const int width = pair ? 4 : (unit < 0x80 ? 1 : (unit < 0x800 ? 2 : 3));
+            if (octets + width > limit) break;
+            octets += width;
+            end += pair ? 2 : 1;
+        }
+
+        if (continuation) out << ' ';
+        out << rest.left(end) << "\r\n";
+        rest = rest.mid(end);
+        if (rest.isEmpty()) return;
+        limit = MaxOctets - 1;
+        continuation = true;
+    }
+}
+
+void ContactFileWriter::writeVCard(const Item &item) {
+    writeVCardLine("BEGIN:VCARD");
+    writeVCardLine("VERSION:4.0");
+    writeVCardLine("FN:" + vCardText(QStringList({item.userLastName, item.userFirstName, item.userPatronymicName}).join(' ').trimmed()));
+    writeVCardLine("N:" + vCardText(item.userLastName) + ';' + vCardText(item.userFirstName) + ';'
+                   + vCardText(item.userPatronymicName) + ";;");
+
+    for (const QString &phone : item.userPhonesList) {
+        // Разбираемый номер пишем как URI tel:, остальное - как есть текстом
+        qint64 number = PhoneNumber::toE164(phone);
+        if (number != 0) {
+            writeVCardLine("TEL;VALUE=uri:tel:" + PhoneNumber::fromE164(number));
+        } else {
+            writeVCardLine("TEL;VALUE=text:" + vCardText(phone));
+        }
+    }
+
+    if (!item.userEmail.isEmpty()) writeVCardLine("EMAIL:" + vCardText(item.userEmail));
+
+    // В книге дата хранится как dd-MM-yyyy, в vCard - yyyyMMdd
+    QDate birthday = QDate::fromString(item.userBirthday, "dd-MM-yyyy");
+    if (birthday.isValid()) {
+        writeVCardLine("BDAY:" + birthday.toString("yyyyMMdd"));
+    } else if (!item.userBirthday.isEmpty()) {
+        writeVCardLine("BDAY;VALUE=text:" + vCardText(item.userBirthday));
+    }
+
+    writeVCardLine("END:VCARD");
+}
+
+void ContactFileWriter::writeJson(const Item &item) {
+    QJsonArray phones;
+    for (const QString &phone : item.userPhonesList) phones.append(phone);
+
+    QJsonObject object;
+    object.insert("id", item.userId.toLongLong());
+    object.insert("lastName", item.userLastName);
+    object.insert("firstName", item.userFirstName);
+    object.insert("patronymic", item.userPatronymicName);
+    object.insert("phones", phones);
+    object.insert("email", item.userEmail);
+    object.insert("birthday", item.userBirthday);
+
+    out << QString::fromUtf8(QJsonDocument(object).toJson(QJsonDocument::Compact)) << '\n';
+}
@@ -0,0 +1,52 @@
+#ifndef CONTACTFILEWRITER_H
+#define CONTACTFILEWRITER_H
+
+#include <QFile>
+#include <QString>
+#include <QTextStream>
+
+#include "Item.hpp"
+
+/*
+ * Потоковая запись контактов в файл: CSV, vCard 4.0 или JSON Lines (один объект JSON на строку).
+ * Каждый контакт сразу уходит в буфер потока, книга целиком в памяти не собирается.
+ * CSV и vCard читаются обратно через ContactFileReader.
+ */
+class ContactFileWriter {
+public:
+    enum Format {
+        Csv,
+        VCard,
+        JsonLines
+    };
+
+    // Формат по расширению файла (.vcf/.vcard, .jsonl/.json, остальное - CSV)
+    static Format formatForFile(const QString &fileName);
+
+    ContactFileWriter(const QString &fileName, Format format);
+
+    // Открыть файл ("-" - стандартный вывод) и записать заголовок (для CSV)
+    bool open();
+
+    bool writeItem(const Item &item);
+
+    // Дописать буфер на диск и закрыть файл
+    bool close();
+
+    QString lastError() const;
+
+private:
+    void writeCsv(const Item &item);
+    void writeVCard(const Item &item);
+    void writeJson(const Item &item);
+
+    // Строка vCard, длинные строки переносятся по 75 символов
+    void writeVCardLine(const QString &line);
+
+    QFile file;
+    QTextStream out;
+    Format format;
+    QString errorText;
+};
+
+#endif // CONTACTFILEWRITER_H
@@ -0,0 +1,124 @@
+#include "ContactScanner.hpp"
+#include <QPair>
+#include <QtConcurrent/QtConcurrentMap>
+#include <algorithm>
+#include <string_view>
+
+namespace {
+
+// Цифры номера E.164 в buffer, возвращает их количество
+int writeDigits(qint64 number, char (&buffer)[20]) {
+    int length = 0;
+    while (number > 0 && length < 20) {
+        buffer[length++] = char('0' + number % 10);
+        number /= 10;
+    }
+    std::reverse(buffer, buffer + length);
+    return length;
+}
+
+// Упакованная дата (год << 9 | месяц << 5 | день) как в ячейке таблицы: dd-MM-yyyy
+void writeDate(quint32 packed, char16_t (&buffer)[10]) {
+    auto put = [&buffer](int pos, int value, int width) {
+        for (int i = pos + width - 1; i >= pos; --i, value /= 10) buffer[i] = char16_t(u'0' + value % 10);
+    };
+    put(0, packed & 0x1f, 2);
+    buffer[2] = u'-';
+    put(3, (packed >> 5) & 0xf, 2);
+    buffer[5] = u'-';
+    put(6, packed >> 9, 4);
+}
+
+}
+
+ContactScanner::ContactScanner(const ContactStore &contacts) : contacts(contacts) {
+}
+
+ContactScanner::Query ContactScanner::prepare(const QString &text) {
+    Query query;
+    query.text = text.trimmed();
+
+    bool phoneLike = true;
+    for (QChar ch : query.text) {
+        if (ch.isLetter()) query.hasLetters = true;
+        if (ch.isDigit()) {
+            query.digits.append(char(ch.digitValue() + '0'));
+        } else if (ch != '+' && ch != '(' && ch != ')' && ch != '-' && ch != ' ') {
+            phoneLike = false;
+        }
+    }
+    if (!phoneLike) query.digits.clear();
+
+    // Российские 8XXXXXXXXXX хранятся как 7XXXXXXXXXX, так же их правит и SearchIndex
+    if (query.digits.size() >= 5 && query.digits.startsWith('8')) query.digits[0] = '7';
+    return query;
+}
+
+bool ContactScanner::matches(int slot, const Query &query) const {
+    const QString &text = query.text;
+    if (contacts.lastNameView(slot).contains(text, Qt::CaseInsensitive)) return true;
+    if (contacts.firstNameView(slot).contains(text, Qt::CaseInsensitive)) return true;
+    if (contacts.patronymicView(slot).contains(text, Qt::CaseInsensitive)) return true;
+    if (contacts.emailView(slot).contains(text, Qt::CaseInsensitive)) return true;
+
+    const std::string_view digits(query.digits.constData(), size_t(query.digits.size()));
+    const int phoneCount = contacts.phoneCount(slot);
+    for (int i = 0; i < phoneCount; ++i) {
+        qint64 number = contacts.phoneE164(slot, i);
+        if (number == 0) {
+            if (contacts.phoneTextView(slot, i).contains(text, Qt::CaseInsensitive)) return true;
+        } else if (!digits.empty()) {
+            char buffer[20];
+            int length = writeDigits(number, buffer);
+            if (std::string_view(buffer, size_t(length)).find(digits) != std::string_view::npos) return true;
+        }
+    }
+
+    // Дата рождения - только цифры и разделители, с буквами её не сравниваем
+    if (query.hasLetters) return false;
+    const quint32 birthday = contacts.packedBirthday(slot);
+    if (birthday == 0) return false;
+    if (birthday & ContactStore::BirthdayIsText) {
+        return contacts.stringView(birthday & ~ContactStore::BirthdayIsText).contains(text);
+    }
+    char16_t buffer[10];
+    writeDate(birthday, buffer);
+    return QStringView(buffer, 10).contains(text);
+}
+
+QVector<int> ContactScanner::scanRange(int begin, int end, const Query &query) const {
+    QVector<int> found;
+    for (int slot = begin; slot < end; ++slot) {
+        if (matches(slot, query)) found.append(slot);
+    }
+    return found;
+}
+
+QVector<int> ContactScanner::scan(const QString &text, const std::function<bool()> &isCanceled) const {
+    const Query query = prepare(text);
+    if (query.text.isEmpty()) return {};
+
+    const int size = contacts.size();
+    if (size <= ChunkSize) return scanRange(0, size, query);
+
+    QVector<QPair<int, int>> chunks;
+    chunks.reserve(size / ChunkSize + 1);
+    for (int begin = 0; begin < size; begin += ChunkSize) {
+        chunks.append({begin, qMin(size, begin + ChunkSize)});
+    }
+
+    // Порции расходятся по всем потокам глобального пула; blockingMapped возвращает результаты в порядке порций
+    std::function<QVector<int>(const QPair<int, int> &)> scanChunk = [&](const QPair<int, int> &chunk) {
+        if (isCanceled && isCanceled()) return QVector<int>();
+        return scanRange(chunk.first, chunk.second, query);
+    };
+    const QVector<QVector<int>> parts = QtConcurrent::blockingMapped<QVector<QVector<int>>>(chunks, scanChunk);
+    if (isCanceled && isCanceled()) return {};
+
+    qsizetype total = 0;
+    for (const QVector<int> &part : parts) total += part.size();
+    QVector<int> found;
+    found.reserve(total);
+    for (const QVector<int> &part : parts) found += part;
+    return found;
+}
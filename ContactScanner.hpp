@@ -0,0 +1,48 @@
+#ifndef CONTACTSCANNER_H
+#define CONTACTSCANNER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <functional>
+
+#include "ContactStore.hpp"
+
+/*
+ * Поиск подстроки по всем контактам - для запросов, которые индекс не покрывает
+ * (кусок e-mail, цифры из середины телефона, часть даты рождения).
+ * Просматривается снимок ContactStore (копия делит данные с моделью и не меняется),
+ * слоты делятся на порции по ChunkSize, порции проверяются параллельно во всех ядрах
+ * (QtConcurrent), а найденное склеивается в исходном порядке слотов.
+ * Проверка читает колонки хранилища напрямую, не собирая Item и не выделяя память на контакт.
+ */
+class ContactScanner {
+public:
+    static constexpr int ChunkSize = 16384;
+
+    explicit ContactScanner(const ContactStore &contacts);
+
+    /*
+     * Слоты (по возрастанию) контактов, у которых хотя бы одно поле содержит text без учёта регистра.
+     * Запрос из цифр и телефонных знаков сравнивается ещё и с цифрами номеров (8... как 7...).
+     * isCanceled проверяется перед каждой порцией; если поиск отменили, результат пустой.
+     */
+    QVector<int> scan(const QString &text, const std::function<bool()> &isCanceled = {}) const;
+
+private:
+    struct Query {
+        QString text;
+        QByteArray digits;     // цифры телефонного запроса (пусто, если запрос не похож на телефон)
+        bool hasLetters = false;
+    };
+
+    static Query prepare(const QString &text);
+
+    bool matches(int slot, const Query &query) const;
+
+    QVector<int> scanRange(int begin, int end, const Query &query) const;
+
+    ContactStore contacts;
+};
+
+#endif // CONTACTSCANNER_H
@@ -0,0 +1,254 @@
+#include "ContactSnapshot.hpp"
+#include "Trace.hpp"
+#include <QFileInfo>
+#include <QSaveFile>
+#include <cstring>
+#include <limits>
+
+namespace {
+const char Magic[8] = {'A', 'B', 'S', 'N', 'A', 'P', 'S', 'H'};
+
+// Записанная на той же машине метка читается как есть, на машине с другим порядком байт - наоборот
+constexpr quint32 ByteOrderMark = 0x01020304u;
+
+// Разделы начинаются с границы 8 байт, чтобы колонки в отображённом файле были выровнены
+constexpr quint64 SectionAlignment = 8;
+
+quint64 aligned(quint64 offset) {
+    return (offset + SectionAlignment - 1) & ~(SectionAlignment - 1);
+}
+
+template<typename T>
+bool writeColumn(QSaveFile &file, const QVector<T> &column) {
+    const qint64 bytes = column.size() * qint64(sizeof(T));
+    return bytes == 0 || file.write(reinterpret_cast<const char *>(column.constData()), bytes) == bytes;
+}
+
+template<typename T>
+void readColumn(const uchar *data, quint64 offset, qint64 count, QVector<T> &column) {
+    column.resize(count);
+    if (count > 0) std::memcpy(column.data(), data + offset, size_t(count) * sizeof(T));
+}
+}
+
+QString ContactSnapshot::pathFor(const QString &databasePath) {
+    return QFileInfo(databasePath).absoluteFilePath() + ".snapshot";
+}
+
+qint64 ContactSnapshot::sectionBytes(const Header &header, int section) {
+    switch (section) {
+    case Ids:           return header.slotCount * qint64(sizeof(qint64));
+    case States:        return header.slotCount * qint64(sizeof(quint8));
+    case PhoneNumbers:  return header.phoneCount * qint64(sizeof(qint64));
+    case StringOffsets: return (header.stringCount + 1) * qint64(sizeof(quint32));
+    case StringChars:   return header.charCount * qint64(sizeof(char16_t));
+    }
+    // Остальные колонки - по quint32 на слот
+    return header.slotCount * qint64(sizeof(quint32));
+}
+
+bool ContactSnapshot::write(const QString &path, const ContactStore &contacts, qint64 changeSeq, const QUuid &snapshotId,
+                            QString &errText) {
+    TraceScope trace("snapshot.write");
+
+    // Строки, на которые никто не ссылается, и места старых телефонов в снимок не переносим
+    ContactStore compacted = contacts;
+    if (compacted.hasGarbage()) compacted.compactStrings();
+
+    Header header = {};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.formatVersion = FormatVersion;
+    header.byteOrderMark = ByteOrderMark;
+    const QByteArray id = snapshotId.toRfc4122();
+    std::memcpy(header.snapshotId, id.constData(), sizeof(header.snapshotId));
+    header.changeSeq = changeSeq;
+    header.slotCount = compacted.ids.size();
+    header.phoneCount = compacted.phoneNumbers.size();
+    header.wastedPhones = compacted.wastedPhones;
+    header.stringCount = compacted.strings.count();
+    header.charCount = compacted.strings.chars.size();
+
+    quint64 offset = aligned(sizeof(Header));
+    for (int section = 0; section < SectionCount; ++section) {
+        header.sectionOffsets[section] = offset;
+        offset = aligned(offset + quint64(sectionBytes(header, section)));
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        errText = "Ошибка записи снимка книги " + path + ": " + file.errorString();
+        return false;
+    }
+
+    // Перед каждым разделом - нули до его смещения
+    auto pad = [&file](quint64 to) {
+        const QByteArray zeros(int(to - quint64(file.pos())), '\0');
+        return zeros.isEmpty() || file.write(zeros) == zeros.size();
+    };
+    auto startSection = [&pad, &header](int section) { return pad(header.sectionOffsets[section]); };
+
+    bool ok = file.write(reinterpret_cast<const char *>(&header), sizeof(Header)) == qint64(sizeof(Header))
+        && startSection(Ids) && writeColumn(file, compacted.ids)
+        && startSection(Versions) && writeColumn(file, compacted.versions)
+        && startSection(LastNames) && writeColumn(file, compacted.lastNames)
+        && startSection(FirstNames) && writeColumn(file, compacted.firstNames)
+        && startSection(Patronymics) && writeColumn(file, compacted.patronymics)
+        && startSection(Emails) && writeColumn(file, compacted.emails)
+        && startSection(Birthdays) && writeColumn(file, compacted.birthdays)
+        && startSection(States) && writeColumn(file, compacted.states)
+        && startSection(PhoneOffsets) && writeColumn(file, compacted.phoneOffsets)
+        && startSection(PhoneCounts) && writeColumn(file, compacted.phoneCounts)
+        && startSection(PhoneNumbers) && writeColumn(file, compacted.phoneNumbers)
+        && startSection(StringOffsets) && writeColumn(file, compacted.strings.offsets)
+        && startSection(StringChars) && writeColumn(file, compacted.strings.chars);
+
+    // Файл появится на месте старого только целиком
+    if (!ok || !file.commit()) {
+        errText = "Ошибка записи снимка книги " + path + ": " + file.errorString();
+        return false;
+    }
+    return true;
+}
+
+ContactSnapshot::~ContactSnapshot() {
+    close();
+}
+
+bool ContactSnapshot::open(const QString &path) {
+    TraceScope trace("snapshot.open");
+    close();
+
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return fail("Нет снимка книги " + path + ": " + file.errorString());
+    }
+    const qint64 fileSize = file.size();
+    if (fileSize < qint64(sizeof(Header))) {
+        close();
+        return fail("Снимок книги повреждён: файл короче заголовка");
+    }
+
+    data = file.map(0, fileSize);
+    if (!data) {
+        QString errText = file.errorString();
+        close();
+        return fail("Не удалось отобразить снимок книги в память: " + errText);
+    }
+    std::memcpy(&header, data, sizeof(Header));
+
+    if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0) {
+        close();
+        return fail("Файл " + path + " - не снимок книги");
+    }
+    if (header.formatVersion != FormatVersion || header.byteOrderMark != ByteOrderMark) {
+        close();
+        return fail("Снимок книги записан в другом формате, он будет создан заново");
+    }
+    if (header.slotCount < 0 || header.slotCount > std::numeric_limits<int>::max() || header.phoneCount < 0
+        || header.stringCount < 1 || header.charCount < 0 || header.wastedPhones < 0) {
+        close();
+        return fail("Снимок книги повреждён: неверные размеры");
+    }
+
+    // Каждый раздел выровнен и целиком лежит в файле
+    for (int section = 0; section < SectionCount; ++section) {
+        const quint64 offset = header.sectionOffsets[section];
+        if (offset % SectionAlignment != 0 || offset < sizeof(Header)
+            || offset > quint64(fileSize) || quint64(sectionBytes(header, section)) > quint64(fileSize) - offset) {
+            close();
+            return fail("Снимок книги повреждён: раздел за пределами файла");
+        }
+    }
+    return true;
+}
+
+void ContactSnapshot::close() {
+    if (data) {
+        file.unmap(const_cast<uchar *>(data));
+        data = nullptr;
+    }
+    file.close();
+    header = {};
+}
+
+qint64 ContactSnapshot::changeSeq() const {
+    return header.changeSeq;
+}
+
+QUuid ContactSnapshot::snapshotId() const {
+    return QUuid::fromRfc4122(QByteArray::fromRawData(header.snapshotId, sizeof(header.snapshotId)));
+}
+
+qint64 ContactSnapshot::slotCount() const {
+    return header.slotCount;
+}
+
+bool ContactSnapshot::read(ContactStore &contacts) {
+    TraceScope trace("snapshot.read");
+    if (!data) return fail("Снимок книги не открыт");
+
+    const qint64 slotCount = header.slotCount;
+    const quint64 *offsets = header.sectionOffsets;
+
+    contacts.clear();
+    readColumn(data, offsets[Ids], slotCount, contacts.ids);
+    readColumn(data, offsets[Versions], slotCount, contacts.versions);
+    readColumn(data, offsets[LastNames], slotCount, contacts.lastNames);
+    readColumn(data, offsets[FirstNames], slotCount, contacts.firstNames);
+    readColumn(data, offsets[Patronymics], slotCount, contacts.patronymics);
+    readColumn(data, offsets[Emails], slotCount, contacts.emails);
+    readColumn(data, offsets[Birthdays], slotCount, contacts.birthdays);
+    readColumn(data, offsets[States], slotCount, contacts.states);
+    readColumn(data, offsets[PhoneOffsets], slotCount, contacts.phoneOffsets);
+    readColumn(data, offsets[PhoneCounts], slotCount, contacts.phoneCounts);
+    readColumn(data, offsets[PhoneNumbers], header.phoneCount, contacts.phoneNumbers);
+    readColumn(data, offsets[StringOffsets], header.stringCount + 1, contacts.strings.offsets);
+    readColumn(data, offsets[StringChars], header.charCount, contacts.strings.chars);
+    contacts.wastedPhones = header.wastedPhones;
+
+    // Хеш-таблица пула зависит от зерна qHash этого процесса, поэтому в файле её нет
+    contacts.strings.table.clear();
+
+    // Ссылки на строки посчитаются при первой правке
+    contacts.stringRefsCounted = false;
+
+    /*
+     * Номера внутри колонок проверяем одним проходом: испорченный снимок не должен
+     * привести к чтению за пределами колонок. Это доли времени самого копирования.
+     */
+    const QVector<quint32> &stringOffsets = contacts.strings.offsets;
+    bool valid = stringOffsets.first() == 0 && qint64(stringOffsets.last()) == header.charCount;
+    for (qint64 id = 1; valid && id < stringOffsets.size(); ++id) {
+        valid = stringOffsets[id - 1] <= stringOffsets[id];
+    }
+
+    const quint32 stringCount = quint32(header.stringCount);
+    auto validString = [stringCount](quint32 id) { return id < stringCount; };
+    for (qint64 slot = 0; valid && slot < slotCount; ++slot) {
+        const quint32 birthday = contacts.birthdays[slot];
+        valid = validString(contacts.lastNames[slot]) && validString(contacts.firstNames[slot])
+            && validString(contacts.patronymics[slot]) && validString(contacts.emails[slot])
+            && (!(birthday & ContactStore::BirthdayIsText) || validString(birthday & ~ContactStore::BirthdayIsText))
+            && contacts.states[slot] <= quint8(ItemState::Modified)
+            && qint64(contacts.phoneOffsets[slot]) + contacts.phoneCounts[slot] <= header.phoneCount;
+    }
+    for (qint64 i = 0; valid && i < header.phoneCount; ++i) {
+        const qint64 packed = contacts.phoneNumbers[i];
+        valid = packed > 0 || -packed < qint64(stringCount);
+    }
+
+    if (!valid) {
+        contacts.clear();
+        return fail("Снимок книги повреждён: номера строк или телефонов вне колонок");
+    }
+    return true;
+}
+
+QString ContactSnapshot::lastError() const {
+    return errorText;
+}
+
+bool ContactSnapshot::fail(const QString &errText) {
+    errorText = errText;
+    return false;
+}
@@ -0,0 +1,106 @@
+#ifndef CONTACTSNAPSHOT_H
+#define CONTACTSNAPSHOT_H
+
+#include <QFile>
+#include <QString>
+#include <QUuid>
+
+#include "ContactStore.hpp"
+
+/*
+ * Снимок книги на диске, чтобы при запуске не читать её из БД запросами.
+ * Файл - это колонки ContactStore как есть, в порядке байт машины:
+ *  - заголовок (версия формата, метка порядка байт, id снимка, номер изменения журнала, размеры, смещения разделов);
+ *  - разделы по колонкам, каждый с границы 8 байт: user_id, версии, номера строк ФИО и e-mail,
+ *    даты, состояния, телефоны;
+ *  - пул строк: смещения строк и один общий блок символов UTF-16.
+ * Чтение - отображение файла в память и по одному memcpy на колонку, без разбора строк по одной.
+ *
+ * Снимок соответствует БД на момент изменения changeSeq журнала change_log. По одному changeSeq
+ * чужой снимок не отличить: БД, созданная заново или восстановленная из копии, дойдёт до того же номера
+ * с другими контактами. Поэтому у снимка есть случайный id, который перед записью снимка кладётся и в саму БД
+ * (AddressBookStorage::setSnapshotId); снимок с другим id - не от этой БД.
+ * Файл пишется через QSaveFile, так что оборванной записи не бывает: либо старый снимок, либо новый.
+ * В файл попадает уплотнённая копия колонок: строки пула, на которые уже никто не ссылается, не переносятся.
+ *
+ * Методы возвращают false при ошибке, текст ошибки можно получить через lastError().
+ */
+class ContactSnapshot {
+public:
+    static constexpr quint32 FormatVersion = 2;
+
+    // Где лежит снимок книги из этой БД (рядом с файлом БД)
+    static QString pathFor(const QString &databasePath);
+
+    /*
+     * Записать все слоты contacts (освобождённые - с user_id 0) как снимок БД на момент изменения changeSeq.
+     * В contacts не должно быть несохранённых правок. snapshotId уже должен лежать в БД.
+     */
+    static bool write(const QString &path, const ContactStore &contacts, qint64 changeSeq, const QUuid &snapshotId,
+                      QString &errText);
+
+    ContactSnapshot() = default;
+    ~ContactSnapshot();
+
+    ContactSnapshot(const ContactSnapshot &) = delete;
+    ContactSnapshot &operator=(const ContactSnapshot &) = delete;
+
+    // Отобразить файл в память и проверить заголовок
+    bool open(const QString &path);
+    void close();
+
+    // Номер изменения журнала, которому соответствует снимок, его id и сколько в нём слотов
+    qint64 changeSeq() const;
+    QUuid snapshotId() const;
+    qint64 slotCount() const;
+
+    // Переложить колонки в contacts (прежнее содержимое заменяется) и проверить, что номера внутри колонок не выходят за границы
+    bool read(ContactStore &contacts);
+
+    QString lastError() const;
+
+private:
+    enum Section {
+        Ids,
+        Versions,
+        LastNames,
+        FirstNames,
+        Patronymics,
+        Emails,
+        Birthdays,
+        States,
+        PhoneOffsets,
+        PhoneCounts,
+        PhoneNumbers,
+        StringOffsets,
+        StringChars,
+        SectionCount
+    };
+
+    struct Header {
+        char magic[8];
+        quint32 formatVersion;
+        quint32 byteOrderMark;
+        char snapshotId[16];    // QUuid в виде RFC 4122
+        qint64 changeSeq;
+        qint64 slotCount;
+        qint64 phoneCount;
+        qint64 wastedPhones;
+        qint64 stringCount;     // строк в пуле; смещений на одно больше
+        qint64 charCount;
+        quint64 sectionOffsets[SectionCount];
+    };
+
+    // Сколько байт занимает раздел при таких размерах
+    static qint64 sectionBytes(const Header &header, int section);
+
+    // Запомнить текст ошибки и вернуть false
+    bool fail(const QString &errText);
+
+    QFile file;
+    const uchar *data = nullptr;
+    Header header = {};
+    QString errorText;
+};
+
+#endif // CONTACTSNAPSHOT_H
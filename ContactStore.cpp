@@ -0,0 +1,393 @@
+#include "ContactStore.hpp"
+#include "PhoneNumber.hpp"
+#include <QDate>
+
+ContactStore::ContactStore() {
+}
+
+int ContactStore::size() const {
+    return ids.size();
+}
+
+void ContactStore::reserve(int count) {
+    ids.reserve(count);
+    lastNames.reserve(count);
+    firstNames.reserve(count);
+    patronymics.reserve(count);
+    emails.reserve(count);
+    birthdays.reserve(count);
+    states.reserve(count);
+    versions.reserve(count);
+    phoneOffsets.reserve(count);
+    phoneCounts.reserve(count);
+}
+
+void ContactStore::clear() {
+    strings.clear();
+    ids.clear();
+    lastNames.clear();
+    firstNames.clear();
+    patronymics.clear();
+    emails.clear();
+    birthdays.clear();
+    states.clear();
+    versions.clear();
+    phoneOffsets.clear();
+    phoneCounts.clear();
+    phoneNumbers.clear();
+    wastedPhones = 0;
+    stringRefs = {0};
+    stringRefsCounted = true;
+    wastedChars = 0;
+}
+
+int ContactStore::append(const Item &item) {
+    int slot = ids.size();
+    ids.append(0);
+    lastNames.append(0);
+    firstNames.append(0);
+    patronymics.append(0);
+    emails.append(0);
+    birthdays.append(0);
+    states.append(quint8(ItemState::Clean));
+    versions.append(0);
+    phoneOffsets.append(quint32(phoneNumbers.size()));
+    phoneCounts.append(0);
+    set(slot, item);
+    return slot;
+}
+
+void ContactStore::set(int slot, const Item &item) {
+    countStringRefs();
+
+    // Сначала ссылаемся на новые строки, потом отпускаем старые: неизменившееся поле не станет мусором даже на миг
+    const quint32 oldStrings[] = {lastNames[slot], firstNames[slot], patronymics[slot], emails[slot],
+                                  birthdays[slot] & BirthdayIsText ? birthdays[slot] & ~BirthdayIsText : 0};
+
+    ids[slot] = item.userId.toLongLong();
+    lastNames[slot] = internCounted(item.userLastName);
+    firstNames[slot] = internCounted(item.userFirstName);
+    patronymics[slot] = internCounted(item.userPatronymicName);
+    emails[slot] = internCounted(item.userEmail);
+    birthdays[slot] = packBirthday(item.userBirthday);
+    states[slot] = quint8(item.state);
+    versions[slot] = item.version;
+    setPhones(slot, item.userPhonesList);
+
+    for (quint32 id : oldStrings) releaseString(id);
+}
+
+void ContactStore::erase(int slot) {
+    set(slot, Item());
+}
+
+Item ContactStore::item(int slot) const {
+    Item item;
+    qint64 userId = ids.at(slot);
+    if (userId != 0) item.userId = QString::number(userId);
+    item.userLastName = lastName(slot);
+    item.userFirstName = firstName(slot);
+    item.userPatronymicName = patronymic(slot);
+    item.userEmail = email(slot);
+    item.userBirthday = birthday(slot);
+    item.userPhonesList = phones(slot);
+    item.state = state(slot);
+    item.version = versions.at(slot);
+    return item;
+}
+
+qint64 ContactStore::id(int slot) const {
+    return ids.at(slot);
+}
+
+void ContactStore::setId(int slot, qint64 id) {
+    ids[slot] = id;
+}
+
+ItemState ContactStore::state(int slot) const {
+    return ItemState(states.at(slot));
+}
+
+void ContactStore::setState(int slot, ItemState state) {
+    states[slot] = quint8(state);
+}
+
+quint32 ContactStore::version(int slot) const {
+    return versions.at(slot);
+}
+
+void ContactStore::setVersion(int slot, quint32 version) {
+    versions[slot] = version;
+}
+
+QString ContactStore::lastName(int slot) const {
+    return strings.string(lastNames.at(slot));
+}
+
+QString ContactStore::firstName(int slot) const {
+    return strings.string(firstNames.at(slot));
+}
+
+QString ContactStore::patronymic(int slot) const {
+    return strings.string(patronymics.at(slot));
+}
+
+QString ContactStore::email(int slot) const {
+    return strings.string(emails.at(slot));
+}
+
+QStringView ContactStore::lastNameView(int slot) const {
+    return strings.view(lastNames.at(slot));
+}
+
+QStringView ContactStore::firstNameView(int slot) const {
+    return strings.view(firstNames.at(slot));
+}
+
+QStringView ContactStore::patronymicView(int slot) const {
+    return strings.view(patronymics.at(slot));
+}
+
+QStringView ContactStore::emailView(int slot) const {
+    return strings.view(emails.at(slot));
+}
+
+int ContactStore::phoneCount(int slot) const {
+    return int(phoneCounts.at(slot));
+}
+
+qint64 ContactStore::phoneE164(int slot, int index) const {
+    qint64 packed = phoneNumbers.at(phoneOffsets.at(slot) + index);
+    return packed > 0 ? packed : 0;
+}
+
+QStringView ContactStore::phoneTextView(int slot, int index) const {
+    qint64 packed = phoneNumbers.at(phoneOffsets.at(slot) + index);
+    return packed > 0 ? QStringView() : strings.view(quint32(-packed));
+}
+
+quint32 ContactStore::lastNameId(int slot) const {
+    return lastNames.at(slot);
+}
+
+quint32 ContactStore::firstNameId(int slot) const {
+    return firstNames.at(slot);
+}
+
+quint32 ContactStore::patronymicId(int slot) const {
+    return patronymics.at(slot);
+}
+
+quint32 ContactStore::emailId(int slot) const {
+    return emails.at(slot);
+}
+
+quint32 ContactStore::phoneTextId(int slot, int index) const {
+    qint64 packed = phoneNumbers.at(phoneOffsets.at(slot) + index);
+    return packed > 0 ? 0 : quint32(-packed);
+}
+
+quint32 ContactStore::packedBirthday(int slot) const {
+    return birthdays.at(slot);
+}
+
+QStringView ContactStore::stringView(quint32 id) const {
+    return strings.view(id);
+}
+
+int ContactStore::stringCount() const {
+    return strings.count();
+}
+
+QString ContactStore::birthday(int slot) const {
+    return unpackBirthday(birthdays.at(slot));
+}
+
+QVector<QString> ContactStore::phones(int slot) const {
+    QVector<QString> phoneList;
+    quint32 offset = phoneOffsets.at(slot);
+    quint32 count = phoneCounts.at(slot);
+    phoneList.reserve(count);
+    for (quint32 i = 0; i < count; ++i) {
+        phoneList.append(unpackPhone(phoneNumbers.at(offset + i)));
+    }
+    return phoneList;
+}
+
+void ContactStore::setPhones(int slot, const QVector<QString> &phoneList) {
+    quint32 oldCount = phoneCounts[slot];
+    quint32 newCount = quint32(phoneList.size());
+
+    // Тексты нестандартных номеров, которые сейчас будут перезаписаны
+    QVector<quint32> oldTexts;
+    for (quint32 i = 0; i < oldCount; ++i) {
+        const qint64 packed = phoneNumbers[phoneOffsets[slot] + i];
+        if (packed < 0) oldTexts.append(quint32(-packed));
+    }
+
+    // Если новые телефоны помещаются на место старых, пишем туда же, иначе - в конец массива
+    quint32 offset = phoneOffsets[slot];
+    if (newCount > oldCount) {
+        offset = quint32(phoneNumbers.size());
+        phoneNumbers.resize(phoneNumbers.size() + newCount);
+        wastedPhones += oldCount;
+    } else {
+        wastedPhones += oldCount - newCount;
+    }
+
+    for (quint32 i = 0; i < newCount; ++i) {
+        phoneNumbers[offset + i] = packPhone(phoneList[i]);
+    }
+    phoneOffsets[slot] = offset;
+    phoneCounts[slot] = newCount;
+    for (quint32 id : std::as_const(oldTexts)) releaseString(id);
+
+    if (wastedPhones > 4096 && wastedPhones * 2 > phoneNumbers.size()) compactPhones();
+}
+
+void ContactStore::compactPhones() {
+    QVector<qint64> packed;
+    packed.reserve(phoneNumbers.size() - wastedPhones);
+    for (int slot = 0; slot < ids.size(); ++slot) {
+        quint32 offset = phoneOffsets[slot];
+        phoneOffsets[slot] = quint32(packed.size());
+        for (quint32 i = 0; i < phoneCounts[slot]; ++i) {
+            packed.append(phoneNumbers[offset + i]);
+        }
+    }
+    phoneNumbers = std::move(packed);
+    wastedPhones = 0;
+}
+
+quint32 ContactStore::internCounted(QStringView text) {
+    const quint32 id = strings.intern(text);
+    if (id == 0) return 0;
+
+    if (id >= quint32(stringRefs.size())) {
+        // Строку только что дописали в пул
+        stringRefs.append(1);
+    } else if (stringRefs[id]++ == 0) {
+        // Строка была мусором и снова нужна
+        wastedChars -= strings.view(id).size();
+    }
+    return id;
+}
+
+void ContactStore::releaseString(quint32 id) {
+    if (id != 0 && --stringRefs[id] == 0) wastedChars += strings.view(id).size();
+}
+
+void ContactStore::countStringRefs() {
+    if (stringRefsCounted) return;
+
+    stringRefs.fill(0, strings.count());
+    auto reference = [this](quint32 id) {
+        if (id != 0) ++stringRefs[id];
+    };
+    for (int slot = 0; slot < ids.size(); ++slot) {
+        reference(lastNames[slot]);
+        reference(firstNames[slot]);
+        reference(patronymics[slot]);
+        reference(emails[slot]);
+        if (birthdays[slot] & BirthdayIsText) reference(birthdays[slot] & ~BirthdayIsText);
+        for (quint32 i = 0; i < phoneCounts[slot]; ++i) {
+            const qint64 packed = phoneNumbers[phoneOffsets[slot] + i];
+            if (packed < 0) reference(quint32(-packed));
+        }
+    }
+
+    wastedChars = 0;
+    for (quint32 id = 1; id < quint32(stringRefs.size()); ++id) {
+        if (stringRefs[id] == 0) wastedChars += strings.view(id).size();
+    }
+    stringRefsCounted = true;
+}
+
+bool ContactStore::hasGarbage() const {
+    return !stringRefsCounted || wastedChars > 0 || wastedPhones > 0;
+}
+
+void ContactStore::compactStrings() {
+    if (wastedPhones > 0) compactPhones();
+
+    StringPool live;
+    QVector<quint32> newIds(strings.count(), 0);
+    auto remap = [this, &live, &newIds](quint32 id) {
+        if (id != 0 && newIds[id] == 0) newIds[id] = live.intern(strings.view(id));
+        return newIds[id];
+    };
+    for (int slot = 0; slot < ids.size(); ++slot) {
+        lastNames[slot] = remap(lastNames[slot]);
+        firstNames[slot] = remap(firstNames[slot]);
+        patronymics[slot] = remap(patronymics[slot]);
+        emails[slot] = remap(emails[slot]);
+        if (birthdays[slot] & BirthdayIsText) birthdays[slot] = BirthdayIsText | remap(birthdays[slot] & ~BirthdayIsText);
+    }
+    // После уплотнения все телефоны принадлежат слотам
+    for (qint64 &packed : phoneNumbers) {
+        if (packed < 0) packed = -qint64(remap(quint32(-packed)));
+    }
+
+    strings = std::move(live);
+    stringRefsCounted = false;
+    wastedChars = 0;
+}
+
+quint32 ContactStore::packBirthday(const QString &text) {
+    if (text.isEmpty()) return 0;
+
+    // Только строгий dd-MM-yyyy: тогда распаковка вернёт ровно ту же строку
+    if (text.size() == 10 && text[2] == '-' && text[5] == '-') {
+        static constexpr int DigitPositions[] = {0, 1, 3, 4, 6, 7, 8, 9};
+        bool digits = true;
+        for (int pos : DigitPositions) {
+            if (text[pos] < '0' || text[pos] > '9') digits = false;
+        }
+        if (digits) {
+            auto value = [&text](int pos, int length) {
+                int result = 0;
+                for (int i = pos; i < pos + length; ++i) result = result * 10 + (text[i].unicode() - '0');
+                return result;
+            };
+            int day = value(0, 2);
+            int month = value(3, 2);
+            int year = value(6, 4);
+            if (QDate::isValid(year, month, day)) {
+                return quint32(year) << 9 | quint32(month) << 5 | quint32(day);
+            }
+        }
+    }
+    return BirthdayIsText | internCounted(text);
+}
+
+QString ContactStore::unpackBirthday(quint32 packed) const {
+    if (packed == 0) return QString();
+    if (packed & BirthdayIsText) return strings.string(packed & ~BirthdayIsText);
+
+    int day = packed & 0x1f;
+    int month = (packed >> 5) & 0xf;
+    int year = packed >> 9;
+    return QString("%1-%2-%3").arg(day, 2, 10, QChar('0')).arg(month, 2, 10, QChar('0')).arg(year, 4, 10, QChar('0'));
+}
+
+qint64 ContactStore::packPhone(const QString &phone) {
+    // Числом храним только номера, которые из числа восстанавливаются буква в букву
+    qint64 number = PhoneNumber::toE164(phone);
+    if (number != 0 && PhoneNumber::fromE164(number) == phone) return number;
+    return -qint64(internCounted(phone));
+}
+
+QString ContactStore::unpackPhone(qint64 packed) const {
+    if (packed > 0) return PhoneNumber::fromE164(packed);
+    return strings.string(quint32(-packed));
+}
+
+qsizetype ContactStore::memoryUsage() const {
+    return ids.capacity() * qsizetype(sizeof(qint64))
+         + (lastNames.capacity() + firstNames.capacity() + patronymics.capacity() + emails.capacity()
+            + birthdays.capacity() + versions.capacity() + phoneOffsets.capacity() + phoneCounts.capacity()
+            + stringRefs.capacity()) * qsizetype(sizeof(quint32))
+         + states.capacity() * qsizetype(sizeof(quint8))
+         + phoneNumbers.capacity() * qsizetype(sizeof(qint64))
+         + strings.memoryUsage();
+}
@@ -0,0 +1,161 @@
+#ifndef CONTACTSTORE_H
+#define CONTACTSTORE_H
+
+#include <QString>
+#include <QVector>
+
+#include "Item.hpp"
+#include "StringPool.hpp"
+
+/*
+ * Компактное хранилище контактов для модели.
+ * Item с семью QString и QVector<QString> остаётся форматом обмена (БД, диалоги, импорт),
+ * а в памяти книга лежит по колонкам (structure of arrays), по одному элементу на слот:
+ *  - user_id - qint64, версия записи в БД - quint32;
+ *  - фамилия, имя, отчество, e-mail - номера строк в общем StringPool;
+ *  - дата рождения - дата, упакованная в quint32;
+ *  - телефоны - числа E.164 в общем массиве, у слота только смещение и количество.
+ * Значения, которые не укладываются в компактную форму (дата не в формате dd-MM-yyyy,
+ * телефон не в виде +7XXXXXXXXXX), хранятся текстом в пуле, так что Item возвращается
+ * ровно таким, каким его положили.
+ *
+ * Из пула строки не удаляются: на номера строк опираются порядки колонок и поиск повторов. Поэтому у каждой
+ * строки есть счётчик ссылок, а символы строк, на которые больше никто не ссылается, учитываются в wastedChars
+ * (как wastedPhones у телефонов). Выбрасывает их снимок книги: он пишет уплотнённую копию (compactStrings).
+ */
+class ContactStore {
+public:
+    ContactStore();
+
+    // Сколько слотов (включая освобождённые)
+    int size() const;
+
+    void reserve(int count);
+    void clear();
+
+    // Добавить контакт в новый слот, вернуть номер слота
+    int append(const Item &item);
+
+    // Записать контакт в существующий слот
+    void set(int slot, const Item &item);
+
+    // Очистить слот (контакт удалён, слот потом займёт другой)
+    void erase(int slot);
+
+    // Собрать Item из колонок
+    Item item(int slot) const;
+
+    qint64 id(int slot) const;
+    void setId(int slot, qint64 id);
+
+    ItemState state(int slot) const;
+    void setState(int slot, ItemState state);
+
+    quint32 version(int slot) const;
+    void setVersion(int slot, quint32 version);
+
+    QString lastName(int slot) const;
+    QString firstName(int slot) const;
+    QString patronymic(int slot) const;
+    QString email(int slot) const;
+    QString birthday(int slot) const;
+    QVector<QString> phones(int slot) const;
+
+    // Части имени без копирования. Действительны до следующего изменения хранилища.
+    QStringView lastNameView(int slot) const;
+    QStringView firstNameView(int slot) const;
+    QStringView patronymicView(int slot) const;
+    QStringView emailView(int slot) const;
+
+    // Телефоны слота по одному, без сборки строк: номер E.164 (0, если номер записан нестандартно)
+    // или, для нестандартного, его текст
+    int phoneCount(int slot) const;
+    qint64 phoneE164(int slot, int index) const;
+    QStringView phoneTextView(int slot, int index) const;
+
+    /*
+     * Ключи для сортировки без сборки строк.
+     * Строки из пула не удаляются, поэтому номер строки у одинакового текста всегда один и тот же.
+     */
+    quint32 lastNameId(int slot) const;
+    quint32 firstNameId(int slot) const;
+    quint32 patronymicId(int slot) const;
+    quint32 emailId(int slot) const;
+
+    // Номер текста нестандартного телефона в пуле (0, если номер хранится как E.164)
+    quint32 phoneTextId(int slot, int index) const;
+
+    // Дата рождения как есть: год << 9 | месяц << 5 | день, 0 - даты нет,
+    // текстовая - BirthdayIsText | номер строки в пуле
+    quint32 packedBirthday(int slot) const;
+
+    // Строка пула по номеру и сколько в пуле строк
+    QStringView stringView(quint32 id) const;
+    int stringCount() const;
+
+    static constexpr quint32 BirthdayIsText = 0x80000000u;
+
+    // Сколько байт занимает книга в памяти (колонки, телефоны и пул строк)
+    qsizetype memoryUsage() const;
+
+private:
+    // Снимок книги на диске (ContactSnapshot) - это эти же колонки, он пишет и читает их напрямую
+    friend class ContactSnapshot;
+
+    void setPhones(int slot, const QVector<QString> &phoneList);
+
+    // Номер строки в пуле, на которую теперь ссылается ещё одно поле, и строка, на которую ссылаться перестали
+    quint32 internCounted(QStringView text);
+    void releaseString(quint32 id);
+
+    // Пересчитать ссылки на строки по всем колонкам, если они ещё не посчитаны (хранилище прочитано из снимка)
+    void countStringRefs();
+
+    // Есть ли что выбрасывать: ненужные строки, места старых телефонов (или ссылки ещё не посчитаны)
+    bool hasGarbage() const;
+
+    /*
+     * Переложить пул, оставив только строки, на которые ссылаются слоты, и уплотнить телефоны.
+     * Номера строк при этом меняются, поэтому так можно делать только с копией, по номерам которой
+     * ничего не построено (снимок книги перед записью).
+     */
+    void compactStrings();
+
+    // Переложить телефоны подряд, выбросив места, освободившиеся после правок
+    void compactPhones();
+
+    // Дата dd-MM-yyyy как (год << 9 | месяц << 5 | день), текстовая - с флагом BirthdayIsText
+    quint32 packBirthday(const QString &text);
+    QString unpackBirthday(quint32 packed) const;
+
+    // Телефон как E.164 (> 0) или минус номер строки в пуле, если запись нестандартная
+    qint64 packPhone(const QString &phone);
+    QString unpackPhone(qint64 packed) const;
+
+    StringPool strings;
+
+    QVector<qint64> ids;
+    QVector<quint32> lastNames;
+    QVector<quint32> firstNames;
+    QVector<quint32> patronymics;
+    QVector<quint32> emails;
+    QVector<quint32> birthdays;
+    QVector<quint8> states;
+    QVector<quint32> versions;
+
+    // Телефоны слота: phoneNumbers[phoneOffsets[slot] .. phoneOffsets[slot] + phoneCounts[slot])
+    QVector<quint32> phoneOffsets;
+    QVector<quint32> phoneCounts;
+    QVector<qint64> phoneNumbers;
+
+    // Сколько элементов phoneNumbers уже никому не принадлежат
+    qsizetype wastedPhones = 0;
+
+    // Сколько полей ссылается на каждую строку пула (у пустой строки 0 - её не считаем)
+    // и сколько символов в строках, на которые ссылок не осталось
+    QVector<quint32> stringRefs = {0};
+    bool stringRefsCounted = true;
+    qsizetype wastedChars = 0;
+};
+
+#endif // CONTACTSTORE_H
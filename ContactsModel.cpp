@@ -0,0 +1,763 @@
+#include "ContactsModel.hpp"
+#include "Trace.hpp"
+#include <QtConcurrent/QtConcurrentRun>
+#include <QStringList>
+#include <algorithm>
+
+static_assert(int(ContactsModel::IdColumn) == ColumnOrder::IdKey && int(ContactsModel::BirthdayColumn) == ColumnOrder::BirthdayKey
+              && int(ContactsModel::ColumnCount) == ColumnOrder::KeyCount, "ключи ColumnOrder идут в порядке колонок");
+
+ContactsModel::ContactsModel(QObject *parent) : QAbstractTableModel(parent) {
+}
+
+int ContactsModel::rowCount(const QModelIndex &parent) const {
+    // Таблица плоская, у строк нет дочерних элементов
+    if (parent.isValid()) return 0;
+    return fetchedRows;
+}
+
+int ContactsModel::columnCount(const QModelIndex &parent) const {
+    if (parent.isValid()) return 0;
+    return ColumnCount;
+}
+
+QString ContactsModel::columnText(const Item &item, int column) {
+    switch (column) {
+    case IdColumn:         return item.userId;
+    case LastNameColumn:   return item.userLastName;
+    case FirstNameColumn:  return item.userFirstName;
+    case PatronymicColumn: return item.userPatronymicName;
+    case PhonesColumn:     return QStringList::fromVector(item.userPhonesList).join(", "); // Отображаем все номера через запятую
+    case EmailColumn:      return item.userEmail;
+    case BirthdayColumn:   return item.userBirthday;
+    }
+    return QString();
+}
+
+QString ContactsModel::cellText(int slot, int column) const {
+    switch (column) {
+    case IdColumn: {
+        qint64 id = contacts.id(slot);
+        return id != 0 ? QString::number(id) : QString();
+    }
+    case LastNameColumn:   return contacts.lastName(slot);
+    case FirstNameColumn:  return contacts.firstName(slot);
+    case PatronymicColumn: return contacts.patronymic(slot);
+    case PhonesColumn:     return QStringList::fromVector(contacts.phones(slot)).join(", ");
+    case EmailColumn:      return contacts.email(slot);
+    case BirthdayColumn:   return contacts.birthday(slot);
+    }
+    return QString();
+}
+
+QVariant ContactsModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= fetchedRows) return QVariant();
+
+    // Строку ячейки собираем только по запросу представления, то есть только для видимых строк
+    if (role == Qt::DisplayRole) {
+        return cellText(rows.at(index.row()), index.column());
+    }
+    return QVariant();
+}
+
+QVariant ContactsModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (role != Qt::DisplayRole) return QVariant();
+
+    if (orientation == Qt::Vertical) return section + 1;
+
+    switch (section) {
+    case IdColumn:         return "#";
+    case LastNameColumn:   return "ФАМИЛИЯ";
+    case FirstNameColumn:  return "ИМЯ";
+    case PatronymicColumn: return "ОТЧЕСТВО";
+    case PhonesColumn:     return "НОМЕР ТЕЛЕФОНА";
+    case EmailColumn:      return "E-MAIL";
+    case BirthdayColumn:   return "ДАТА РОЖДЕНИЯ";
+    }
+    return QVariant();
+}
+
+bool ContactsModel::canFetchMore(const QModelIndex &parent) const {
+    if (parent.isValid()) return false;
+    return fetchedRows < rows.size();
+}
+
+void ContactsModel::fetchMore(const QModelIndex &parent) {
+    if (parent.isValid()) return;
+
+    int remainder = rows.size() - fetchedRows;
+    int itemsToFetch = qMin(FetchBatchSize, remainder);
+    if (itemsToFetch <= 0) return;
+
+    beginInsertRows(QModelIndex(), fetchedRows, fetchedRows + itemsToFetch - 1);
+    fetchedRows += itemsToFetch;
+    endInsertRows();
+}
+
+void ContactsModel::fetchAll() {
+    if (fetchedRows >= rows.size()) return;
+
+    beginInsertRows(QModelIndex(), fetchedRows, rows.size() - 1);
+    fetchedRows = rows.size();
+    endInsertRows();
+}
+
+void ContactsModel::sortSlots(QVector<int> &slotList) {
+    if (sortColumn < 0) {
+        // Без сортировки слоты идут в порядке добавления
+        std::sort(slotList.begin(), slotList.end());
+        return;
+    }
+
+    // Порядок по колонке уже готов: оставляем из него только нужные слоты, без сравнений
+    QVector<bool> selected(contacts.size(), false);
+    for (int slot : slotList) selected[slot] = true;
+
+    const QVector<int> &ordered = columnOrder.orderedSlots(sortColumn, order);
+    slotList.clear();
+    for (int slot : ordered) {
+        if (selected[slot]) slotList.append(slot);
+    }
+    if (sortOrder == Qt::DescendingOrder) std::reverse(slotList.begin(), slotList.end());
+}
+
+void ContactsModel::sort(int column, Qt::SortOrder order) {
+    TraceScope trace("model.sort");
+    if (column < 0 || column >= ColumnCount) return;
+
+    emit layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+
+    // Запоминаем, в каких слотах стоят выделенные строки, чтобы потом вернуть выделение на них
+    const QModelIndexList oldIndexes = persistentIndexList();
+    QVector<int> persistentSlots;
+    persistentSlots.reserve(oldIndexes.size());
+    for (const QModelIndex &oldIndex : oldIndexes) {
+        persistentSlots.append(rows.at(oldIndex.row()));
+    }
+
+    sortColumn = column;
+    sortOrder = order;
+
+    // Сортируем только номера слотов, сами контакты остаются на месте
+    sortSlots(this->order);
+    if (filtered) {
+        sortSlots(rows);
+    } else {
+        rows = this->order;
+    }
+    invalidatePositions();
+
+    QModelIndexList newIndexes;
+    newIndexes.reserve(oldIndexes.size());
+    for (int i = 0; i < oldIndexes.size(); ++i) {
+        int newRow = rowOfSlot(persistentSlots[i]);
+        newIndexes.append(newRow >= 0 && newRow < fetchedRows ? index(newRow, oldIndexes[i].column()) : QModelIndex());
+    }
+    changePersistentIndexList(oldIndexes, newIndexes);
+
+    emit layoutChanged({}, QAbstractItemModel::VerticalSortHint);
+}
+
+int ContactsModel::allocateSlot(const Item &item) {
+    int slot;
+    if (!freeSlots.isEmpty()) {
+        slot = freeSlots.takeLast();
+        contacts.set(slot, item);
+    } else {
+        slot = contacts.append(item);
+    }
+    indexAdd(slot, item);
+    if (qint64 id = contacts.id(slot)) slotById.insert(id, slot);
+    ++contentChanges;
+    return slot;
+}
+
+void ContactsModel::setItems(const QVector<Item> &items) {
+    TraceScope trace("model.reset");
+    beginResetModel();
+    contacts.clear();
+    freeSlots.clear();
+    order.clear();
+    dirty.clear();
+    removed.clear();
+    removedVersions.clear();
+    saving.clear();
+    removedWhileSaving.clear();
+    ++generation;
+    ++contentChanges;
+    ++layoutChanges;
+    searchIndex.clear();
+    fuzzyIndex.clear();
+    indexBuilding = false;
+    staleIndexSlots.clear();
+    slotById.clear();
+    columnOrder.clear();
+    birthdayIndex.clear();
+
+    contacts.reserve(items.size());
+    slotById.reserve(items.size());
+    order.reserve(items.size());
+    for (const Item &item : items) {
+        order.append(allocateSlot(item));
+    }
+    sortSlots(order);
+    rows = order;
+    filtered = false;
+    invalidatePositions();
+
+    // Первую порцию представление запросит само через fetchMore
+    fetchedRows = 0;
+    endResetModel();
+}
+
+void ContactsModel::setContacts(const ContactStore &store) {
+    TraceScope trace("model.adopt");
+    beginResetModel();
+    contacts = store;
+    freeSlots.clear();
+    order.clear();
+    dirty.clear();
+    removed.clear();
+    removedVersions.clear();
+    saving.clear();
+    removedWhileSaving.clear();
+    ++generation;
+    ++contentChanges;
+    ++layoutChanges;
+    searchIndex.clear();
+    fuzzyIndex.clear();
+    slotById.clear();
+    columnOrder.clear();
+    birthdayIndex.clear();
+
+    // Слот без user_id в снимке - освобождённый (несохранённых записей в снимке нет)
+    order.reserve(contacts.size());
+    slotById.reserve(contacts.size());
+    for (int slot = 0; slot < contacts.size(); ++slot) {
+        if (qint64 id = contacts.id(slot)) {
+            order.append(slot);
+            slotById.insert(id, slot);
+        } else {
+            freeSlots.append(slot);
+        }
+    }
+    sortSlots(order);
+    rows = order;
+    filtered = false;
+    invalidatePositions();
+    fetchedRows = 0;
+    endResetModel();
+
+    startIndexBuild();
+}
+
+void ContactsModel::startIndexBuild() {
+    /*
+     * Индексы поиска строятся в фоне по копии хранилища (она ничего не стоит, пока его не меняют).
+     * Пока они строятся, правки модели индексы не трогают, а только запоминают слоты; когда
+     * индексы готовы, эти слоты переиндексируются по их текущему содержимому.
+     */
+    indexBuilding = true;
+    staleIndexSlots.clear();
+
+    const ContactStore built = contacts;
+    const int buildGeneration = generation;
+    indexBuild = QtConcurrent::run([built]() {
+        TraceScope trace("model.indexBuild");
+        BuiltIndexes indexes;
+        for (int slot = 0; slot < built.size(); ++slot) {
+            if (!isLiveSlot(built, slot)) continue;
+            const Item item = built.item(slot);
+            indexes.search.addItem(slot, item);
+            indexes.fuzzy.addItem(slot, item);
+        }
+        return indexes;
+    });
+
+    indexBuild.then(this, [this, built, buildGeneration](const BuiltIndexes &indexes) {
+        // Книгу успели заменить целиком - эти индексы уже ни к чему
+        if (buildGeneration != generation) return;
+
+        searchIndex = indexes.search;
+        fuzzyIndex = indexes.fuzzy;
+        indexBuilding = false;
+
+        for (int slot : std::as_const(staleIndexSlots)) {
+            if (slot < built.size() && isLiveSlot(built, slot)) {
+                const Item old = built.item(slot);
+                searchIndex.removeItem(slot, old);
+                fuzzyIndex.removeItem(slot, old);
+            }
+            if (slot < contacts.size() && isLiveSlot(contacts, slot)) {
+                const Item current = contacts.item(slot);
+                searchIndex.addItem(slot, current);
+                fuzzyIndex.addItem(slot, current);
+            }
+        }
+        staleIndexSlots.clear();
+        emit indexReady();
+    });
+}
+
+bool ContactsModel::isLiveSlot(const ContactStore &store, int slot) {
+    return store.id(slot) != 0 || store.state(slot) == ItemState::Added;
+}
+
+bool ContactsModel::isIndexReady() const {
+    return !indexBuilding;
+}
+
+void ContactsModel::indexAdd(int slot, const Item &item) {
+    if (indexBuilding) {
+        staleIndexSlots.insert(slot);
+        return;
+    }
+    searchIndex.addItem(slot, item);
+    fuzzyIndex.addItem(slot, item);
+}
+
+void ContactsModel::indexRemove(int slot, const Item &item) {
+    if (indexBuilding) {
+        staleIndexSlots.insert(slot);
+        return;
+    }
+    searchIndex.removeItem(slot, item);
+    fuzzyIndex.removeItem(slot, item);
+}
+
+void ContactsModel::appendItem(const Item &item) {
+    Item added = item;
+    added.state = ItemState::Added;
+    int slot = allocateSlot(added);
+    columnOrder.insert(slot);
+    birthdayIndex.insert(slot);
+    dirty.insert(slot);
+    order.append(slot);
+
+    // Новый контакт показываем в конце таблицы, даже если включён фильтр: пользователь только что его добавил.
+    // Если представление ещё не дочитало модель, строка придёт с очередной порцией fetchMore.
+    if (fetchedRows < rows.size()) {
+        rows.append(slot);
+        trackAppended(slot);
+        return;
+    }
+
+    beginInsertRows(QModelIndex(), fetchedRows, fetchedRows);
+    rows.append(slot);
+    trackAppended(slot);
+    ++fetchedRows;
+    endInsertRows();
+}
+
+void ContactsModel::appendLoadedItems(const QVector<Item> &items) {
+    TraceScope trace("model.append");
+    if (items.isEmpty()) return;
+
+    // Если представление уже показало все строки, само оно новых не попросит, поэтому отдаём ему порцию сразу
+    bool viewIsAtEnd = fetchedRows == rows.size();
+
+    order.reserve(order.size() + items.size());
+    QVector<int> newSlots;
+    newSlots.reserve(items.size());
+    for (const Item &item : items) {
+        // Контакт уже пришёл из журнала изменений раньше, чем загрузчик или импорт до него дошли
+        if (slotById.contains(item.userId.toLongLong())) continue;
+
+        int slot = allocateSlot(item);
+        newSlots.append(slot);
+        order.append(slot);
+        if (!filtered) rows.append(slot);
+        trackAppended(slot);
+    }
+    if (newSlots.isEmpty()) return;
+
+    // Страница встраивается в готовые порядки колонок одним слиянием
+    columnOrder.insert(newSlots);
+    birthdayIndex.insert(newSlots);
+
+    if (viewIsAtEnd) {
+        fetchMore(QModelIndex());
+    }
+}
+
+void ContactsModel::updateItem(int row, const Item &item) {
+    if (row < 0 || row >= rows.size()) return;
+
+    storeItem(rows[row], item);
+
+    if (row < fetchedRows) {
+        emit dataChanged(index(row, 0), index(row, ColumnCount - 1), {Qt::DisplayRole});
+    }
+}
+
+void ContactsModel::removeItem(int row) {
+    if (row < 0 || row >= rows.size()) return;
+
+    int slot = rows[row];
+    ensurePositions();
+    const int orderIndex = orderPositions[slot];
+
+    if (row < fetchedRows) {
+        beginRemoveRows(QModelIndex(), row, row);
+        rows.remove(row);
+        --fetchedRows;
+        endRemoveRows();
+    } else {
+        rows.remove(row);
+    }
+    if (orderIndex >= 0) order.remove(orderIndex);
+
+    // Слоты за удалённым сдвинулись на одну позицию
+    for (int i = row; i < rows.size(); ++i) rowPositions[rows[i]] = i;
+    for (int i = qMax(orderIndex, 0); i < order.size(); ++i) orderPositions[order[i]] = i;
+    rowPositions[slot] = -1;
+    orderPositions[slot] = -1;
+
+    releaseSlot(slot);
+}
+
+void ContactsModel::applyEdits(const QVector<int> &updatedSlots, const QVector<Item> &items, const QVector<int> &removedSlots) {
+    TraceScope trace("model.applyEdits");
+    if (updatedSlots.isEmpty() && removedSlots.isEmpty()) return;
+
+    // Правок может быть много, поэтому строки не ищутся по одной: таблица перестраивается один раз
+    beginResetModel();
+    for (int i = 0; i < updatedSlots.size(); ++i) {
+        storeItem(updatedSlots[i], items[i]);
+    }
+
+    QVector<bool> isRemoved(contacts.size(), false);
+    for (int slot : removedSlots) isRemoved[slot] = true;
+    auto removedSlot = [&isRemoved](int slot) { return isRemoved[slot]; };
+    order.erase(std::remove_if(order.begin(), order.end(), removedSlot), order.end());
+    rows.erase(std::remove_if(rows.begin(), rows.end(), removedSlot), rows.end());
+    invalidatePositions();
+    for (int slot : removedSlots) releaseSlot(slot);
+
+    fetchedRows = qMin(fetchedRows, int(rows.size()));
+    endResetModel();
+}
+
+int ContactsModel::applyRemoteChanges(const QVector<Item> &items, const QVector<QString> &removedIds) {
+    TraceScope trace("model.remoteChanges");
+    int applied = 0;
+
+    QVector<Item> added;
+    bool updated = false;
+    for (const Item &item : items) {
+        int slot = slotOfId(item.userId.toLongLong());
+        if (slot < 0) {
+            added.append(item);
+            continue;
+        }
+        // Несохранённую правку не трогаем: при записи она столкнётся с новой версией, и тогда победит БД.
+        // Версия не новее нашей - это наша же запись или то, что уже применено.
+        if (dirty.contains(slot) || saving.contains(slot) || item.version <= contacts.version(slot)) continue;
+
+        Item stored = item;
+        stored.state = ItemState::Clean;
+        replaceItem(slot, stored);
+        updated = true;
+        ++applied;
+    }
+
+    QVector<int> removedSlots;
+    for (const QString &userId : removedIds) {
+        int slot = slotOfId(userId.toLongLong());
+        if (slot < 0 || dirty.contains(slot) || saving.contains(slot)) continue;
+        removedSlots.append(slot);
+    }
+
+    if (!removedSlots.isEmpty()) {
+        QVector<bool> isRemoved(contacts.size(), false);
+        for (int slot : removedSlots) isRemoved[slot] = true;
+        auto removedSlot = [&isRemoved](int slot) { return isRemoved[slot]; };
+        order.erase(std::remove_if(order.begin(), order.end(), removedSlot), order.end());
+        invalidatePositions();
+
+        if (removedSlots.size() <= MaxRowRemovals) {
+            // Удалений немного: убираем строки по одной, выделение и прокрутка в таблице сохраняются
+            for (int row = rows.size() - 1; row >= 0; --row) {
+                if (!isRemoved[rows[row]]) continue;
+                if (row < fetchedRows) {
+                    beginRemoveRows(QModelIndex(), row, row);
+                    rows.remove(row);
+                    --fetchedRows;
+                    endRemoveRows();
+                } else {
+                    rows.remove(row);
+                }
+            }
+        } else {
+            beginResetModel();
+            rows.erase(std::remove_if(rows.begin(), rows.end(), removedSlot), rows.end());
+            fetchedRows = qMin(fetchedRows, int(rows.size()));
+            endResetModel();
+        }
+
+        // Из БД эти записи уже удалены, удалять их ещё раз не нужно
+        for (int slot : removedSlots) releaseSlot(slot, false);
+        applied += removedSlots.size();
+    }
+
+    if (updated && fetchedRows > 0) {
+        // Представление перерисует только видимые строки
+        emit dataChanged(index(0, 0), index(fetchedRows - 1, ColumnCount - 1), {Qt::DisplayRole});
+    }
+
+    if (!added.isEmpty()) {
+        appendLoadedItems(added);
+        applied += added.size();
+    }
+    return applied;
+}
+
+void ContactsModel::storeItem(int slot, const Item &item) {
+    // Новая запись остаётся новой, пока её не вставили в БД.
+    // Версия - та, что сейчас в слоте: если до сохранения запись изменят в другом окне, сохранение это заметит.
+    Item stored = item;
+    stored.state = contacts.state(slot) == ItemState::Added ? ItemState::Added : ItemState::Modified;
+    stored.version = contacts.version(slot);
+    replaceItem(slot, stored);
+    dirty.insert(slot);
+}
+
+void ContactsModel::replaceItem(int slot, const Item &stored) {
+    const Item old = contacts.item(slot);
+    indexRemove(slot, old);
+    columnOrder.remove(slot);
+    birthdayIndex.remove(slot);
+    contacts.set(slot, stored);
+    columnOrder.insert(slot);
+    birthdayIndex.insert(slot);
+    indexAdd(slot, stored);
+    ++contentChanges;
+}
+
+void ContactsModel::releaseSlot(int slot, bool deleteFromDatabase) {
+    // Если запись уже есть в БД, её нужно будет оттуда удалить
+    if (deleteFromDatabase && contacts.state(slot) != ItemState::Added) {
+        removed.append(QString::number(contacts.id(slot)));
+        removedVersions.append(contacts.version(slot));
+    }
+    dirty.remove(slot);
+    const Item old = contacts.item(slot);
+    indexRemove(slot, old);
+    columnOrder.remove(slot);
+    birthdayIndex.remove(slot);
+    slotById.remove(contacts.id(slot));
+
+    // Слот освобождается и достанется следующему новому контакту.
+    // Если запись сейчас сохраняется, слот освободит markSaved/saveFailed, когда ответит БД.
+    contacts.erase(slot);
+    ++contentChanges;
+    ++layoutChanges;
+    if (saving.contains(slot)) {
+        removedWhileSaving.insert(slot);
+    } else {
+        freeSlots.append(slot);
+    }
+}
+
+bool ContactsModel::hasChanges() const {
+    return !dirty.isEmpty() || !removed.isEmpty();
+}
+
+ContactsModel::PendingChanges ContactsModel::takeChanges() {
+    TraceScope trace("model.takeChanges");
+    PendingChanges changes;
+    changes.generation = generation;
+    changes.removedIds = removed;
+    changes.removedVersions = removedVersions;
+    removed.clear();
+    removedVersions.clear();
+
+    QVector<int> slotList(dirty.cbegin(), dirty.cend());
+    // Новые записи вставляем в том порядке, в котором они появились
+    std::sort(slotList.begin(), slotList.end());
+
+    for (int slot : slotList) {
+        // Прошлое сохранение этой записи ещё идёт (например, INSERT ещё не вернул user_id)
+        if (saving.contains(slot)) continue;
+
+        changes.slotList.append(slot);
+        changes.items.append(contacts.item(slot));
+        saving.insert(slot);
+        dirty.remove(slot);
+    }
+    return changes;
+}
+
+void ContactsModel::markSaved(const PendingChanges &changes, const QVector<QString> &userIds, const QVector<quint32> &versions) {
+    TraceScope trace("model.markSaved");
+    if (changes.generation != generation) return;
+
+    for (int i = 0; i < changes.slotList.size(); ++i) {
+        int slot = changes.slotList[i];
+        const QString userId = userIds.value(i);
+        saving.remove(slot);
+
+        if (removedWhileSaving.remove(slot)) {
+            // Запись удалили, пока её вставляли: теперь, когда известен её user_id, её нужно удалить из БД
+            if (changes.items[i].state == ItemState::Added && !userId.isEmpty()) {
+                removed.append(userId);
+                removedVersions.append(versions.value(i));
+            }
+            freeSlots.append(slot);
+            continue;
+        }
+
+        if (contacts.state(slot) == ItemState::Added && !userId.isEmpty()) {
+            // user_id - ключ колонки "#", так что запись переезжает в её порядке
+            columnOrder.remove(slot);
+            contacts.setId(slot, userId.toLongLong());
+            columnOrder.insert(slot);
+            slotById.insert(contacts.id(slot), slot);
+
+            // Поменялся только номер в колонке "#"
+            int row = rowOfSlot(slot);
+            if (row >= 0 && row < fetchedRows) {
+                emit dataChanged(index(row, IdColumn), index(row, IdColumn), {Qt::DisplayRole});
+            }
+        }
+
+        // Версия 0 - запись не записана из-за чужой правки, её содержимое из БД придёт через applyRemoteChanges
+        if (quint32 version = versions.value(i)) contacts.setVersion(slot, version);
+
+        // Если запись успели изменить ещё раз, она остаётся несохранённой
+        contacts.setState(slot, dirty.contains(slot) ? ItemState::Modified : ItemState::Clean);
+    }
+}
+
+void ContactsModel::saveFailed(const PendingChanges &changes) {
+    if (changes.generation != generation) return;
+
+    // Удаления возвращаем в очередь раньше тех, что накопились за время сохранения
+    removed = changes.removedIds + removed;
+    removedVersions = changes.removedVersions + removedVersions;
+
+    for (int slot : changes.slotList) {
+        saving.remove(slot);
+        if (removedWhileSaving.remove(slot)) {
+            // Транзакция откатилась: новой записи в БД нет, а удаление старой уже стоит в removed
+            freeSlots.append(slot);
+            continue;
+        }
+        dirty.insert(slot);
+    }
+}
+
+ContactsModel::SearchSnapshot ContactsModel::searchSnapshot() const {
+    SearchSnapshot snapshot;
+    snapshot.contacts = contacts;
+    snapshot.index = searchIndex;
+    snapshot.fuzzy = fuzzyIndex;
+    snapshot.contentRevision = contentChanges;
+    snapshot.layoutRevision = layoutChanges;
+    return snapshot;
+}
+
+quint64 ContactsModel::contentRevision() const {
+    return contentChanges;
+}
+
+quint64 ContactsModel::layoutRevision() const {
+    return layoutChanges;
+}
+
+QVector<int> ContactsModel::search(const QString &query) const {
+    TraceScope trace("search.memory");
+    return searchIndex.search(query);
+}
+
+QVector<BirthdayIndex::Upcoming> ContactsModel::upcomingBirthdays(const QDate &from, int days) {
+    TraceScope trace("birthdays.upcoming");
+    birthdayIndex.build(order);
+    return birthdayIndex.upcoming(from, days);
+}
+
+QVector<int> ContactsModel::bornBetween(const QDate &first, const QDate &last) {
+    TraceScope trace("birthdays.born");
+    birthdayIndex.build(order);
+    return birthdayIndex.bornBetween(first, last);
+}
+
+void ContactsModel::setFilter(const QVector<int> &slotList, bool ranked) {
+    TraceScope trace("model.filter");
+    beginResetModel();
+    rows = slotList;
+    // Найденные контакты показываем в том же порядке, что и всю книгу, если поиск сам их не упорядочил
+    if (!ranked) sortSlots(rows);
+    filtered = true;
+    invalidatePositions();
+    fetchedRows = 0;
+    endResetModel();
+}
+
+void ContactsModel::clearFilter() {
+    TraceScope trace("model.clearFilter");
+    if (!filtered) return;
+
+    beginResetModel();
+    rows = order;
+    filtered = false;
+    invalidatePositions();
+    fetchedRows = 0;
+    endResetModel();
+}
+
+bool ContactsModel::isFiltered() const {
+    return filtered;
+}
+
+Item ContactsModel::item(int row) const {
+    return contacts.item(rows.at(row));
+}
+
+Item ContactsModel::itemAt(int slot) const {
+    return contacts.item(slot);
+}
+
+int ContactsModel::slotAt(int row) const {
+    return rows.at(row);
+}
+
+int ContactsModel::rowOfSlot(int slot) const {
+    ensurePositions();
+    return slot >= 0 && slot < rowPositions.size() ? rowPositions[slot] : -1;
+}
+
+void ContactsModel::invalidatePositions() {
+    positionsValid = false;
+}
+
+void ContactsModel::ensurePositions() const {
+    if (positionsValid) return;
+    rowPositions.fill(-1, contacts.size());
+    orderPositions.fill(-1, contacts.size());
+    for (int i = 0; i < rows.size(); ++i) rowPositions[rows[i]] = i;
+    for (int i = 0; i < order.size(); ++i) orderPositions[order[i]] = i;
+    positionsValid = true;
+}
+
+void ContactsModel::trackAppended(int slot) {
+    if (!positionsValid) return;
+    if (rowPositions.size() < contacts.size()) {
+        rowPositions.resize(contacts.size(), -1);
+        orderPositions.resize(contacts.size(), -1);
+    }
+    orderPositions[slot] = order.size() - 1;
+    rowPositions[slot] = !rows.isEmpty() && rows.last() == slot ? rows.size() - 1 : -1;
+}
+
+int ContactsModel::slotOfId(qint64 userId) const {
+    return slotById.value(userId, -1);
+}
+
+int ContactsModel::contactCount() const {
+    return order.size();
+}
+
+qsizetype ContactsModel::memoryUsage() const {
+    return contacts.memoryUsage();
+}
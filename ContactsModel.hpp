@@ -0,0 +1,310 @@
+#ifndef CONTACTSMODEL_H
+#define CONTACTSMODEL_H
+
+#include <QAbstractTableModel>
+#include <QFuture>
+#include <QVector>
+#include <QSet>
+#include <QHash>
+
+#include "Item.hpp"
+#include "ContactStore.hpp"
+#include "ColumnOrder.hpp"
+#include "BirthdayIndex.hpp"
+#include "SearchIndex.hpp"
+#include "FuzzyIndex.hpp"
+
+/*
+ * Модель контактов для QTableView.
+ * Хранит контакты один раз в компактном ContactStore (никаких QTableWidgetItem на каждую ячейку), а строки
+ * отдаёт представлению порциями через canFetchMore/fetchMore, так что таблица
+ * создаёт только то, что реально видно на экране.
+ *
+ * Каждый контакт лежит в своём слоте, и номер слота не меняется, пока контакт жив.
+ * Сортировка и фильтр переставляют только список слотов, а индексы (поиск,
+ * несохранённые изменения) ссылаются на слоты и поэтому не перестраиваются.
+ */
+class ContactsModel : public QAbstractTableModel {
+    Q_OBJECT
+
+public:
+    // Порядок колонок совпадает со старой QTableWidget
+    enum Column {
+        IdColumn,
+        LastNameColumn,
+        FirstNameColumn,
+        PatronymicColumn,
+        PhonesColumn,
+        EmailColumn,
+        BirthdayColumn,
+        ColumnCount
+    };
+
+    explicit ContactsModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    // Ленивое наполнение: представление само просит следующую порцию строк при прокрутке
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+    // Полностью заменить содержимое модели (например, после загрузки из БД)
+    void setItems(const QVector<Item> &items);
+
+    /*
+     * Заменить содержимое готовым хранилищем (снимок книги с диска): без сборки Item на каждый контакт.
+     * Слоты без user_id считаются свободными. Индексы поиска строятся в фоне; пока они не готовы
+     * (isIndexReady), search и снимки для поиска находят не всё: LiveSearch ищет просмотром, а нечёткий поиск
+     * не находит ничего. По сигналу indexReady поиск стоит повторить.
+     */
+    void setContacts(const ContactStore &store);
+
+    bool isIndexReady() const;
+
+    // Точечные изменения, которые не трогают остальные строки.
+    // Все они помечают запись как изменённую, чтобы saveAddressBook записал только её.
+    // row - номер строки в таблице (с учётом сортировки и фильтра).
+    void appendItem(const Item &item);
+    void updateItem(int row, const Item &item);
+    void removeItem(int row);
+
+    // Много правок сразу (например, слияние повторов): записать items в updatedSlots и удалить removedSlots.
+    // Таблица перестраивается один раз, а не по строке на правку.
+    void applyEdits(const QVector<int> &updatedSlots, const QVector<Item> &items, const QVector<int> &removedSlots);
+
+    // Добавить в конец уже сохранённые в БД контакты (очередная страница фоновой загрузки).
+    // Контакты, которые уже есть в модели, пропускаются.
+    void appendLoadedItems(const QVector<Item> &items);
+
+    /*
+     * Применить изменения, сделанные в БД другими (другие окна, импорт, addressbook-cli): items - текущее
+     * содержимое изменённых контактов, removedIds - удалённые. Записи с несохранёнными правками не трогаются,
+     * чтобы их судьбу решила запись в БД. Вернуть, сколько контактов изменилось в модели.
+     */
+    int applyRemoteChanges(const QVector<Item> &items, const QVector<QString> &removedIds);
+
+    /*
+     * Изменения, которые уходят в БД одним сохранением.
+     * Сохранение идёт в потоке БД, а пользователь тем временем может снова править
+     * или удалять те же записи, поэтому модель помнит, какие слоты сейчас сохраняются.
+     */
+    struct PendingChanges {
+        int generation = 0;
+        QVector<int> slotList;          // слоты записанных записей
+        QVector<Item> items;            // их содержимое на момент начала сохранения
+        QVector<QString> removedIds;    // user_id удалённых записей
+        QVector<quint32> removedVersions;   // и их версии, с которыми сверится удаление в БД
+
+        bool isEmpty() const { return slotList.isEmpty() && removedIds.isEmpty(); }
+    };
+
+    // Есть ли несохранённые изменения
+    bool hasChanges() const;
+
+    // Забрать изменения для сохранения. Записи, чьё прошлое сохранение ещё не закончилось, остаются на следующий раз.
+    PendingChanges takeChanges();
+
+    // Сохранение прошло. userIds - выданные базой user_id (для новых записей), versions - версии записей в БД,
+    // по одному на запись (версия 0 - запись не записана из-за чужой правки).
+    void markSaved(const PendingChanges &changes, const QVector<QString> &userIds, const QVector<quint32> &versions);
+
+    // Сохранение не удалось: изменения снова считаются несохранёнными
+    void saveFailed(const PendingChanges &changes);
+
+    // Поиск по индексу, возвращает слоты подходящих контактов
+    QVector<int> search(const QString &query) const;
+
+    /*
+     * Напоминания о днях рождения по индексу дат, O(log n + k). Индекс строится при первом запросе.
+     * upcomingBirthdays - дни рождения в окне из days дней начиная с from (через Новый год тоже), по дате;
+     * bornBetween - слоты контактов, родившихся в [first, last], по дате рождения.
+     * Даты, записанные произвольным текстом, не находятся.
+     */
+    QVector<BirthdayIndex::Upcoming> upcomingBirthdays(const QDate &from, int days);
+    QVector<int> bornBetween(const QDate &first, const QDate &last);
+
+    /*
+     * Снимок книги для поиска в другом потоке. ContactStore и SearchIndex построены на
+     * implicitly shared контейнерах Qt, поэтому копия стоит несколько счётчиков ссылок,
+     * а правки модели после снимка копируют данные себе и снимок не трогают.
+     */
+    struct SearchSnapshot {
+        ContactStore contacts;
+        SearchIndex index;
+        FuzzyIndex fuzzy;
+        quint64 contentRevision = 0;
+        quint64 layoutRevision = 0;
+    };
+    SearchSnapshot searchSnapshot() const;
+
+    // Растёт при любом изменении контактов
+    quint64 contentRevision() const;
+
+    // Растёт, когда слоты перестают значить то, что значили (удаление, замена книги)
+    quint64 layoutRevision() const;
+
+    // Показывать в таблице только контакты из этих слотов / снова показывать все.
+    // ranked - слоты уже упорядочены по степени совпадения, так и показываем.
+    void setFilter(const QVector<int> &slotList, bool ranked = false);
+    void clearFilter();
+    bool isFiltered() const;
+
+    // Контакт в строке таблицы (собирается из ContactStore)
+    Item item(int row) const;
+
+    // Контакт в слоте
+    Item itemAt(int slot) const;
+
+    // Слот строки таблицы и строка слота (-1, если слот сейчас не показан)
+    int slotAt(int row) const;
+    int rowOfSlot(int slot) const;
+
+    // Слот контакта с этим user_id (-1, если такого нет), за O(1)
+    int slotOfId(qint64 userId) const;
+
+    // Сколько всего контактов (включая отфильтрованные и ещё не показанные)
+    int contactCount() const;
+
+    // Обойти все контакты в текущем порядке сортировки
+    template<typename Function>
+    void forEachItem(Function function) const {
+        for (int slot : order) function(contacts.item(slot));
+    }
+
+    // Сколько байт занимают сами контакты (без индекса поиска)
+    qsizetype memoryUsage() const;
+
+    // Отдать представлению все оставшиеся строки
+    void fetchAll();
+
+    // Текст ячейки так, как он показывается в таблице
+    static QString columnText(const Item &item, int column);
+
+signals:
+    // Индексы поиска, которые строились в фоне после setContacts, готовы
+    void indexReady();
+
+private:
+    // Индексы поиска, построенные в фоне
+    struct BuiltIndexes {
+        SearchIndex search;
+        FuzzyIndex fuzzy;
+    };
+
+    // Запустить фоновое построение индексов по текущему содержимому
+    void startIndexBuild();
+
+    // Добавить контакт в индексы поиска / убрать из них (пока индексы строятся - только запомнить слот)
+    void indexAdd(int slot, const Item &item);
+    void indexRemove(int slot, const Item &item);
+
+    // В слоте живой контакт (сохранённый или ещё не записанный), а не освобождённое место
+    static bool isLiveSlot(const ContactStore &store, int slot);
+
+    // Положить контакт в свободный слот (или в новый в конце)
+    int allocateSlot(const Item &item);
+
+    // Записать контакт в слот и обновить индексы; запись помечается изменённой
+    void storeItem(int slot, const Item &item);
+
+    // Заменить содержимое слота как есть (вместе с состоянием и версией) и обновить индексы
+    void replaceItem(int slot, const Item &stored);
+
+    // Удалить контакт из слота и индексов (строки таблицы и order - забота вызывающего).
+    // deleteFromDatabase = false - записи в БД уже нет, удалять её при сохранении не нужно.
+    void releaseSlot(int slot, bool deleteFromDatabase = true);
+
+    // Упорядочить слоты по текущей колонке сортировки
+    void sortSlots(QVector<int> &slotList);
+
+    // Текст ячейки контакта из слота, без сборки всего Item
+    QString cellText(int slot, int column) const;
+
+    // Позиции слотов в rows и order устарели (rows или order переставлены целиком)
+    void invalidatePositions();
+
+    // Перестроить позиции, если они устарели, O(n)
+    void ensurePositions() const;
+
+    // slot только что дописан в конец order (и, может быть, rows): поправить позиции без перестройки
+    void trackAppended(int slot);
+
+    // Слоты контактов. Освободившиеся слоты переиспользуются.
+    ContactStore contacts;
+    QVector<int> freeSlots;
+
+    // Первичный ключ: user_id -> слот (у новых записей user_id появится после сохранения)
+    QHash<qint64, int> slotById;
+
+    // Порядок слотов по каждой колонке, по которой уже сортировали
+    ColumnOrder columnOrder{contacts};
+
+    // Дни рождения по месяцу и дню и по дате, для напоминаний
+    BirthdayIndex birthdayIndex{contacts};
+
+    // Все живые слоты в порядке сортировки
+    QVector<int> order;
+
+    // Строки таблицы: совпадает с order, а при фильтре - только подходящие слоты
+    QVector<int> rows;
+    bool filtered = false;
+
+    /*
+     * Обратные отображения: слот -> номер в rows и в order (-1 - слота там нет), чтобы rowOfSlot и удаление
+     * строки не искали слот просмотром. После перестановок целиком (сортировка, фильтр, пакетные удаления)
+     * строятся заново при первом обращении; добавление в конец и удаление одной строки правят их на месте.
+     */
+    mutable QVector<int> rowPositions;
+    mutable QVector<int> orderPositions;
+    mutable bool positionsValid = false;
+
+    // Сколько строк уже отдано представлению
+    int fetchedRows = 0;
+
+    // Текущая сортировка (-1 - в порядке добавления)
+    int sortColumn = -1;
+    Qt::SortOrder sortOrder = Qt::AscendingOrder;
+
+    // Слоты с state != Clean. Держим их отдельно, чтобы сохранение не просматривало всю книгу.
+    QSet<int> dirty;
+
+    // Удалённые записи, которые ещё есть в БД, и их версии на момент удаления
+    QVector<QString> removed;
+    QVector<quint32> removedVersions;
+
+    // Слоты, которые сейчас сохраняются, и те из них, что удалили до конца сохранения
+    // (такой слот освобождается только после ответа БД)
+    QSet<int> saving;
+    QSet<int> removedWhileSaving;
+
+    // Растёт при каждой замене содержимого (setItems): ответ на старое сохранение уже не относится к слотам
+    int generation = 0;
+
+    // Индекс для поиска, обновляется при каждом изменении контакта
+    SearchIndex searchIndex;
+
+    // Словарь слов ФИО для нечёткого поиска
+    FuzzyIndex fuzzyIndex;
+
+    // Индексы строятся в фоне; слоты, изменённые за это время, переиндексируются, когда они будут готовы
+    bool indexBuilding = false;
+    QSet<int> staleIndexSlots;
+    QFuture<BuiltIndexes> indexBuild;
+
+    // Счётчики изменений для contentRevision() и layoutRevision()
+    quint64 contentChanges = 0;
+    quint64 layoutChanges = 0;
+
+    // Размер порции для fetchMore
+    static constexpr int FetchBatchSize = 256;
+
+    // Сколько чужих удалений убирать из таблицы по строке; больше - таблица перестраивается целиком
+    static constexpr int MaxRowRemovals = 64;
+};
+
+#endif // CONTACTSMODEL_H
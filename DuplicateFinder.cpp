@@ -0,0 +1,352 @@
+#include "DuplicateFinder.hpp"
+#include "EditDistance.hpp"
+#include "FuzzyIndex.hpp"
+#include "PhoneNumber.hpp"
+#include "Trace.hpp"
+#include <QHash>
+#include <QPair>
+#include <QtConcurrent/QtConcurrentMap>
+#include <algorithm>
+#include <numeric>
+
+namespace {
+
+// Разные соли для разных видов блоков, чтобы телефон и e-mail с одинаковым хешем не попали в один блок
+constexpr size_t PhoneSeed = 0x9e3779b1u;
+constexpr size_t EmailSeed = 0x85ebca77u;
+constexpr size_t NameSeed = 0xc2b2ae3du;
+
+// Хеш ключа в старших 32 битах, слот - в младших: сортировка сразу раскладывает контакты по блокам
+quint64 blockEntry(size_t hash, int slot) {
+    return quint64(quint32(hash ^ (quint64(hash) >> 32))) << 32 | quint32(slot);
+}
+
+quint32 entryBlock(quint64 entry) {
+    return quint32(entry >> 32);
+}
+
+int entrySlot(quint64 entry) {
+    return int(quint32(entry));
+}
+
+// Системы непересекающихся множеств: слоты одной группы повторов
+class DisjointSets {
+public:
+    explicit DisjointSets(int size) : parent(size) {
+        std::iota(parent.begin(), parent.end(), 0);
+    }
+
+    int find(int x) {
+        while (parent[x] != x) {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
+    }
+
+    void unite(int a, int b) {
+        a = find(a);
+        b = find(b);
+        // Корнем остаётся меньший слот - так группа не зависит от порядка пар
+        if (a != b) parent[qMax(a, b)] = qMin(a, b);
+    }
+
+private:
+    QVector<int> parent;
+};
+
+}
+
+DuplicateFinder::DuplicateFinder(const ContactStore &contacts) : contacts(contacts) {
+}
+
+DuplicateFinder::Names DuplicateFinder::prepareNames() const {
+    // Приводим только строки, которые служат частями ФИО: e-mail и нестандартные телефоны не нужны
+    Names names;
+    const int count = contacts.stringCount();
+    names.folded.resize(count);
+    names.latin.resize(count);
+
+    QVector<bool> isName(count, false);
+    for (int slot = 0; slot < contacts.size(); ++slot) {
+        isName[contacts.lastNameId(slot)] = true;
+        isName[contacts.firstNameId(slot)] = true;
+        isName[contacts.patronymicId(slot)] = true;
+    }
+    for (int id = 0; id < count; ++id) {
+        if (!isName[id]) continue;
+        names.folded[id] = FuzzyIndex::foldName(contacts.stringView(id).toString());
+        names.latin[id] = FuzzyIndex::transliterate(names.folded[id]);
+    }
+    return names;
+}
+
+qint64 DuplicateFinder::phoneNumber(int slot, int index) const {
+    if (qint64 number = contacts.phoneE164(slot, index)) return number;
+
+    const QString text = contacts.phoneTextView(slot, index).toString();
+    if (qint64 number = PhoneNumber::toE164(text)) return number;
+
+    // Номер не в российском формате: сравниваем просто цифры, если их достаточно
+    QString digits;
+    for (QChar ch : text) {
+        if (ch.isDigit()) digits.append(ch);
+    }
+    return digits.size() >= 7 && digits.size() <= 18 ? digits.toLongLong() : 0;
+}
+
+QVector<quint64> DuplicateFinder::blockKeys(int begin, int end, const Names &names) const {
+    QVector<quint64> keys;
+    keys.reserve((end - begin) * 3);
+    for (int slot = begin; slot < end; ++slot) {
+        for (int i = 0; i < contacts.phoneCount(slot); ++i) {
+            if (qint64 number = phoneNumber(slot, i)) keys.append(blockEntry(qHash(number, PhoneSeed), slot));
+        }
+
+        const QStringView email = contacts.emailView(slot).trimmed();
+        if (!email.isEmpty()) keys.append(blockEntry(qHash(email.toString().toCaseFolded(), EmailSeed), slot));
+
+        // ФИО без телефона и e-mail - слабая улика, поэтому блок только вместе с датой рождения
+        const quint32 birthday = contacts.packedBirthday(slot);
+        const QString &lastName = names.latin[contacts.lastNameId(slot)];
+        if (birthday != 0 && !lastName.isEmpty()) {
+            const QString key = lastName + '|' + names.latin[contacts.firstNameId(slot)];
+            keys.append(blockEntry(qHash(key, NameSeed ^ birthday), slot));
+        }
+    }
+    // Один и тот же телефон, записанный дважды, не должен давать пару контакта с самим собой
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    return keys;
+}
+
+DuplicateFinder::NameMatch DuplicateFinder::compareNames(quint32 a, quint32 b, bool allowInitial, const Names &names) const {
+    if (a == b) return a == 0 ? NameMatch::Unknown : NameMatch::Exact;
+
+    const QString &foldedA = names.folded[a];
+    const QString &foldedB = names.folded[b];
+    if (foldedA.isEmpty() || foldedB.isEmpty()) return NameMatch::Unknown;
+    if (foldedA == foldedB) return NameMatch::Exact;
+
+    // Сравниваем латиницей: так "Пётр" и "Petr" совпадают, а опечатка в любой записи - одна правка
+    const QString &latinA = names.latin[a];
+    const QString &latinB = names.latin[b];
+    if (latinA == latinB) return NameMatch::Exact;
+
+    // "И" и "Иван": инициал подходит к любому имени на эту букву
+    if (allowInitial && (foldedA.size() == 1 || foldedB.size() == 1)) {
+        const bool sameInitial = foldedA.front() == foldedB.front()
+                                 || (!latinA.isEmpty() && !latinB.isEmpty() && latinA.front() == latinB.front());
+        return sameInitial ? NameMatch::Similar : NameMatch::Different;
+    }
+
+    const int allowed = FuzzyIndex::maxDistance(int(qMin(foldedA.size(), foldedB.size())));
+    if (allowed > 0 && EditDistance(latinA).distance(latinB) <= allowed) return NameMatch::Similar;
+    return NameMatch::Different;
+}
+
+int DuplicateFinder::matchScore(int a, int b, const Names &names) const {
+    // Разные даты рождения - разные люди, даже с одним телефоном (родственники)
+    const quint32 birthdayA = contacts.packedBirthday(a);
+    const quint32 birthdayB = contacts.packedBirthday(b);
+    if (birthdayA != 0 && birthdayB != 0 && birthdayA != birthdayB) return 0;
+    const bool sameBirthday = birthdayA != 0 && birthdayA == birthdayB;
+
+    bool sharedPhone = false;
+    for (int i = 0; i < contacts.phoneCount(a) && !sharedPhone; ++i) {
+        const qint64 number = phoneNumber(a, i);
+        if (number == 0) continue;
+        for (int j = 0; j < contacts.phoneCount(b); ++j) {
+            if (phoneNumber(b, j) == number) {
+                sharedPhone = true;
+                break;
+            }
+        }
+    }
+
+    const bool emailMatch = !contacts.emailView(a).trimmed().isEmpty() && sameEmail(a, b);
+
+    if (!sharedPhone && !emailMatch && !sameBirthday) return 0;
+
+    const NameMatch lastName = compareNames(contacts.lastNameId(a), contacts.lastNameId(b), false, names);
+    const NameMatch firstName = compareNames(contacts.firstNameId(a), contacts.firstNameId(b), true, names);
+    const NameMatch patronymic = compareNames(contacts.patronymicId(a), contacts.patronymicId(b), true, names);
+    if (lastName == NameMatch::Different || firstName == NameMatch::Different || patronymic == NameMatch::Different) return 0;
+
+    // Совпадение одной только даты рождения требует и фамилии, и имени
+    const bool namesKnown = lastName != NameMatch::Unknown && firstName != NameMatch::Unknown;
+    if (!namesKnown && (!(sharedPhone || emailMatch) || (lastName == NameMatch::Unknown && firstName == NameMatch::Unknown))) return 0;
+
+    const bool namesExact = lastName == NameMatch::Exact && firstName == NameMatch::Exact && patronymic != NameMatch::Similar;
+    int score = (sharedPhone ? 40 : 0) + (emailMatch ? 30 : 0) + (sameBirthday ? 15 : 0) + (namesExact ? 15 : 5);
+    return qMin(score, 100);
+}
+
+bool DuplicateFinder::sameEmail(int a, int b) const {
+    return contacts.emailView(a).trimmed().compare(contacts.emailView(b).trimmed(), Qt::CaseInsensitive) == 0;
+}
+
+QVector<DuplicateFinder::Pair> DuplicateFinder::compareBlocks(const QVector<quint64> &keys, qsizetype begin, qsizetype end,
+                                                              const Names &names) const {
+    QVector<Pair> pairs;
+    for (qsizetype first = begin; first < end;) {
+        qsizetype last = first + 1;
+        while (last < end && entryBlock(keys[last]) == entryBlock(keys[first])) ++last;
+
+        // Внутри блока слоты идут по возрастанию; в большом блоке - только ближайшие соседи
+        for (qsizetype i = first; i < last; ++i) {
+            const qsizetype windowEnd = qMin(last, i + 1 + WindowSize);
+            for (qsizetype j = i + 1; j < windowEnd; ++j) {
+                const int a = entrySlot(keys[i]);
+                const int b = entrySlot(keys[j]);
+                if (int score = matchScore(a, b, names)) pairs.append({a, b, score});
+            }
+        }
+        first = last;
+    }
+    return pairs;
+}
+
+Item DuplicateFinder::mergeGroup(const QVector<int> &slotList) const {
+    Item merged = contacts.item(slotList.first());
+
+    QVector<qint64> numbers;
+    for (int i = 0; i < contacts.phoneCount(slotList.first()); ++i) numbers.append(phoneNumber(slotList.first(), i));
+
+    for (int k = 1; k < slotList.size(); ++k) {
+        const Item other = contacts.item(slotList[k]);
+        if (merged.userLastName.isEmpty()) merged.userLastName = other.userLastName;
+        if (merged.userFirstName.isEmpty()) merged.userFirstName = other.userFirstName;
+        if (merged.userPatronymicName.isEmpty()) merged.userPatronymicName = other.userPatronymicName;
+        if (merged.userEmail.isEmpty()) merged.userEmail = other.userEmail;
+        if (merged.userBirthday.isEmpty()) merged.userBirthday = other.userBirthday;
+
+        // Телефоны всех записей, каждый номер один раз (в какой бы записи он ни был)
+        for (int i = 0; i < other.userPhonesList.size(); ++i) {
+            const qint64 number = phoneNumber(slotList[k], i);
+            const bool known = number != 0 ? numbers.contains(number) : merged.userPhonesList.contains(other.userPhonesList[i]);
+            if (known) continue;
+            merged.userPhonesList.append(other.userPhonesList[i]);
+            numbers.append(number);
+        }
+    }
+    return merged;
+}
+
+QVector<DuplicateFinder::Group> DuplicateFinder::find(const std::function<bool()> &isCanceled) const {
+    TraceScope trace("dedupe.find");
+    const int size = contacts.size();
+    if (size < 2) return {};
+
+    const Names names = prepareNames();
+
+    // Раскладка по блокам: ключи порциями во всех ядрах, затем одна сортировка
+    QVector<QPair<int, int>> chunks;
+    for (int begin = 0; begin < size; begin += ChunkSize) chunks.append({begin, qMin(size, begin + ChunkSize)});
+    std::function<QVector<quint64>(const QPair<int, int> &)> keyChunk = [&](const QPair<int, int> &chunk) {
+        if (isCanceled && isCanceled()) return QVector<quint64>();
+        return blockKeys(chunk.first, chunk.second, names);
+    };
+    const QVector<QVector<quint64>> keyParts = QtConcurrent::blockingMapped<QVector<QVector<quint64>>>(chunks, keyChunk);
+    if (isCanceled && isCanceled()) return {};
+
+    QVector<quint64> keys;
+    qsizetype total = 0;
+    for (const QVector<quint64> &part : keyParts) total += part.size();
+    keys.reserve(total);
+    for (const QVector<quint64> &part : keyParts) keys += part;
+    std::sort(keys.begin(), keys.end());
+    Trace::count("dedupe.keys", keys.size());
+
+    // Порции для сравнения режутся только по границам блоков
+    QVector<QPair<qsizetype, qsizetype>> ranges;
+    for (qsizetype begin = 0; begin < keys.size();) {
+        qsizetype end = qMin<qsizetype>(keys.size(), begin + ChunkSize);
+        while (end < keys.size() && entryBlock(keys[end]) == entryBlock(keys[end - 1])) ++end;
+        ranges.append({begin, end});
+        begin = end;
+    }
+    std::function<QVector<Pair>(const QPair<qsizetype, qsizetype> &)> compareChunk = [&](const QPair<qsizetype, qsizetype> &range) {
+        if (isCanceled && isCanceled()) return QVector<Pair>();
+        return compareBlocks(keys, range.first, range.second, names);
+    };
+    const QVector<QVector<Pair>> pairParts = QtConcurrent::blockingMapped<QVector<QVector<Pair>>>(ranges, compareChunk);
+    if (isCanceled && isCanceled()) return {};
+
+    /*
+     * Пары склеиваются в группы: повтор повтора - тоже повтор, но только пока группа не противоречит себе.
+     * У каждой группы помним её дату рождения и слот с её e-mail (0 и -1 - пока неизвестны); пара,
+     * которая свела бы вместе две разные даты или два разных e-mail, отбрасывается.
+     * Пары идут от самых уверенных, так что при споре побеждает более надёжное совпадение.
+     */
+    QVector<Pair> pairs;
+    for (const QVector<Pair> &part : pairParts) pairs += part;
+    std::sort(pairs.begin(), pairs.end(), [](const Pair &a, const Pair &b) {
+        if (a.score != b.score) return a.score > b.score;
+        return a.first != b.first ? a.first < b.first : a.second < b.second;
+    });
+
+    DisjointSets sets(size);
+    QVector<quint32> groupBirthday(size, 0);
+    QVector<int> groupEmail(size, -1);
+    QVector<Pair> accepted;
+    for (const Pair &pair : std::as_const(pairs)) {
+        const int rootA = sets.find(pair.first);
+        const int rootB = sets.find(pair.second);
+        if (rootA != rootB) {
+            const quint32 birthdayA = groupBirthday[rootA] ? groupBirthday[rootA] : contacts.packedBirthday(pair.first);
+            const quint32 birthdayB = groupBirthday[rootB] ? groupBirthday[rootB] : contacts.packedBirthday(pair.second);
+            if (birthdayA != 0 && birthdayB != 0 && birthdayA != birthdayB) continue;
+
+            auto emailOf = [this, &groupEmail](int root, int slot) {
+                if (groupEmail[root] >= 0) return groupEmail[root];
+                return contacts.emailView(slot).trimmed().isEmpty() ? -1 : slot;
+            };
+            const int emailA = emailOf(rootA, pair.first);
+            const int emailB = emailOf(rootB, pair.second);
+            if (emailA >= 0 && emailB >= 0 && !sameEmail(emailA, emailB)) continue;
+
+            sets.unite(rootA, rootB);
+            const int root = sets.find(rootA);
+            groupBirthday[root] = birthdayA ? birthdayA : birthdayB;
+            groupEmail[root] = emailA >= 0 ? emailA : emailB;
+        }
+        accepted.append(pair);
+    }
+
+    QHash<int, int> groupOfRoot;
+    QVector<Group> groups;
+    for (const Pair &pair : std::as_const(accepted)) {
+        const int root = sets.find(pair.first);
+        auto found = groupOfRoot.constFind(root);
+        if (found == groupOfRoot.cend()) {
+            found = groupOfRoot.insert(root, groups.size());
+            groups.append(Group());
+            groups.last().score = pair.score;
+        }
+        Group &group = groups[found.value()];
+        group.slotList << pair.first << pair.second;
+        group.score = qMin(group.score, pair.score);
+    }
+
+    for (Group &group : groups) {
+        std::sort(group.slotList.begin(), group.slotList.end());
+        group.slotList.erase(std::unique(group.slotList.begin(), group.slotList.end()), group.slotList.end());
+
+        // Оставляем самую старую запись из БД; ещё не сохранённые (без user_id) - только если других нет
+        auto keeper = std::min_element(group.slotList.begin(), group.slotList.end(), [this](int a, int b) {
+            const quint64 idA = quint64(contacts.id(a) - 1);
+            const quint64 idB = quint64(contacts.id(b) - 1);
+            return idA != idB ? idA < idB : a < b;
+        });
+        std::rotate(group.slotList.begin(), keeper, keeper + 1);
+        group.merged = mergeGroup(group.slotList);
+    }
+
+    std::sort(groups.begin(), groups.end(), [](const Group &a, const Group &b) {
+        if (a.score != b.score) return a.score > b.score;
+        return a.slotList.first() < b.slotList.first();
+    });
+    Trace::count("dedupe.groups", groups.size());
+    return groups;
+}
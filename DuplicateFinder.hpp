@@ -0,0 +1,94 @@
+#ifndef DUPLICATEFINDER_H
+#define DUPLICATEFINDER_H
+
+#include <QString>
+#include <QVector>
+#include <functional>
+
+#include "ContactStore.hpp"
+#include "Item.hpp"
+
+/*
+ * Поиск повторов в книге: один и тот же человек, записанный несколько раз, в том числе
+ * с разным написанием ФИО ("Фёдоров Пётр" и "Fedorov Petr", "Иванов" и "Ивонов").
+ *
+ * Все пары сравнивать нельзя, поэтому контакты раскладываются по блокам (blocking):
+ *  - по каждому номеру телефона (цифры, 8... как 7...);
+ *  - по e-mail без учёта регистра;
+ *  - по ФИО латиницей вместе с датой рождения.
+ * Сравниваются только контакты из одного блока; в очень большом блоке (общий рабочий телефон)
+ * каждый контакт сравнивается лишь с WindowSize соседями. Ключи блоков - 32-битные хеши,
+ * упакованные вместе со слотом в одно 64-битное число, так что раскладка - это одна сортировка.
+ * Ключи и сравнения считаются параллельно во всех ядрах (QtConcurrent).
+ *
+ * Пара считается повтором, если ФИО совпадают с точностью до опечаток, транслитерации и
+ * инициалов, есть общий телефон, e-mail или дата рождения и даты рождения не противоречат друг другу.
+ * Найденные пары склеиваются в группы, начиная с самых уверенных. Пара не склеивается, если в группе
+ * оказались бы две разные даты рождения или два разных e-mail: через запись без даты "1990" и "1985"
+ * в одну группу не попадут, и при слиянии ничего не теряется. Для каждой группы предлагается объединённый контакт.
+ */
+class DuplicateFinder {
+public:
+    // Со сколькими соседями сравнивается контакт в большом блоке
+    static constexpr int WindowSize = 50;
+
+    // Сколько контактов (при раскладке) или элементов блоков (при сравнении) в одной параллельной порции
+    static constexpr int ChunkSize = 16384;
+
+    struct Group {
+        // Первым идёт оставляемый контакт (с наименьшим user_id, то есть самый старый), за ним повторы
+        QVector<int> slotList;
+
+        // Предлагаемый результат слияния: оставляемый контакт, пустые поля заполнены из повторов, телефоны всех записей
+        Item merged;
+
+        // Уверенность 0..100 по самой слабой паре в группе
+        int score = 0;
+    };
+
+    explicit DuplicateFinder(const ContactStore &contacts);
+
+    // Группы повторов, самые уверенные первыми. Освобождённые (пустые) слоты не попадают ни в один блок.
+    // isCanceled проверяется перед каждой порцией; если поиск отменили, результат пустой.
+    QVector<Group> find(const std::function<bool()> &isCanceled = {}) const;
+
+private:
+    // ФИО без регистра и знаков (ё как е) и латиницей - по номеру строки пула
+    struct Names {
+        QVector<QString> folded;
+        QVector<QString> latin;
+    };
+
+    struct Pair {
+        int first;
+        int second;
+        int score;
+    };
+
+    enum class NameMatch { Different, Unknown, Similar, Exact };
+
+    Names prepareNames() const;
+
+    // Ключи блоков для контактов из слотов [begin, end)
+    QVector<quint64> blockKeys(int begin, int end, const Names &names) const;
+
+    // Пары-повторы внутри блоков, лежащих в keys[begin, end)
+    QVector<Pair> compareBlocks(const QVector<quint64> &keys, qsizetype begin, qsizetype end, const Names &names) const;
+
+    // Уверенность, что a и b - один человек (0 - не повтор)
+    int matchScore(int a, int b, const Names &names) const;
+
+    NameMatch compareNames(quint32 a, quint32 b, bool allowInitial, const Names &names) const;
+
+    // Номер телефона как число из цифр (8... как 7...), 0 - слишком короткий
+    qint64 phoneNumber(int slot, int index) const;
+
+    Item mergeGroup(const QVector<int> &slotList) const;
+
+    // Одинаковые ли e-mail у контактов (без учёта регистра и пробелов по краям)
+    bool sameEmail(int a, int b) const;
+
+    ContactStore contacts;
+};
+
+#endif // DUPLICATEFINDER_H
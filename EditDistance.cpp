@@ -0,0 +1,59 @@
+#include "EditDistance.hpp"
+#include <algorithm>
+
+EditDistance::EditDistance(QStringView pattern) : length(int(std::min<qsizetype>(pattern.size(), 64))) {
+    for (int i = 0; i < length; ++i) {
+        char16_t ch = pattern[i].unicode();
+        int entry = 0;
+        while (entry < entryCount && entries[entry].ch != ch) ++entry;
+        if (entry == entryCount) entries[entryCount++] = {ch, 0};
+        entries[entry].mask |= quint64(1) << i;
+    }
+}
+
+quint64 EditDistance::mask(char16_t ch) const {
+    // В слове обычно меньше десятка разных букв, линейный поиск быстрее хеша
+    for (int entry = 0; entry < entryCount; ++entry) {
+        if (entries[entry].ch == ch) return entries[entry].mask;
+    }
+    return 0;
+}
+
+void EditDistance::compute(QStringView text, int &prefix, int &whole) const {
+    if (length == 0) {
+        prefix = 0;
+        whole = int(text.size());
+        return;
+    }
+    const quint64 last = quint64(1) << (length - 1);
+    quint64 pv = ~quint64(0);
+    quint64 mv = 0;
+    int score = length;
+    int best = score;
+    for (QChar ch : text) {
+        const quint64 eq = mask(ch.unicode());
+        const quint64 xv = eq | mv;
+        const quint64 xh = (((eq & pv) + pv) ^ pv) | eq;
+        quint64 ph = mv | ~(xh | pv);
+        quint64 mh = pv & xh;
+        if (ph & last) {
+            ++score;
+        } else if (mh & last) {
+            --score;
+        }
+        // Единица снизу: в первой строке матрицы расстояние растёт на каждом символе текста
+        ph = (ph << 1) | 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+        best = std::min(best, score);
+    }
+    prefix = best;
+    whole = score;
+}
+
+int EditDistance::distance(QStringView text) const {
+    int prefix, whole;
+    compute(text, prefix, whole);
+    return whole;
+}
@@ -0,0 +1,37 @@
+#ifndef EDITDISTANCE_H
+#define EDITDISTANCE_H
+
+#include <QStringView>
+#include <array>
+
+/*
+ * Расстояние Левенштейна по Майерсу (в записи Хюрё): столбец матрицы динамики хранится
+ * как два 64-битных вектора приращений, и каждый символ текста обрабатывается за десяток
+ * битовых операций. Шаблон готовится один раз и сравнивается с любым числом строк.
+ * Шаблон длиннее 64 символов обрезается.
+ */
+class EditDistance {
+public:
+    explicit EditDistance(QStringView pattern);
+
+    // Правок до ближайшего начала text (prefix) и до всего text (whole)
+    void compute(QStringView text, int &prefix, int &whole) const;
+
+    // Правок до всего text
+    int distance(QStringView text) const;
+
+private:
+    quint64 mask(char16_t ch) const;
+
+    struct Entry {
+        char16_t ch;
+        quint64 mask;
+    };
+
+    // Разные символы шаблона и их позиции битами
+    std::array<Entry, 64> entries{};
+    int entryCount = 0;
+    int length;
+};
+
+#endif // EDITDISTANCE_H
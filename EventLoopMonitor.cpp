@@ -0,0 +1,19 @@
+#include "EventLoopMonitor.hpp"
+
+EventLoopMonitor::EventLoopMonitor(QObject *parent) : QObject(parent) {
+    timer.setTimerType(Qt::PreciseTimer);
+    timer.setInterval(IntervalMs);
+    connect(&timer, &QTimer::timeout, this, &EventLoopMonitor::tick);
+    elapsed.start();
+    timer.start();
+}
+
+const LatencyHistogram &EventLoopMonitor::histogram() const {
+    return lag;
+}
+
+void EventLoopMonitor::tick() {
+    qint64 micros = elapsed.nsecsElapsed() / 1000;
+    elapsed.restart();
+    lag.record(micros - IntervalMs * 1000);
+}
@@ -0,0 +1,34 @@
+#ifndef EVENTLOOPMONITOR_H
+#define EVENTLOOPMONITOR_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+
+#include "LatencyHistogram.hpp"
+
+/*
+ * Замер отзывчивости цикла событий GUI-потока.
+ * Таймер срабатывает каждые IntervalMs; насколько позже положенного он сработал -
+ * столько цикл событий был занят чем-то другим. Опоздания копятся в гистограмме.
+ */
+class EventLoopMonitor : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int IntervalMs = 10;
+
+    explicit EventLoopMonitor(QObject *parent = nullptr);
+
+    const LatencyHistogram &histogram() const;
+
+private slots:
+    void tick();
+
+private:
+    QTimer timer;
+    QElapsedTimer elapsed;
+    LatencyHistogram lag;
+};
+
+#endif // EVENTLOOPMONITOR_H
@@ -0,0 +1,247 @@
+#include "FuzzyIndex.hpp"
+#include "EditDistance.hpp"
+#include <algorithm>
+
+namespace {
+
+// Слова из букв в нижнем регистре; ё и е не различаем - их путают чаще всего
+void splitLetterWords(const QString &text, QStringList &words) {
+    QString word;
+    auto flush = [&words, &word]() {
+        if (word.isEmpty()) return;
+        word = word.toCaseFolded();
+        word.replace(QChar(0x0451), QChar(0x0435));
+        words.append(word);
+        word.clear();
+    };
+    for (QChar ch : text) {
+        if (ch.isLetter()) {
+            word.append(ch);
+        } else {
+            flush();
+        }
+    }
+    flush();
+}
+
+// Перед словом две метки начала: тогда у слова из n букв ровно n триграмм и первые буквы весят как остальные
+constexpr char16_t WordStart = 0x0002;
+
+quint64 trigramKey(char16_t a, char16_t b, char16_t c) {
+    return quint64(a) << 32 | quint64(b) << 16 | quint64(c);
+}
+
+QVector<quint64> wordTrigrams(const QString &word) {
+    QString padded;
+    padded.reserve(word.size() + 2);
+    padded.append(QChar(WordStart)).append(QChar(WordStart)).append(word);
+
+    QVector<quint64> keys;
+    keys.reserve(word.size());
+    for (int i = 0; i + 2 < padded.size(); ++i) {
+        keys.append(trigramKey(padded[i].unicode(), padded[i + 1].unicode(), padded[i + 2].unicode()));
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    return keys;
+}
+
+}
+
+QStringList FuzzyIndex::nameWords(const Item &item) {
+    QStringList words;
+    splitLetterWords(item.userLastName, words);
+    splitLetterWords(item.userFirstName, words);
+    splitLetterWords(item.userPatronymicName, words);
+    words.removeDuplicates();
+    return words;
+}
+
+QString FuzzyIndex::foldName(const QString &text) {
+    QStringList words;
+    splitLetterWords(text, words);
+    return words.join(' ');
+}
+
+QString FuzzyIndex::transliterate(QStringView folded) {
+    // Упрощённая запись как в загранпаспорте: й -> i, х -> kh, ц -> ts, знаки пропадают
+    static const char *const Latin[] = {
+        "a", "b", "v", "g", "d", "e", "zh", "z", "i", "i", "k", "l", "m", "n", "o", "p",
+        "r", "s", "t", "u", "f", "kh", "ts", "ch", "sh", "shch", "", "y", "", "e", "iu", "ia"
+    };
+
+    QString result;
+    result.reserve(folded.size() + 4);
+    for (QChar ch : folded) {
+        char16_t code = ch.unicode();
+        if (code >= 0x0430 && code <= 0x044f) {
+            result.append(QLatin1String(Latin[code - 0x0430]));
+        } else if (code == 0x0451) {
+            result.append(QLatin1Char('e'));
+        } else {
+            result.append(ch);
+        }
+    }
+    return result;
+}
+
+int FuzzyIndex::maxDistance(int length) {
+    // Порог по триграммам - length - 3 * distance - должен оставаться не меньше единицы
+    if (length <= 3) return 0;
+    if (length <= 6) return 1;
+    return 2;
+}
+
+int FuzzyIndex::termId(const QString &word) {
+    auto found = termIds.constFind(word);
+    if (found != termIds.cend()) return found.value();
+
+    const int id = terms.size();
+    const QString latin = transliterate(word);
+    terms.append(word);
+    latinTerms.append(latin);
+    termSlots.append(QVector<int>());
+    termIds.insert(word, id);
+
+    // Слово находится и по своей записи, и по латинской; номера слов растут, так что списки остаются упорядоченными
+    QVector<quint64> keys = wordTrigrams(word);
+    if (latin != word) keys += wordTrigrams(latin);
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    for (quint64 key : keys) trigrams[key].append(id);
+    return id;
+}
+
+void FuzzyIndex::addItem(int slot, const Item &item) {
+    for (const QString &word : nameWords(item)) {
+        QVector<int> &slotList = termSlots[termId(word)];
+        // Загрузка идёт по возрастанию слотов, так что обычно это просто добавление в конец
+        if (slotList.isEmpty() || slotList.constLast() < slot) {
+            slotList.append(slot);
+            continue;
+        }
+        auto pos = std::lower_bound(slotList.begin(), slotList.end(), slot);
+        if (*pos != slot) slotList.insert(pos, slot);
+    }
+}
+
+void FuzzyIndex::removeItem(int slot, const Item &item) {
+    // Слово остаётся в словаре и без контактов: при поиске оно просто ничего не добавит
+    for (const QString &word : nameWords(item)) {
+        int id = termIds.value(word, -1);
+        if (id < 0) continue;
+        QVector<int> &slotList = termSlots[id];
+        auto pos = std::lower_bound(slotList.begin(), slotList.end(), slot);
+        if (pos != slotList.end() && *pos == slot) slotList.erase(pos);
+    }
+}
+
+void FuzzyIndex::clear() {
+    terms.clear();
+    latinTerms.clear();
+    termIds.clear();
+    termSlots.clear();
+    trigrams.clear();
+}
+
+QVector<int> FuzzyIndex::candidates(const QString &form, int maxDistance) const {
+    const QVector<quint64> keys = wordTrigrams(form);
+    const int threshold = std::max(1, int(keys.size()) - 3 * maxDistance);
+
+    QHash<int, int> hits;
+    for (quint64 key : keys) {
+        auto found = trigrams.constFind(key);
+        if (found == trigrams.cend()) continue;
+        for (int id : found.value()) ++hits[id];
+    }
+
+    QVector<int> ids;
+    for (auto hit = hits.cbegin(); hit != hits.cend(); ++hit) {
+        if (hit.value() >= threshold) ids.append(hit.key());
+    }
+    return ids;
+}
+
+QVector<FuzzyIndex::WordMatch> FuzzyIndex::matchWord(const QString &word, bool transliterate) const {
+    const int allowed = maxDistance(int(word.size()));
+    const EditDistance pattern(word);
+
+    const QString latin = transliterate ? FuzzyIndex::transliterate(word) : QString();
+    const bool useLatin = transliterate && latin != word;
+    const EditDistance latinPattern(latin);
+
+    QVector<int> ids = candidates(word, allowed);
+    if (useLatin) {
+        ids += candidates(latin, allowed);
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    }
+
+    QVector<WordMatch> matches;
+    for (int id : ids) {
+        if (termSlots[id].isEmpty()) continue;
+
+        int prefix, whole;
+        pattern.compute(terms[id], prefix, whole);
+        if (useLatin) {
+            int latinPrefix, latinWhole;
+            latinPattern.compute(latinTerms[id], latinPrefix, latinWhole);
+            if (latinPrefix < prefix || (latinPrefix == prefix && latinWhole < whole)) {
+                prefix = latinPrefix;
+                whole = latinWhole;
+            }
+        }
+        if (prefix > allowed) continue;
+
+        for (int slot : termSlots[id]) matches.append({slot, prefix, whole});
+    }
+
+    // У контакта может подойти несколько слов ФИО: оставляем лучшее
+    std::sort(matches.begin(), matches.end(), [](const WordMatch &a, const WordMatch &b) {
+        if (a.slot != b.slot) return a.slot < b.slot;
+        if (a.distance != b.distance) return a.distance < b.distance;
+        return a.wholeDistance < b.wholeDistance;
+    });
+    matches.erase(std::unique(matches.begin(), matches.end(), [](const WordMatch &a, const WordMatch &b) { return a.slot == b.slot; }),
+                  matches.end());
+    return matches;
+}
+
+QVector<FuzzyIndex::Match> FuzzyIndex::search(const QString &query, bool transliterate) const {
+    QStringList words;
+    splitLetterWords(query, words);
+    if (words.isEmpty()) return {};
+
+    QVector<WordMatch> found = matchWord(words.first(), transliterate);
+    for (int i = 1; i < words.size() && !found.isEmpty(); ++i) {
+        const QVector<WordMatch> next = matchWord(words[i], transliterate);
+
+        // Оба списка упорядочены по слотам: пересекаем одним проходом и складываем расстояния
+        QVector<WordMatch> both;
+        auto a = found.cbegin();
+        auto b = next.cbegin();
+        while (a != found.cend() && b != next.cend()) {
+            if (a->slot < b->slot) {
+                ++a;
+            } else if (b->slot < a->slot) {
+                ++b;
+            } else {
+                both.append({a->slot, a->distance + b->distance, a->wholeDistance + b->wholeDistance});
+                ++a;
+                ++b;
+            }
+        }
+        found = std::move(both);
+    }
+
+    std::sort(found.begin(), found.end(), [](const WordMatch &a, const WordMatch &b) {
+        if (a.distance != b.distance) return a.distance < b.distance;
+        if (a.wholeDistance != b.wholeDistance) return a.wholeDistance < b.wholeDistance;
+        return a.slot < b.slot;
+    });
+
+    QVector<Match> matches;
+    matches.reserve(found.size());
+    for (const WordMatch &match : found) matches.append({match.slot, match.distance});
+    return matches;
+}
@@ -0,0 +1,81 @@
+#ifndef FUZZYINDEX_H
+#define FUZZYINDEX_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "Item.hpp"
+
+/*
+ * Нечёткий поиск по ФИО: находит контакт, даже если в запросе опечатки или имя набрано
+ * латиницей ("ivanov" -> "Иванов").
+ *
+ * Индекс хранит каждое слово ФИО один раз (у "Иванов" на всю книгу один элемент) вместе
+ * со слотами контактов и триграммами слова. Поиск идёт в два шага:
+ *  - кандидаты: слова, у которых достаточно общих триграмм со словом запроса
+ *    (каждая правка портит не больше трёх триграмм, так что порог отсекает только заведомо далёкие);
+ *  - проверка: расстояние Левенштейна от слова запроса до начала слова-кандидата,
+ *    битово-параллельный алгоритм Майерса (одно слово запроса - одно 64-битное слово).
+ * Полного просмотра ни слов, ни контактов нет: допустимое число опечаток ограничено длиной
+ * слова так, чтобы порог по триграммам всегда был не меньше единицы.
+ *
+ * Слова запроса объединяются по И, как в SearchIndex. Результат упорядочен: сначала
+ * контакты с меньшим числом опечаток, затем с более полным совпадением слов.
+ */
+class FuzzyIndex {
+public:
+    struct Match {
+        int slot = -1;
+        int distance = 0;   // сумма опечаток по словам запроса
+    };
+
+    void addItem(int slot, const Item &item);
+    void removeItem(int slot, const Item &item);
+    void clear();
+
+    // transliterate - сравнивать ещё и в латинской записи (кириллица переводится в латиницу)
+    QVector<Match> search(const QString &query, bool transliterate = true) const;
+
+    // Сколько опечаток допускается в слове запроса такой длины
+    static int maxDistance(int length);
+
+    // Кириллица латиницей (иванов -> ivanov, щукин -> shchukin); остальные символы не меняются
+    static QString transliterate(QStringView folded);
+
+    // Только слова из букв, в нижнем регистре, ё как е, через один пробел ("Пётр-Иван " -> "петр иван")
+    static QString foldName(const QString &text);
+
+    // Слова ФИО контакта в нижнем регистре, ё как е
+    static QStringList nameWords(const Item &item);
+
+private:
+    struct WordMatch {
+        int slot;
+        int distance;
+        int wholeDistance;  // правок до всего слова контакта, а не только до его начала
+    };
+
+    // Номер слова в словаре (новое слово добавляется вместе с триграммами)
+    int termId(const QString &word);
+
+    // Слова словаря, которые могут начинаться с form не дальше maxDistance правок
+    QVector<int> candidates(const QString &form, int maxDistance) const;
+
+    // Контакты, в которых есть слово, подходящее под слово запроса, с лучшим расстоянием для каждого (по слотам)
+    QVector<WordMatch> matchWord(const QString &word, bool transliterate) const;
+
+    // Слова словаря и их латинская запись
+    QVector<QString> terms;
+    QVector<QString> latinTerms;
+    QHash<QString, int> termIds;
+
+    // Слово -> отсортированные слоты контактов, у которых оно есть в ФИО
+    QVector<QVector<int>> termSlots;
+
+    // Триграмма (три символа по 16 бит) -> номера слов по возрастанию
+    QHash<quint64, QVector<int>> trigrams;
+};
+
+#endif // FUZZYINDEX_H
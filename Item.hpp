@@ -0,0 +1,31 @@
+#ifndef ITEM_H
+#define ITEM_H
+
+#include <QString>
+#include <QVector>
+
+// Состояние записи относительно того, что лежит в БД
+enum class ItemState {
+    Clean,      // совпадает с БД
+    Added,      // новой записи ещё нет в БД (и у неё ещё нет userId)
+    Modified    // запись есть в БД, но изменена в памяти
+};
+
+// Один контакт адресной книги
+struct Item {
+    QString userId;
+    QString userLastName;
+    QString userFirstName;
+    QString userPatronymicName;
+    QString userEmail;
+    QString userBirthday;
+    QVector<QString> userPhonesList;
+
+    // Версия записи в БД: растёт при каждом UPDATE. По ней видно, что запись успели изменить в другом окне.
+    quint32 version = 0;
+
+    // Что нужно сделать с записью при следующем сохранении
+    ItemState state = ItemState::Clean;
+};
+
+#endif // ITEM_H
@@ -0,0 +1,193 @@
+#include "ItemValidator.hpp"
+#include <QStringList>
+
+namespace {
+
+inline bool isLatinUpper(QChar ch) {
+    return ch >= QLatin1Char('A') && ch <= QLatin1Char('Z');
+}
+
+inline bool isLatinLetter(QChar ch) {
+    return isLatinUpper(ch) || (ch >= QLatin1Char('a') && ch <= QLatin1Char('z'));
+}
+
+inline bool isAsciiDigit(QChar ch) {
+    return ch >= QLatin1Char('0') && ch <= QLatin1Char('9');
+}
+
+inline bool isLatinLetterOrDigit(QChar ch) {
+    return isLatinLetter(ch) || isAsciiDigit(ch);
+}
+
+// Ровно count цифр начиная с pos
+inline bool scanDigits(QStringView text, qsizetype &pos, int count) {
+    if (pos + count > text.size()) return false;
+    for (int i = 0; i < count; ++i) {
+        if (!isAsciiDigit(text[pos + i])) return false;
+    }
+    pos += count;
+    return true;
+}
+
+// Необязательный символ ch в позиции pos
+inline void skipOptional(QStringView text, qsizetype &pos, QChar ch) {
+    if (pos < text.size() && text[pos] == ch) ++pos;
+}
+
+inline void skipSeparator(QStringView text, qsizetype &pos) {
+    if (pos < text.size() && (text[pos] == QLatin1Char(' ') || text[pos] == QLatin1Char('-'))) ++pos;
+}
+
+inline int digitValue(QChar ch) {
+    return ch.unicode() - '0';
+}
+
+}
+
+bool ItemValidator::isValidName(QStringView name) {
+    if (name.isEmpty() || !isLatinUpper(name[0])) return false;
+
+    // Разделитель (пробел или дефис) может стоять только между буквами или цифрами
+    bool afterSeparator = false;
+    for (qsizetype i = 1; i < name.size(); ++i) {
+        QChar ch = name[i];
+        if (ch == QLatin1Char(' ') || ch == QLatin1Char('-')) {
+            if (afterSeparator) return false;
+            afterSeparator = true;
+        } else if (isLatinLetterOrDigit(ch)) {
+            afterSeparator = false;
+        } else {
+            return false;
+        }
+    }
+    return !afterSeparator;
+}
+
+bool ItemValidator::isValidPhone(QStringView phone) {
+    qsizetype pos = 0;
+    if (phone.startsWith(QLatin1String("+7"))) {
+        pos = 2;
+    } else if (phone.startsWith(QLatin1Char('8'))) {
+        pos = 1;
+    } else {
+        return false;
+    }
+
+    skipOptional(phone, pos, QLatin1Char('('));
+    if (!scanDigits(phone, pos, 3)) return false;
+    skipOptional(phone, pos, QLatin1Char(')'));
+    skipSeparator(phone, pos);
+    if (!scanDigits(phone, pos, 3)) return false;
+    skipSeparator(phone, pos);
+    if (!scanDigits(phone, pos, 2)) return false;
+    skipSeparator(phone, pos);
+    if (!scanDigits(phone, pos, 2)) return false;
+    return pos == phone.size();
+}
+
+bool ItemValidator::isValidEmail(QStringView email) {
+    // Домен - всё после последней @: в домене @ быть не может
+    qsizetype at = email.lastIndexOf(QLatin1Char('@'));
+    if (at <= 0) return false;
+
+    // Перед @ хотя бы один допустимый символ
+    QChar beforeAt = email[at - 1];
+    if (!isLatinLetterOrDigit(beforeAt) && QStringView(u"._%+-").indexOf(beforeAt) < 0) return false;
+
+    // Зона - буквы после последней точки, не меньше двух
+    qsizetype dot = email.lastIndexOf(QLatin1Char('.'));
+    if (dot <= at + 1 || email.size() - dot - 1 < 2) return false;
+    for (qsizetype i = dot + 1; i < email.size(); ++i) {
+        if (!isLatinLetter(email[i])) return false;
+    }
+
+    // Имя домена до зоны: буквы, цифры, точки и дефисы
+    for (qsizetype i = at + 1; i < dot; ++i) {
+        QChar ch = email[i];
+        if (!isLatinLetterOrDigit(ch) && ch != QLatin1Char('.') && ch != QLatin1Char('-')) return false;
+    }
+    return true;
+}
+
+bool ItemValidator::isValidBirthday(QStringView birthday, const QDate &today) {
+    // dd-MM-yyyy: ровно 10 символов, дефисы на своих местах
+    if (birthday.size() != 10 || birthday[2] != QLatin1Char('-') || birthday[5] != QLatin1Char('-')) return false;
+
+    qsizetype pos = 0;
+    if (!scanDigits(birthday, pos, 2)) return false;
+    pos = 3;
+    if (!scanDigits(birthday, pos, 2)) return false;
+    pos = 6;
+    if (!scanDigits(birthday, pos, 4)) return false;
+
+    int day = digitValue(birthday[0]) * 10 + digitValue(birthday[1]);
+    int month = digitValue(birthday[3]) * 10 + digitValue(birthday[4]);
+    int year = digitValue(birthday[6]) * 1000 + digitValue(birthday[7]) * 100 + digitValue(birthday[8]) * 10 + digitValue(birthday[9]);
+
+    if (!QDate::isValid(year, month, day)) return false;
+    return QDate(year, month, day) < today;
+}
+
+ItemValidator::Result ItemValidator::check(const Item &item, const QDate &today) {
+    Result result;
+    if (!isValidName(QStringView(item.userLastName).trimmed())) result.invalidFields |= LastName;
+    if (!isValidName(QStringView(item.userFirstName).trimmed())) result.invalidFields |= FirstName;
+    if (!isValidName(QStringView(item.userPatronymicName).trimmed())) result.invalidFields |= Patronymic;
+
+    if (item.userPhonesList.isEmpty()) {
+        result.invalidFields |= Phones;
+    }
+    for (int i = 0; i < item.userPhonesList.size(); ++i) {
+        if (!isValidPhone(QStringView(item.userPhonesList[i]).trimmed())) {
+            result.invalidFields |= Phones;
+            result.invalidPhone = i;
+            break;
+        }
+    }
+
+    if (!isValidEmail(QStringView(item.userEmail).trimmed())) result.invalidFields |= Email;
+    if (!isValidBirthday(QStringView(item.userBirthday).trimmed(), today)) result.invalidFields |= Birthday;
+    return result;
+}
+
+void ItemValidator::validateBatch(const Item *items, int count, Result *results, const QDate &today) {
+    for (int i = 0; i < count; ++i) {
+        results[i] = check(items[i], today);
+    }
+}
+
+QVector<ItemValidator::Result> ItemValidator::validateBatch(const QVector<Item> &items) {
+    QVector<Result> results(items.size());
+    validateBatch(items.constData(), items.size(), results.data());
+    return results;
+}
+
+QString ItemValidator::message(Field field) {
+    switch (field) {
+    case LastName:
+    case FirstName:
+    case Patronymic:
+        return "Фамилия, имя и отчество должны начинаться с буквы, "
+               "могут содержать дефис, пробел и цифры, но не могут заканчиваться или начинаться на дефис.";
+    case Phones:   return "Телефон должен быть в формате +7(8)XXXXXXXXXX, где X — цифры.";
+    case Email:    return "E-mail должен быть в формате example@domain.com.";
+    case Birthday: return "Дата рождения должна быть корректной и меньше текущей даты.";
+    }
+    return QString();
+}
+
+QString ItemValidator::errorText(const Result &result) {
+    if (result.isValid()) return QString();
+
+    // У фамилии, имени и отчества общее правило, его достаточно назвать один раз
+    QStringList messages;
+    if (result.invalidFields & (LastName | FirstName | Patronymic)) messages.append(message(LastName));
+    if (result.has(Phones)) messages.append(message(Phones));
+    if (result.has(Email)) messages.append(message(Email));
+    if (result.has(Birthday)) messages.append(message(Birthday));
+    return messages.join(' ');
+}
+
+QString ItemValidator::validate(const Item &item) {
+    return errorText(check(item));
+}
@@ -0,0 +1,70 @@
+#ifndef ITEMVALIDATOR_H
+#define ITEMVALIDATOR_H
+
+#include <QDate>
+#include <QString>
+#include <QStringView>
+#include <QVector>
+
+#include "Item.hpp"
+
+/*
+ * Единая проверка контакта: её используют диалоги добавления и редактирования,
+ * добавление номера и массовый импорт.
+ *
+ * Правила те же, что были в регулярных выражениях диалога добавления, но каждое поле
+ * проверяется своим сканером за один проход по строке, без регулярных выражений и без
+ * выделения памяти. Поэтому проверка пачки записей упирается только в скорость чтения памяти.
+ */
+class ItemValidator {
+public:
+    // Поля контакта, битовая маска для результата проверки
+    enum Field : unsigned {
+        LastName   = 1u << 0,
+        FirstName  = 1u << 1,
+        Patronymic = 1u << 2,
+        Phones     = 1u << 3,
+        Email      = 1u << 4,
+        Birthday   = 1u << 5
+    };
+
+    // Результат проверки одного контакта: какие поля неверны
+    struct Result {
+        unsigned invalidFields = 0;
+        int invalidPhone = -1;      // номер первого неверного телефона в списке (-1, если список пуст или все верны)
+
+        bool isValid() const { return invalidFields == 0; }
+        bool has(Field field) const { return invalidFields & field; }
+    };
+
+    // Фамилия, имя или отчество: латинская заглавная буква в начале, дальше буквы и цифры,
+    // одиночные пробелы и дефисы внутри (как "^[A-Z]+([ -]?[A-Za-z0-9]+)*$")
+    static bool isValidName(QStringView name);
+
+    // +7 или 8, затем 10 цифр; код можно взять в скобки, группы разделить пробелом или дефисом
+    static bool isValidPhone(QStringView phone);
+
+    // Что-то@домен.зона, зона - не меньше двух латинских букв
+    static bool isValidEmail(QStringView email);
+
+    // Дата в формате dd-MM-yyyy, существующая и раньше today
+    static bool isValidBirthday(QStringView birthday, const QDate &today);
+
+    // Проверить все поля контакта. Пробелы по краям полей не учитываются.
+    static Result check(const Item &item, const QDate &today = QDate::currentDate());
+
+    // Проверить count контактов подряд, results должен вмещать count результатов
+    static void validateBatch(const Item *items, int count, Result *results, const QDate &today = QDate::currentDate());
+    static QVector<Result> validateBatch(const QVector<Item> &items);
+
+    // Текст ошибки для поля
+    static QString message(Field field);
+
+    // Ошибки всех неверных полей одной строкой (пусто, если контакт корректен)
+    static QString errorText(const Result &result);
+
+    // То же, что errorText(check(item))
+    static QString validate(const Item &item);
+};
+
+#endif // ITEMVALIDATOR_H
@@ -0,0 +1,65 @@
+#include "LatencyHistogram.hpp"
+#include <QMutexLocker>
+#include <QStringList>
+
+int LatencyHistogram::bucketOf(qint64 micros) {
+    int bucket = 0;
+    while (micros > 0 && bucket < BucketCount - 1) {
+        micros >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+void LatencyHistogram::record(qint64 micros) {
+    if (micros < 0) micros = 0;
+    QMutexLocker locker(&mutex);
+    ++buckets[bucketOf(micros)];
+    ++total;
+    if (micros > maxMicros) maxMicros = micros;
+}
+
+void LatencyHistogram::clear() {
+    QMutexLocker locker(&mutex);
+    buckets.fill(0);
+    total = 0;
+    maxMicros = 0;
+}
+
+qint64 LatencyHistogram::count() const {
+    QMutexLocker locker(&mutex);
+    return total;
+}
+
+qint64 LatencyHistogram::max() const {
+    QMutexLocker locker(&mutex);
+    return maxMicros;
+}
+
+qint64 LatencyHistogram::percentile(double percent) const {
+    QMutexLocker locker(&mutex);
+    if (total == 0) return 0;
+
+    qint64 threshold = qint64(total * percent / 100.0);
+    qint64 seen = 0;
+    for (int bucket = 0; bucket < BucketCount; ++bucket) {
+        seen += buckets[bucket];
+        // Корзина bucket - это задержки меньше 2^bucket мкс
+        if (seen > threshold) return qMin(qint64(1) << bucket, maxMicros);
+    }
+    return maxMicros;
+}
+
+QString LatencyHistogram::summary() const {
+    QString line = QString("n=%1 p50<=%2us p90<=%3us p99<=%4us max=%5us")
+                       .arg(count()).arg(percentile(50)).arg(percentile(90)).arg(percentile(99)).arg(max());
+
+    QMutexLocker locker(&mutex);
+    QStringList parts;
+    for (int bucket = 0; bucket < BucketCount; ++bucket) {
+        if (buckets[bucket] == 0) continue;
+        parts.append(QString("<%1us:%2").arg(qint64(1) << bucket).arg(buckets[bucket]));
+    }
+    if (!parts.isEmpty()) line += " [" + parts.join(' ') + "]";
+    return line;
+}
@@ -0,0 +1,39 @@
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <QMutex>
+#include <QString>
+#include <array>
+
+/*
+ * Гистограмма задержек с корзинами по степеням двойки (в микросекундах):
+ * [0, 1), [1, 2), [2, 4) ... и последняя - всё, что дольше ~1 минуты.
+ * Писать можно из любого потока.
+ */
+class LatencyHistogram {
+public:
+    static constexpr int BucketCount = 28;
+
+    void record(qint64 micros);
+    void clear();
+
+    qint64 count() const;
+
+    // Задержка, меньше которой percent процентов замеров (верхняя граница корзины), мкс
+    qint64 percentile(double percent) const;
+
+    qint64 max() const;
+
+    // Одна строка: число замеров, p50/p90/p99/max и непустые корзины
+    QString summary() const;
+
+private:
+    static int bucketOf(qint64 micros);
+
+    mutable QMutex mutex;
+    std::array<qint64, BucketCount> buckets{};
+    qint64 total = 0;
+    qint64 maxMicros = 0;
+};
+
+#endif // LATENCYHISTOGRAM_H
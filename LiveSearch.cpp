@@ -0,0 +1,153 @@
+#include "LiveSearch.hpp"
+#include "ContactScanner.hpp"
+#include "ContactsModel.hpp"
+#include "SearchIndex.hpp"
+#include "Trace.hpp"
+#include <QPromise>
+#include <QtConcurrent/QtConcurrentRun>
+
+LiveSearch::LiveSearch(ContactsModel *model, QObject *parent) : QObject(parent), model(model) {
+    debounce.setSingleShot(true);
+    debounce.setInterval(DebounceMs);
+    connect(&debounce, &QTimer::timeout, this, &LiveSearch::start);
+
+    // Одного потока достаточно: новый поиск всё равно отменяет предыдущий
+    pool.setMaxThreadCount(1);
+}
+
+void LiveSearch::setStorage(AsyncStorage *storage, int limit) {
+    this->storage = storage;
+    storageLimit = limit;
+}
+
+bool LiveSearch::isFuzzy() const {
+    return fuzzy;
+}
+
+void LiveSearch::setFuzzy(bool fuzzy) {
+    if (this->fuzzy == fuzzy) return;
+    this->fuzzy = fuzzy;
+    lastQuery.clear();
+    lastMatches.clear();
+    start();
+}
+
+void LiveSearch::setQuery(const QString &query) {
+    pendingQuery = query.trimmed();
+    debounce.start();
+}
+
+void LiveSearch::start() {
+    ++requestNumber;
+    modelSearch.cancel();
+    storageSearch.cancel();
+
+    const QString query = pendingQuery;
+    if (query.isEmpty()) {
+        lastQuery.clear();
+        lastMatches.clear();
+        emit cleared();
+        return;
+    }
+
+    emit searchStarted(query);
+    if (storage) {
+        searchStorage(query);
+    } else {
+        searchModel(query);
+    }
+}
+
+void LiveSearch::searchModel(const QString &query) {
+    if (fuzzy) {
+        searchFuzzy(query);
+        return;
+    }
+
+    const int number = requestNumber;
+    const ContactsModel::SearchSnapshot snapshot = model->searchSnapshot();
+
+    // Уточнять можно, только если с прошлого поиска контакты не менялись
+    const bool narrowing = !lastQuery.isEmpty() && lastRevision == snapshot.contentRevision
+                           && lastMatches.size() <= NarrowingLimit && SearchIndex::narrows(lastQuery, query);
+    const QVector<int> base = narrowing ? lastMatches : QVector<int>();
+
+    modelSearch = QtConcurrent::run(&pool, [snapshot, query, base, narrowing](QPromise<ModelResult> &promise) {
+        TraceScope trace(narrowing ? "search.narrow" : "search.live");
+        if (promise.isCanceled()) return;
+
+        ModelResult result;
+        if (narrowing) {
+            result.matches.reserve(base.size());
+            for (int i = 0; i < base.size(); ++i) {
+                // Отмену проверяем не на каждом контакте, чтобы не тратить на неё время
+                if ((i & 1023) == 0 && promise.isCanceled()) return;
+                if (SearchIndex::matches(snapshot.contacts.item(base[i]), query)) result.matches.append(base[i]);
+            }
+        } else {
+            result.matches = snapshot.index.search(query);
+        }
+
+        // Индекс ищет только начала слов; кусок e-mail или цифры из середины номера найдёт просмотр
+        if (result.matches.isEmpty()) {
+            TraceScope scanTrace("search.scan");
+            result.matches = ContactScanner(snapshot.contacts).scan(query, [&promise]() { return promise.isCanceled(); });
+            result.scanned = true;
+            if (promise.isCanceled()) return;
+        }
+        promise.addResult(result);
+    });
+
+    applyWhenReady(number, query, snapshot.contentRevision, snapshot.layoutRevision);
+}
+
+void LiveSearch::searchFuzzy(const QString &query) {
+    const int number = requestNumber;
+    const ContactsModel::SearchSnapshot snapshot = model->searchSnapshot();
+
+    modelSearch = QtConcurrent::run(&pool, [snapshot, query](QPromise<ModelResult> &promise) {
+        TraceScope trace("search.fuzzy");
+        if (promise.isCanceled()) return;
+
+        ModelResult result;
+        const QVector<FuzzyIndex::Match> matches = snapshot.fuzzy.search(query);
+        result.matches.reserve(matches.size());
+        for (const FuzzyIndex::Match &match : matches) result.matches.append(match.slot);
+        result.scanned = true;
+        promise.addResult(result);
+    });
+
+    applyWhenReady(number, query, snapshot.contentRevision, snapshot.layoutRevision);
+}
+
+void LiveSearch::applyWhenReady(int number, const QString &query, quint64 contentRevision, quint64 layoutRevision) {
+    modelSearch.then(this, [this, number, query, contentRevision, layoutRevision](const ModelResult &result) {
+        if (number != requestNumber) return;
+
+        // Пока искали, контакты удалили или книгу заменили: слоты из снимка могли уже достаться другим
+        if (model->layoutRevision() != layoutRevision) {
+            start();
+            return;
+        }
+
+        lastQuery = result.scanned ? QString() : query;
+        lastMatches = result.scanned ? QVector<int>() : result.matches;
+        lastRevision = contentRevision;
+        emit matchesFound(query, result.matches);
+    });
+}
+
+void LiveSearch::searchStorage(const QString &query) {
+    const int number = requestNumber;
+
+    // Запрос встаёт в очередь потока БД; если его ещё не начали, отмена следующим поиском его снимет
+    storageSearch = storage->searchFullText(query, storageLimit);
+    storageSearch.then(this, [this, number, query](const StorageReply &reply) {
+        if (number != requestNumber) return;
+        if (!reply.ok) {
+            emit failed(reply.errorText);
+            return;
+        }
+        emit itemsFound(query, reply.items);
+    });
+}
@@ -0,0 +1,108 @@
+#ifndef LIVESEARCH_H
+#define LIVESEARCH_H
+
+#include <QFuture>
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVector>
+
+#include "Item.hpp"
+#include "AsyncStorage.hpp"
+
+class ContactsModel;
+
+/*
+ * Поиск по мере ввода.
+ * Запрос запускается, когда пользователь перестал печатать на DebounceMs. Предыдущий поиск
+ * при этом отменяется, а его ответ, если всё же придёт, отбрасывается.
+ *
+ * Поиск по книге в памяти идёт в отдельном потоке по снимку модели (ContactsModel::searchSnapshot).
+ * Если новый запрос только уточняет предыдущий ("ива" -> "иван"), подходящие контакты ищутся
+ * среди уже найденных, а не по всему индексу. Если индекс ничего не нашёл, запрос ищется
+ * как подстрока во всех полях параллельным просмотром (ContactScanner).
+ *
+ * В нечётком режиме (setFuzzy) запрос ищется по ФИО с опечатками и транслитерацией (FuzzyIndex),
+ * найденное упорядочено по числу опечаток, и просмотра всех контактов не бывает.
+ * Нечёткий режим работает только по книге в памяти.
+ *
+ * В режиме экономии памяти (setStorage) запрос уходит в FTS5 через AsyncStorage.
+ */
+class LiveSearch : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int DebounceMs = 150;
+
+    // Уточнять по найденному, только если его не больше этого: дальше индекс быстрее, чем проверка каждого контакта
+    static constexpr int NarrowingLimit = 20000;
+
+    explicit LiveSearch(ContactsModel *model, QObject *parent = nullptr);
+
+    // Искать в БД (не больше limit контактов) вместо модели
+    void setStorage(AsyncStorage *storage, int limit);
+
+    // Нечёткий поиск по ФИО. Найденное (matchesFound) тогда идёт по убыванию совпадения.
+    bool isFuzzy() const;
+
+public slots:
+    void setQuery(const QString &query);
+
+    // Переключить режим; текущий запрос сразу ищется заново
+    void setFuzzy(bool fuzzy);
+
+signals:
+    // Запрос уходит на выполнение (в БД-режиме - сразу после этого сигнала)
+    void searchStarted(const QString &query);
+
+    // Поиск в модели: слоты найденных контактов
+    void matchesFound(const QString &query, const QVector<int> &slotList);
+
+    // Поиск в БД: найденные контакты
+    void itemsFound(const QString &query, const QVector<Item> &items);
+
+    // Строка поиска очищена
+    void cleared();
+
+    void failed(const QString &errText);
+
+private slots:
+    void start();
+
+private:
+    // Результат поиска в модели; scanned - найдено не по индексу слов (просмотром или нечётко), уточнять по нему нельзя
+    struct ModelResult {
+        QVector<int> matches;
+        bool scanned = false;
+    };
+
+    void searchModel(const QString &query);
+    void searchFuzzy(const QString &query);
+
+    // Применить ответ поиска в модели, если он ещё актуален (снимок с такими счётчиками изменений)
+    void applyWhenReady(int number, const QString &query, quint64 contentRevision, quint64 layoutRevision);
+    void searchStorage(const QString &query);
+
+    ContactsModel *model;
+    AsyncStorage *storage = nullptr;
+    int storageLimit = 0;
+    bool fuzzy = false;
+
+    QTimer debounce;
+    QString pendingQuery;
+
+    // Номер последнего запущенного поиска: ответы на более ранние отбрасываются
+    int requestNumber = 0;
+
+    QFuture<ModelResult> modelSearch;
+    QFuture<StorageReply> storageSearch;
+    QThreadPool pool;
+
+    // Последний применённый результат - основа для уточнения (найденное просмотром или нечётко не уточняем)
+    QString lastQuery;
+    QVector<int> lastMatches;
+    quint64 lastRevision = 0;
+};
+
+#endif // LIVESEARCH_H
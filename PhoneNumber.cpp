@@ -0,0 +1,27 @@
+#include "PhoneNumber.hpp"
+
+qint64 PhoneNumber::toE164(const QString &phone) {
+    QString digits;
+    digits.reserve(phone.size());
+    for (QChar ch : phone) {
+        if (ch.isDigit()) digits.append(ch);
+    }
+
+    // Российские номера без кода страны (10 цифр) и с "8" вместо "+7"
+    if (!phone.trimmed().startsWith('+')) {
+        if (digits.size() == 10) {
+            digits.prepend('7');
+        } else if (digits.size() == 11 && digits.startsWith('8')) {
+            digits[0] = '7';
+        }
+    }
+
+    // В E.164 не больше 15 цифр, а короче 8 цифр номеров с кодом страны не бывает
+    if (digits.size() < 8 || digits.size() > 15) return 0;
+    return digits.toLongLong();
+}
+
+QString PhoneNumber::fromE164(qint64 number) {
+    if (number <= 0) return QString();
+    return "+" + QString::number(number);
+}
@@ -0,0 +1,21 @@
+#ifndef PHONENUMBER_H
+#define PHONENUMBER_H
+
+#include <QString>
+#include <QtGlobal>
+
+/*
+ * Приведение телефонных номеров к E.164.
+ * Номер хранится как целое число без "+": +7(921)999-19-99 и 8 921 999 19 99 -> 79219991999.
+ * Так номер занимает 8 байт, сравнивается одной инструкцией и индексируется в БД как INTEGER.
+ */
+class PhoneNumber {
+public:
+    // Номер в E.164 или 0, если строка на номер не похожа
+    static qint64 toE164(const QString &phone);
+
+    // Обратно в строку вида +79219991999
+    static QString fromE164(qint64 number);
+};
+
+#endif // PHONENUMBER_H
@@ -0,0 +1,202 @@
+#include "SearchIndex.hpp"
+#include <QRegularExpression>
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+// Разбить текст на слова из букв и цифр, без учёта регистра
+void splitWords(const QString &text, QStringList &words) {
+    QString word;
+    for (QChar ch : text) {
+        if (ch.isLetterOrNumber()) {
+            word.append(ch);
+        } else if (!word.isEmpty()) {
+            words.append(word.toCaseFolded());
+            word.clear();
+        }
+    }
+    if (!word.isEmpty()) words.append(word.toCaseFolded());
+}
+
+// Номер телефона как одна строка цифр. Российские 8XXXXXXXXXX приводим к 7XXXXXXXXXX.
+QString phoneDigits(const QString &phone) {
+    QString digits;
+    digits.reserve(phone.size());
+    for (QChar ch : phone) {
+        if (ch.isDigit()) digits.append(ch);
+    }
+    if (digits.size() == 11 && digits.startsWith('8')) digits[0] = '7';
+    return digits;
+}
+
+// Слить два отсортированных списка слотов
+QVector<int> unite(const QVector<int> &a, const QVector<int> &b) {
+    QVector<int> result;
+    result.reserve(a.size() + b.size());
+    std::set_union(a.cbegin(), a.cend(), b.cbegin(), b.cend(), std::back_inserter(result));
+    return result;
+}
+
+QVector<int> intersect(const QVector<int> &a, const QVector<int> &b) {
+    QVector<int> result;
+    result.reserve(qMin(a.size(), b.size()));
+    std::set_intersection(a.cbegin(), a.cend(), b.cbegin(), b.cend(), std::back_inserter(result));
+    return result;
+}
+
+}
+
+QStringList SearchIndex::itemTokens(const Item &item) {
+    QStringList tokens;
+    splitWords(item.userLastName, tokens);
+    splitWords(item.userFirstName, tokens);
+    splitWords(item.userPatronymicName, tokens);
+    splitWords(item.userEmail, tokens);
+    splitWords(item.userBirthday, tokens);
+    tokens += phoneTokens(item.userPhonesList);
+
+    tokens.removeDuplicates();
+    return tokens;
+}
+
+QStringList SearchIndex::phoneTokens(const QVector<QString> &phones) {
+    QStringList tokens;
+    for (const QString &phone : phones) {
+        QString digits = phoneDigits(phone);
+        if (digits.isEmpty()) continue;
+        tokens.append(digits);
+        // Номер без кода страны, чтобы находился и по "921..."
+        if (digits.size() == 11) tokens.append(digits.mid(1));
+    }
+    return tokens;
+}
+
+QStringList SearchIndex::queryTokens(const QString &term) {
+    // Дата (13-07-2003, 13-07) ищется по частям, как и хранится
+    static const QRegularExpression dateRegex("^\\d{1,2}[-.]\\d{1,2}([-.]\\d{0,4})?$");
+    // Всё остальное из цифр, скобок, плюсов, дефисов и пробелов - это телефон
+    static const QRegularExpression phoneRegex("^[+0-9()\\- ]*\\d[+0-9()\\- ]*$");
+
+    QString trimmed = term.trimmed();
+    QStringList tokens;
+    if (!dateRegex.match(trimmed).hasMatch() && phoneRegex.match(trimmed).hasMatch()) {
+        QString digits = phoneDigits(trimmed);
+        // Номер набирают с 8, а в индексе он с 7: меняем сразу, иначе до пятой цифры ничего не найдётся.
+        // Дни и годы с 8 не начинаются (день хранится как "08"), так что словам из цифр это не мешает.
+        if (digits.startsWith('8')) digits[0] = '7';
+        tokens.append(digits);
+        return tokens;
+    }
+
+    splitWords(trimmed, tokens);
+    tokens.removeDuplicates();
+    return tokens;
+}
+
+bool SearchIndex::matches(const Item &item, const QString &query) {
+    const QStringList words = itemTokens(item);
+    auto hasPrefix = [&words](const QString &prefix) {
+        return std::any_of(words.cbegin(), words.cend(), [&prefix](const QString &word) { return word.startsWith(prefix); });
+    };
+
+    const QStringList terms = query.split(",", Qt::SkipEmptyParts);
+    for (const QString &term : terms) {
+        const QStringList tokens = queryTokens(term);
+        if (!tokens.isEmpty() && std::all_of(tokens.cbegin(), tokens.cend(), hasPrefix)) return true;
+    }
+    return false;
+}
+
+bool SearchIndex::narrows(const QString &query, const QString &refined) {
+    const QStringList terms = query.split(",", Qt::SkipEmptyParts);
+    const QStringList refinedTerms = refined.split(",", Qt::SkipEmptyParts);
+    if (terms.isEmpty() || terms.size() != refinedTerms.size()) return false;
+
+    // Термины сравниваем попарно: каждое слово старого термина должно быть началом какого-то слова нового.
+    // Тогда контакт, у которого есть слова с началами из нового термина, подходит и под старый.
+    for (int i = 0; i < terms.size(); ++i) {
+        const QStringList tokens = queryTokens(terms[i]);
+        const QStringList refinedTokens = queryTokens(refinedTerms[i]);
+        if (refinedTokens.isEmpty()) continue;
+        if (tokens.isEmpty()) return false;
+
+        for (const QString &token : tokens) {
+            bool extended = std::any_of(refinedTokens.cbegin(), refinedTokens.cend(),
+                                        [&token](const QString &refinedToken) { return refinedToken.startsWith(token); });
+            if (!extended) return false;
+        }
+    }
+    return true;
+}
+
+void SearchIndex::addItem(int slot, const Item &item) {
+    const QStringList tokens = itemTokens(item);
+    for (const QString &token : tokens) {
+        QVector<int> &slotList = postings[token];
+        // Слоты почти всегда выдаются по возрастанию, так что это обычно вставка в конец
+        auto pos = std::lower_bound(slotList.begin(), slotList.end(), slot);
+        if (pos == slotList.end() || *pos != slot) slotList.insert(pos, slot);
+    }
+}
+
+void SearchIndex::removeItem(int slot, const Item &item) {
+    const QStringList tokens = itemTokens(item);
+    for (const QString &token : tokens) {
+        auto it = postings.find(token);
+        if (it == postings.end()) continue;
+
+        QVector<int> &slotList = it.value();
+        auto pos = std::lower_bound(slotList.begin(), slotList.end(), slot);
+        if (pos != slotList.end() && *pos == slot) slotList.erase(pos);
+        if (slotList.isEmpty()) postings.erase(it);
+    }
+}
+
+void SearchIndex::clear() {
+    postings.clear();
+}
+
+QVector<int> SearchIndex::lookupPrefix(const QString &prefix) const {
+    QVector<int> result;
+    int words = 0;
+    for (auto it = postings.lowerBound(prefix); it != postings.cend() && it.key().startsWith(prefix); ++it) {
+        result += it.value();
+        ++words;
+    }
+
+    // Если слово с таким префиксом одно, список уже отсортирован, иначе склеиваем и убираем повторы
+    if (words > 1) {
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+    }
+    return result;
+}
+
+QVector<int> SearchIndex::search(const QString &query) const {
+    QVector<int> found;
+
+    const QStringList terms = query.split(",", Qt::SkipEmptyParts);
+    for (const QString &term : terms) {
+        const QStringList tokens = queryTokens(term);
+        if (tokens.isEmpty()) continue;
+
+        // Списки для каждого слова термина, пересекаем начиная с самого короткого
+        QVector<QVector<int>> lists;
+        lists.reserve(tokens.size());
+        for (const QString &token : tokens) {
+            lists.append(lookupPrefix(token));
+        }
+        std::sort(lists.begin(), lists.end(), [](const QVector<int> &a, const QVector<int> &b) {
+            return a.size() < b.size();
+        });
+
+        QVector<int> termSlots = lists.first();
+        for (int i = 1; i < lists.size() && !termSlots.isEmpty(); ++i) {
+            termSlots = intersect(termSlots, lists[i]);
+        }
+
+        found = found.isEmpty() ? termSlots : unite(found, termSlots);
+    }
+    return found;
+}
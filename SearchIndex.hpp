@@ -0,0 +1,53 @@
+#ifndef SEARCHINDEX_H
+#define SEARCHINDEX_H
+
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "Item.hpp"
+
+/*
+ * Инвертированный индекс для поиска контактов.
+ * Для каждого слова (фамилия, имя, отчество, части e-mail и даты рождения, цифры телефонов)
+ * хранится отсортированный список слотов контактов, в которых оно встречается.
+ * Словарь упорядочен, поэтому все слова с заданным префиксом лежат подряд.
+ *
+ * Запрос: термины через запятую объединяются по ИЛИ, слова внутри термина - по И,
+ * каждое слово запроса ищется как начало слова контакта.
+ */
+class SearchIndex {
+public:
+    void addItem(int slot, const Item &item);
+    void removeItem(int slot, const Item &item);
+    void clear();
+
+    // Слоты подходящих контактов по возрастанию
+    QVector<int> search(const QString &query) const;
+
+    // Слова, под которыми контакт попадает в индекс
+    static QStringList itemTokens(const Item &item);
+
+    // Слова из телефонов: цифры номера с кодом страны и без него (их же индексирует FTS в БД)
+    static QStringList phoneTokens(const QVector<QString> &phones);
+
+    // Слова одного термина запроса (телефон сворачивается в одну строку цифр)
+    static QStringList queryTokens(const QString &term);
+
+    // Подходит ли контакт под запрос (та же логика, что у search, но без индекса - для потоковой обработки)
+    static bool matches(const Item &item, const QString &query);
+
+    // Всё, что находит refined, находит и query (запрос уточнили: дописали буквы или слова),
+    // так что refined можно искать только среди найденного по query
+    static bool narrows(const QString &query, const QString &refined);
+
+private:
+    // Все слоты, у которых есть слово, начинающееся с prefix
+    QVector<int> lookupPrefix(const QString &prefix) const;
+
+    // слово -> отсортированные слоты контактов
+    QMap<QString, QVector<int>> postings;
+};
+
+#endif // SEARCHINDEX_H
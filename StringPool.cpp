@@ -0,0 +1,70 @@
+#include "StringPool.hpp"
+#include <QHash>
+#include <algorithm>
+
+StringPool::StringPool() {
+    clear();
+}
+
+void StringPool::clear() {
+    chars.clear();
+    table.clear();
+    offsets = {0, 0};
+}
+
+int StringPool::count() const {
+    return offsets.size() - 1;
+}
+
+QStringView StringPool::view(quint32 id) const {
+    quint32 begin = offsets.at(id);
+    return QStringView(chars.constData() + begin, qsizetype(offsets.at(id + 1) - begin));
+}
+
+QString StringPool::string(quint32 id) const {
+    return view(id).toString();
+}
+
+void StringPool::rehash(int newSize) {
+    table.fill(0, newSize);
+    const size_t mask = size_t(newSize) - 1;
+    for (quint32 id = 1; id < quint32(count()); ++id) {
+        size_t pos = qHash(view(id)) & mask;
+        while (table[pos]) pos = (pos + 1) & mask;
+        table[pos] = id + 1;
+    }
+}
+
+quint32 StringPool::intern(QStringView text) {
+    if (text.isEmpty()) return 0;
+
+    // Таблица заполнена не больше чем на 3/4, иначе цепочки проб становятся длинными.
+    // У пула, прочитанного из снимка, таблицы нет совсем: она строится сразу нужного размера.
+    if (qsizetype(count() + 1) * 4 > qsizetype(table.size()) * 3) {
+        int newSize = std::max(1024, int(table.size()) * 2);
+        while (qsizetype(count() + 1) * 4 > qsizetype(newSize) * 3) newSize *= 2;
+        rehash(newSize);
+    }
+
+    const size_t mask = size_t(table.size()) - 1;
+    size_t pos = qHash(text) & mask;
+    while (table[pos]) {
+        quint32 id = table[pos] - 1;
+        if (view(id) == text) return id;
+        pos = (pos + 1) & mask;
+    }
+
+    quint32 id = quint32(count());
+    qsizetype begin = chars.size();
+    chars.resize(begin + text.size());
+    std::copy(text.utf16(), text.utf16() + text.size(), chars.begin() + begin);
+    offsets.append(quint32(chars.size()));
+    table[pos] = id + 1;
+    return id;
+}
+
+qsizetype StringPool::memoryUsage() const {
+    return chars.capacity() * qsizetype(sizeof(char16_t))
+         + offsets.capacity() * qsizetype(sizeof(quint32))
+         + table.capacity() * qsizetype(sizeof(quint32));
+}
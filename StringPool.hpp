@@ -0,0 +1,53 @@
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+
+#include <QString>
+#include <QStringView>
+#include <QVector>
+
+/*
+ * Пул строк: все строки лежат подряд в одном буфере, каждая хранится один раз и
+ * обозначается 4-байтовым номером. Вместо отдельного QString на каждую фамилию
+ * (заголовок + своя куча) у контакта остаётся только номер, а "Иванов" в книге
+ * на миллион контактов занимает память один раз.
+ *
+ * Строки из пула не удаляются. Номер 0 - всегда пустая строка.
+ */
+class StringPool {
+public:
+    StringPool();
+
+    // Номер строки; если такой строки ещё нет, она дописывается в пул.
+    // text не должен указывать внутрь самого пула.
+    quint32 intern(QStringView text);
+
+    // Строка по номеру. Указывает в буфер пула и действительна до следующего intern.
+    QStringView view(quint32 id) const;
+    QString string(quint32 id) const;
+
+    // Сколько разных строк в пуле (включая пустую)
+    int count() const;
+
+    void clear();
+
+    // Сколько байт занимает пул
+    qsizetype memoryUsage() const;
+
+private:
+    // Снимок книги читает и пишет буфер пула напрямую (таблица после чтения строится при первом intern)
+    friend class ContactSnapshot;
+
+    // Перестроить хеш-таблицу под newSize ячеек (степень двойки)
+    void rehash(int newSize);
+
+    // Символы всех строк подряд
+    QVector<char16_t> chars;
+
+    // Строка id занимает chars[offsets[id], offsets[id + 1])
+    QVector<quint32> offsets;
+
+    // Открытая адресация: в ячейке номер строки + 1, 0 - свободно
+    QVector<quint32> table;
+};
+
+#endif // STRINGPOOL_H
@@ -0,0 +1,209 @@
+#include "Trace.hpp"
+#include "LatencyHistogram.hpp"
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStringList>
+#include <QTextStream>
+#include <QVector>
+#include <map>
+#include <memory>
+
+namespace {
+
+struct Event {
+    const char *name;
+    char phase;     // 'X' - участок кода, 'C' - значение счётчика
+    int thread;
+    qint64 time;    // нс от старта
+    qint64 value;   // длительность в нс или значение счётчика
+};
+
+struct TraceState {
+    QMutex mutex;
+    QElapsedTimer clock;
+
+    QVector<Event> events;
+    qint64 droppedEvents = 0;
+
+    // По месту замера и по категории целиком ("sql.*"); std::map - чтобы статистика шла по алфавиту
+    std::map<QByteArray, std::unique_ptr<LatencyHistogram>> latencies;
+    std::map<QByteArray, qint64> counters;
+    std::map<QByteArray, qint64> gauges;
+
+    // Для скорости запросов в shortStats: с прошлого вызова
+    qint64 lastStatsTime = 0;
+    qint64 lastSqlCount = 0;
+
+    TraceState() { clock.start(); }
+};
+
+TraceState &state() {
+    static TraceState traceState;
+    return traceState;
+}
+
+// Небольшой номер потока для tid в трассе
+int threadNumber() {
+    static std::atomic<int> next{1};
+    thread_local int number = next++;
+    return number;
+}
+
+LatencyHistogram &histogramFor(TraceState &traceState, const QByteArray &name) {
+    std::unique_ptr<LatencyHistogram> &histogram = traceState.latencies[name];
+    if (!histogram) histogram = std::make_unique<LatencyHistogram>();
+    return *histogram;
+}
+
+void appendEvent(TraceState &traceState, const Event &event) {
+    if (traceState.events.size() < Trace::MaxEvents) {
+        traceState.events.append(event);
+    } else {
+        ++traceState.droppedEvents;
+    }
+}
+
+QString microseconds(qint64 nanoseconds) {
+    return QString::number(nanoseconds / 1000.0, 'f', 3);
+}
+
+}
+
+std::atomic<bool> Trace::enabled{false};
+
+void Trace::setEnabled(bool on) {
+    // Часы трассировки запускаются при первом обращении
+    state();
+    enabled.store(on, std::memory_order_relaxed);
+}
+
+qint64 Trace::now() {
+    return state().clock.nsecsElapsed();
+}
+
+void Trace::record(const char *name, qint64 beginNs, qint64 endNs) {
+    TraceState &traceState = state();
+    const QByteArray key(name);
+    const qint64 micros = (endNs - beginNs) / 1000;
+    const int dot = key.indexOf('.');
+
+    QMutexLocker locker(&traceState.mutex);
+    appendEvent(traceState, {name, 'X', threadNumber(), beginNs, endNs - beginNs});
+    histogramFor(traceState, key).record(micros);
+    if (dot > 0) histogramFor(traceState, key.left(dot) + ".*").record(micros);
+}
+
+void Trace::count(const char *name, qint64 delta) {
+    if (!isEnabled()) return;
+    TraceState &traceState = state();
+    qint64 time = now();
+
+    QMutexLocker locker(&traceState.mutex);
+    qint64 &value = traceState.counters[QByteArray(name)];
+    value += delta;
+    appendEvent(traceState, {name, 'C', threadNumber(), time, value});
+}
+
+void Trace::gauge(const char *name, qint64 value) {
+    if (!isEnabled()) return;
+    TraceState &traceState = state();
+    qint64 time = now();
+
+    QMutexLocker locker(&traceState.mutex);
+    traceState.gauges[QByteArray(name)] = value;
+    appendEvent(traceState, {name, 'C', threadNumber(), time, value});
+}
+
+bool Trace::writeChromeTrace(const QString &fileName, QString &errText) {
+    TraceState &traceState = state();
+    QVector<Event> events;
+    {
+        QMutexLocker locker(&traceState.mutex);
+        events = traceState.events;
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        errText = "Не удалось открыть файл трассировки: " + file.errorString();
+        return false;
+    }
+
+    // Имена - литералы из кода без кавычек и обратных слешей, экранировать их не нужно
+    QTextStream out(&file);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    for (int i = 0; i < events.size(); ++i) {
+        const Event &event = events[i];
+        const QByteArray name(event.name);
+        const int dot = name.indexOf('.');
+        const QByteArray category = dot > 0 ? name.left(dot) : name;
+
+        out << "{\"name\":\"" << event.name << "\",\"cat\":\"" << category << "\",\"ph\":\"" << event.phase
+            << "\",\"pid\":1,\"tid\":" << event.thread << ",\"ts\":" << microseconds(event.time);
+        if (event.phase == 'X') {
+            out << ",\"dur\":" << microseconds(event.value) << "}";
+        } else {
+            out << ",\"args\":{\"value\":" << event.value << "}}";
+        }
+        out << (i + 1 < events.size() ? ",\n" : "\n");
+    }
+    out << "]}\n";
+    out.flush();
+
+    if (out.status() != QTextStream::Ok || file.error() != QFileDevice::NoError) {
+        errText = "Ошибка записи файла трассировки: " + file.errorString();
+        return false;
+    }
+    return true;
+}
+
+QString Trace::stats() {
+    TraceState &traceState = state();
+    QMutexLocker locker(&traceState.mutex);
+
+    double seconds = traceState.clock.nsecsElapsed() / 1e9;
+    QStringList lines;
+    lines.append(QString("Время: %1 с, событий: %2 (не записано: %3)")
+                     .arg(seconds, 0, 'f', 1).arg(traceState.events.size()).arg(traceState.droppedEvents));
+
+    for (const auto &entry : traceState.latencies) {
+        const LatencyHistogram &histogram = *entry.second;
+        lines.append(QString("%1: n=%2 (%3/с) p50<=%4us p99<=%5us max=%6us")
+                         .arg(QString::fromLatin1(entry.first)).arg(histogram.count())
+                         .arg(seconds > 0 ? histogram.count() / seconds : 0.0, 0, 'f', 1)
+                         .arg(histogram.percentile(50)).arg(histogram.percentile(99)).arg(histogram.max()));
+    }
+    for (const auto &entry : traceState.counters) {
+        lines.append(QString("%1 = %2 (%3/с)").arg(QString::fromLatin1(entry.first)).arg(entry.second)
+                         .arg(seconds > 0 ? entry.second / seconds : 0.0, 0, 'f', 1));
+    }
+    for (const auto &entry : traceState.gauges) {
+        lines.append(QString("%1 = %2").arg(QString::fromLatin1(entry.first)).arg(entry.second));
+    }
+    return lines.join('\n');
+}
+
+QString Trace::shortStats() {
+    TraceState &traceState = state();
+    QMutexLocker locker(&traceState.mutex);
+
+    qint64 time = traceState.clock.nsecsElapsed();
+    auto sql = traceState.latencies.find("sql.*");
+    qint64 sqlCount = sql != traceState.latencies.end() ? sql->second->count() : 0;
+    double interval = (time - traceState.lastStatsTime) / 1e9;
+    double rate = interval > 0 ? (sqlCount - traceState.lastSqlCount) / interval : 0.0;
+    traceState.lastStatsTime = time;
+    traceState.lastSqlCount = sqlCount;
+
+    auto rows = traceState.counters.find("rows.loaded");
+    auto bytes = traceState.gauges.find("model.bytes");
+
+    return QString("Загружено: %1 | SQL/с: %2 | SQL p50<=%3 мкс, p99<=%4 мкс | модель: %5 КБ")
+        .arg(rows != traceState.counters.end() ? rows->second : 0)
+        .arg(rate, 0, 'f', 0)
+        .arg(sql != traceState.latencies.end() ? sql->second->percentile(50) : 0)
+        .arg(sql != traceState.latencies.end() ? sql->second->percentile(99) : 0)
+        .arg(bytes != traceState.gauges.end() ? bytes->second / 1024 : 0);
+}
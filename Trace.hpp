@@ -0,0 +1,65 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QString>
+#include <atomic>
+
+/*
+ * Трассировка и счётчики горячих мест (SQL-запросы, загрузка, сохранение, поиск, обновление модели).
+ * По умолчанию выключена: TraceScope тогда стоит одно чтение атомарного флага, поэтому
+ * замеры остаются в рабочей сборке. Включается флагами --stats / --trace.
+ *
+ * Собранное можно выгрузить в формате Chrome trace events (chrome://tracing, Perfetto)
+ * или получить текстом: число вызовов и перцентили задержки по каждому месту, счётчики и их скорость.
+ * Имена мест - строковые литералы вида "категория.действие" ("sql.insert", "model.sort").
+ */
+class Trace {
+public:
+    // Больше событий для выгрузки не копим (статистика при этом продолжает считаться)
+    static constexpr int MaxEvents = 1000000;
+
+    static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+    static void setEnabled(bool on);
+
+    // Прибавить к счётчику (строк загружено, импортировано...)
+    static void count(const char *name, qint64 delta = 1);
+
+    // Текущее значение величины (например, память модели в байтах)
+    static void gauge(const char *name, qint64 value);
+
+    // Записать события в файл JSON для chrome://tracing
+    static bool writeChromeTrace(const QString &fileName, QString &errText);
+
+    // Полная статистика, по строке на место замера и на счётчик
+    static QString stats();
+
+    // Короткая строка для строки состояния окна: загружено строк, запросов/с, p50/p99 SQL
+    static QString shortStats();
+
+private:
+    friend class TraceScope;
+
+    // Наносекунды с момента старта трассировки
+    static qint64 now();
+    static void record(const char *name, qint64 beginNs, qint64 endNs);
+
+    static std::atomic<bool> enabled;
+};
+
+// Замер участка кода от конструктора до деструктора
+class TraceScope {
+public:
+    explicit TraceScope(const char *name) : name(name), begin(Trace::isEnabled() ? Trace::now() : -1) {}
+    ~TraceScope() {
+        if (begin >= 0) Trace::record(name, begin, Trace::now());
+    }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    const char *name;
+    qint64 begin;
+};
+
+#endif // TRACE_H
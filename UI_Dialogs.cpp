@@ -1,36 +1,41 @@
 #include "UI_Dialogs.h"
-#include <qregularexpression.h>
-#include "QRegularExpression"
-#include "QDate"
-
-searchAddressBookItemDialog::searchAddressBookItemDialog(QWidget *parent) : QDialog(parent) {
-    QVBoxLayout *mainLayout = new QVBoxLayout(this);
-
-    searchInput = new QLineEdit(this);
-    searchInput->setPlaceholderText("Введите текст для поиска");
-
-    searchButton = new QPushButton("Поиск", this);
-    cancelButton = new QPushButton("Отмена", this);
-
-    connect(searchButton, &QPushButton::clicked, this, &searchAddressBookItemDialog::accept);
-    connect(cancelButton, &QPushButton::clicked, this, &searchAddressBookItemDialog::reject);
-
-    mainLayout->addWidget(new QLabel("Поиск по контактам:", this));
-    mainLayout->addWidget(searchInput);
-
-
-    QHBoxLayout *buttonLayout = new QHBoxLayout;
-    buttonLayout->addWidget(searchButton);
-    buttonLayout->addWidget(cancelButton);
-
-    mainLayout->addLayout(buttonLayout);
+#include "ItemValidator.hpp"
+
+namespace {
+
+/*
+ * Общая проверка полей диалогов добавления и редактирования.
+ * fields и inputs идут в порядке getItem(): фамилия, имя, отчество, телефоны (через запятую), e-mail, дата рождения.
+ * При ошибке показываем сообщение о первом неверном поле и ставим на него курсор.
+ */
+bool validateFields(QWidget *dialog, const QStringList &fields, QLineEdit *const inputs[6]) {
+    Item item;
+    item.userLastName = fields[0];
+    item.userFirstName = fields[1];
+    item.userPatronymicName = fields[2];
+    item.userPhonesList = fields[3].split(",", Qt::SkipEmptyParts).toVector();
+    item.userEmail = fields[4];
+    item.userBirthday = fields[5];
+
+    ItemValidator::Result result = ItemValidator::check(item);
+    if (result.isValid()) return true;
+
+    static const ItemValidator::Field fieldOrder[] = {
+        ItemValidator::LastName, ItemValidator::FirstName, ItemValidator::Patronymic,
+        ItemValidator::Phones, ItemValidator::Email, ItemValidator::Birthday
+    };
+    for (int i = 0; i < 6; ++i) {
+        if (!result.has(fieldOrder[i])) continue;
+        QMessageBox::warning(dialog, "Ошибка", ItemValidator::message(fieldOrder[i]));
+        inputs[i]->setFocus();
+        inputs[i]->selectAll();
+        break;
+    }
+    return false;
 }
 
-QString searchAddressBookItemDialog::getSearchTerm() const {
-    return searchInput->text().trimmed();
 }
 
-
 addAddressBookItemDialog::addAddressBookItemDialog(QWidget *parent) : QDialog(parent) {
 
     // Создается вертикальный макет QVBoxLayout, который будет управлять расположением дочерних виджетов
@@ -94,41 +99,9 @@ QStringList addAddressBookItemDialog::getItem() const {
 
 // Проверка корректности ввода данных
 bool addAddressBookItemDialog::validateInput() {
-    // Регулярное выражение для проверки фамилии, имени, отчества
-    QRegularExpression nameRegex("^[A-Z]+([ -]?[A-Za-z0-9]+)*$");
-    if (!nameRegex.match(userLastNameInput->text().trimmed()).hasMatch() ||
-        !nameRegex.match(userFirstNameInput->text().trimmed()).hasMatch() ||
-        !nameRegex.match(userPatronymicNameInput->text().trimmed()).hasMatch()) {
-        QMessageBox::warning(this, "Ошибка", "Фамилия, имя и отчество должны начинаться с буквы, "
-                                             "могут содержать дефис, пробел и цифры, но не могут заканчиваться или начинаться на дефис.");
-        return false;
-    }
-
-    // Регулярное выражение для проверки телефона
-    QRegularExpression phoneRegex("^(\\+7|8)\\(?\\d{3}\\)?[ \\-]?\\d{3}[ \\-]?\\d{2}[ \\-]?\\d{2}$");
-    if (!phoneRegex.match(phoneInput->text().trimmed()).hasMatch()) {
-        QMessageBox::warning(this, "Ошибка", "Телефон должен быть в формате +7(8)XXXXXXXXXX, где X — цифры.");
-        return false;
-    }
-
-    // Получение введенного e-mail из соответствующего текстового поля
-    QString userEmail = userEmailInput->text().trimmed(); // Удаляем лишние пробелы
-
-    // Регулярное выражение для проверки e-mail
-    QRegularExpression emailRegex("[A-Za-z0-9._%+-]+@[A-Za-z0-9.-]+\\.[A-Za-z]{2,}$");
-    if (!emailRegex.match(userEmail).hasMatch()) {
-        QMessageBox::warning(this, "Ошибка", "E-mail должен быть в формате example@domain.com.");
-        return false;
-    }
-
-    // Проверка даты рождения
-    QDate userBirthday = QDate::fromString(userBirthdayInput->text().trimmed(), "dd-MM-yyyy");
-    if (!userBirthday.isValid() || userBirthday >= QDate::currentDate()) {
-        QMessageBox::warning(this, "Ошибка", "Дата рождения должна быть корректной и меньше текущей даты.");
-        return false;
-    }
-
-    return true;
+    QLineEdit *const inputs[6] = { userLastNameInput, userFirstNameInput, userPatronymicNameInput,
+                                   phoneInput, userEmailInput, userBirthdayInput };
+    return validateFields(this, getItem(), inputs);
 }
 
 //диалоговое окно об удалении контакта
@@ -225,10 +198,9 @@ QStringList editAddressBookItemDialog::getItem() const {
             phoneInput->text(), userEmailInput->text(), userBirthdayInput->text()};
 }
 
+// Правила те же, что и при добавлении контакта
 bool editAddressBookItemDialog::validateInput() {
-    if (userLastNameInput->text().isEmpty() || userFirstNameInput->text().isEmpty()) {
-        QMessageBox::warning(this, "Ошибка", "Фамилия и имя не могут быть пустыми.");
-        return false;
-    }
-    return true;
+    QLineEdit *const inputs[6] = { userLastNameInput, userFirstNameInput, userPatronymicNameInput,
+                                   phoneInput, userEmailInput, userBirthdayInput };
+    return validateFields(this, getItem(), inputs);
 }
@@ -0,0 +1,147 @@
+#include "WriteQueue.hpp"
+#include "AsyncStorage.hpp"
+#include "ContactsModel.hpp"
+#include "Trace.hpp"
+
+WriteQueue::WriteQueue(ContactsModel *model, AsyncStorage *storage, QObject *parent)
+    : QObject(parent), model(model), storage(storage) {
+    delay.setSingleShot(true);
+    delay.setInterval(DefaultMaxDelayMs);
+    connect(&delay, &QTimer::timeout, this, &WriteQueue::flush);
+    retry.setSingleShot(true);
+    connect(&retry, &QTimer::timeout, this, &WriteQueue::flush);
+
+    // Записанная транзакция должна пережить сбой питания: fsync на каждый коммит.
+    // Очередь для этого и нужна - чтобы коммитов (и fsync) было мало.
+    storage->setFullSync(true);
+}
+
+WriteQueue::Durability WriteQueue::durabilityFromString(const QString &name, bool *ok) {
+    const QString lower = name.trimmed().toLower();
+    if (ok) *ok = lower == "strict" || lower == "grouped";
+    return lower == "strict" ? Durability::Strict : Durability::Grouped;
+}
+
+void WriteQueue::setDurability(Durability durability) {
+    mode = durability;
+    if (mode == Durability::Strict && pending > 0) flush();
+}
+
+WriteQueue::Durability WriteQueue::durability() const {
+    return mode;
+}
+
+void WriteQueue::setThresholds(int maxPending, int maxDelayMs) {
+    this->maxPending = qMax(1, maxPending);
+    delay.setInterval(qMax(0, maxDelayMs));
+}
+
+void WriteQueue::changed(int count) {
+    pending += count;
+
+    // После неудачи правки ждут повтора, а не пишутся сразу
+    if (retry.isActive()) return;
+
+    if (mode == Durability::Strict || pending >= maxPending) {
+        flush();
+    } else if (!delay.isActive()) {
+        delay.start();
+    }
+}
+
+void WriteQueue::flush() {
+    delay.stop();
+    retry.stop();
+    if (saving) {
+        // Текущая транзакция ещё идёт; как только она запишется, следующая уйдёт сразу
+        flushRequested = true;
+        return;
+    }
+    save();
+}
+
+void WriteQueue::whenFlushed(const std::function<void()> &function) {
+    afterFlush.append(function);
+    flush();
+}
+
+bool WriteQueue::isIdle() const {
+    return !saving && !model->hasChanges();
+}
+
+int WriteQueue::transactionCount() const {
+    return transactions;
+}
+
+int WriteQueue::flushedChanges() const {
+    return flushed;
+}
+
+void WriteQueue::save() {
+    /*
+     * В БД пишем только то, что поменялось с прошлой транзакции: удалённые, добавленные и изменённые записи.
+     * Всё идёт одной транзакцией в потоке БД. Записи, которые сейчас сохраняются, модель
+     * не отдаёт второй раз; правки, сделанные за время записи, уйдут следующей транзакцией.
+     */
+    ContactsModel::PendingChanges changes = model->takeChanges();
+    if (changes.isEmpty()) {
+        pending = 0;
+        runWhenFlushed();
+        return;
+    }
+
+    TraceScope trace("queue.flush");
+    Trace::count("queue.changes", pending);
+    saving = true;
+    inFlight = pending;
+    pending = 0;
+
+    storage->save(changes.removedIds, changes.removedVersions, changes.items).then(this, [this, changes](const StorageReply &reply) {
+        saving = false;
+        const int count = inFlight;
+        inFlight = 0;
+
+        if (!reply.ok) {
+            // Транзакция откатилась, изменения снова помечены и уйдут со следующей записью
+            model->saveFailed(changes);
+            pending += count;
+            flushRequested = false;
+
+            // Сами по себе правки больше не уйдут, поэтому повторяем, с каждой неудачей реже
+            ++failures;
+            if (pending > 0) retry.start(qMin(MaxRetryDelayMs, RetryDelayMs << qMin(failures - 1, 6)));
+
+            emit failed(reply.errorText);
+            runWhenFlushed();
+            return;
+        }
+
+        // Только теперь изменения точно в БД, снимаем с записей пометки
+        model->markSaved(changes, reply.userIds, reply.versions);
+        failures = 0;
+        ++transactions;
+        flushed += count;
+        emit saved(count);
+
+        // Чужая правка оказалась раньше нашей: наша не записана, а в модель кладём то, что в БД
+        if (reply.conflicts > 0) {
+            model->applyRemoteChanges(reply.items, reply.removedIds);
+            emit conflicted(reply.conflicts);
+        }
+
+        if (flushRequested || mode == Durability::Strict || pending >= maxPending || !afterFlush.isEmpty()) {
+            flushRequested = false;
+            save();
+        } else if (pending > 0 && !delay.isActive()) {
+            delay.start();
+        }
+    });
+}
+
+void WriteQueue::runWhenFlushed() {
+    if (saving) return;
+
+    QVector<std::function<void()>> functions;
+    functions.swap(afterFlush);
+    for (const auto &function : functions) function();
+}
@@ -0,0 +1,113 @@
+#ifndef WRITEQUEUE_H
+#define WRITEQUEUE_H
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+#include <functional>
+
+class AsyncStorage;
+class ContactsModel;
+
+/*
+ * Очередь записи правок в БД (group commit).
+ * Правки копятся в модели (ContactsModel помнит изменённые и удалённые записи), а очередь
+ * решает, когда забрать их и записать одной транзакцией через AsyncStorage:
+ *  - Strict: после каждой правки, то есть транзакция и fsync на каждое действие;
+ *  - Grouped: когда наберётся maxPending правок или пройдёт maxDelayMs с первой из них,
+ *    то есть одна транзакция и один fsync на группу.
+ * В обоих режимах БД работает с synchronous=FULL: записанная транзакция переживёт и сбой питания,
+ * а разница только в том, сколько правок ждут своей транзакции (в Grouped - не дольше maxDelayMs).
+ *
+ * Пока транзакция идёт, новые правки продолжают копиться и уходят следующей.
+ * Если транзакция не удалась, следующая попытка будет через RetryDelayMs, и после каждой новой неудачи
+ * пауза удваивается (до MaxRetryDelayMs); новые правки в это время копятся, не дёргая БД.
+ */
+class WriteQueue : public QObject {
+    Q_OBJECT
+
+public:
+    enum class Durability {
+        Strict,
+        Grouped
+    };
+
+    static constexpr int DefaultMaxPending = 256;
+    static constexpr int DefaultMaxDelayMs = 200;
+
+    // Пауза перед повтором после неудачной транзакции и её предел
+    static constexpr int RetryDelayMs = 1000;
+    static constexpr int MaxRetryDelayMs = 60000;
+
+    // storage уже должен быть открыт
+    WriteQueue(ContactsModel *model, AsyncStorage *storage, QObject *parent = nullptr);
+
+    void setDurability(Durability durability);
+    Durability durability() const;
+
+    // Пороги режима Grouped
+    void setThresholds(int maxPending, int maxDelayMs);
+
+    // В модели сделано count правок
+    void changed(int count = 1);
+
+    // Записать всё накопленное сейчас, не дожидаясь порогов
+    void flush();
+
+    // Выполнить function, когда всё, что накоплено к этому моменту, дойдёт до БД (или запись не удастся).
+    // Нужно тем, кто читает БД своим соединением или ставит в очередь БД запрос, который должен видеть правки.
+    void whenFlushed(const std::function<void()> &function);
+
+    // Ничего не накоплено и ничего не пишется
+    bool isIdle() const;
+
+    // Сколько транзакций записано и сколько правок в них ушло
+    int transactionCount() const;
+    int flushedChanges() const;
+
+    // Разбор имени режима ("strict", "grouped"); при неизвестном имени ok = false
+    static Durability durabilityFromString(const QString &name, bool *ok = nullptr);
+
+signals:
+    // Транзакция записана, changeCount - сколько правок (по числу вызовов changed) в неё вошло
+    void saved(int changeCount);
+
+    // Транзакция откатилась; изменения снова помечены и уйдут со следующей
+    void failed(const QString &errText);
+
+    // count записей не записано: их успели изменить или удалить в другом окне. В модели теперь то, что в БД.
+    void conflicted(int count);
+
+private:
+    void save();
+    void runWhenFlushed();
+
+    ContactsModel *model;
+    AsyncStorage *storage;
+
+    Durability mode = Durability::Grouped;
+    int maxPending = DefaultMaxPending;
+
+    // Срабатывает через maxDelayMs после первой правки группы
+    QTimer delay;
+
+    // Повтор после неудачной транзакции и сколько неудач было подряд
+    QTimer retry;
+    int failures = 0;
+
+    // Правок с прошлой транзакции и сколько из них ушло в текущую
+    int pending = 0;
+    int inFlight = 0;
+    bool saving = false;
+
+    // flush пришёл, пока шла транзакция
+    bool flushRequested = false;
+
+    int transactions = 0;
+    int flushed = 0;
+
+    QVector<std::function<void()>> afterFlush;
+};
+
+#endif // WRITEQUEUE_H
@@ -0,0 +1,51 @@
+#include "AddressBookBenchmark.hpp"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QTextStream>
+#include <cstdio>
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("addressbook-bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Замеры загрузки, поиска, правки и сохранения на синтетических книгах");
+    parser.addHelpOption();
+    QCommandLineOption sizesOption("sizes", "Размеры книг через запятую", "N,N,...", "10000,100000,1000000");
+    QCommandLineOption searchesOption("searches", "Сколько поисковых запросов на размер", "N", "1000");
+    QCommandLineOption editsOption("edits", "Сколько правок с сохранением на размер", "N", "200");
+    QCommandLineOption outputOption("output", "Файл для результатов JSON (по умолчанию - стандартный вывод)", "file");
+    parser.addOptions({sizesOption, searchesOption, editsOption, outputOption});
+    parser.process(app);
+
+    AddressBookBenchmark::Options options;
+    options.sizes.clear();
+    for (const QString &size : parser.value(sizesOption).split(',', Qt::SkipEmptyParts)) {
+        bool ok = false;
+        int value = size.trimmed().toInt(&ok);
+        if (!ok || value <= 0) {
+            QTextStream(stderr) << "Неверный размер книги: " << size << "\n";
+            return 2;
+        }
+        options.sizes.append(value);
+    }
+    options.searches = qMax(1, parser.value(searchesOption).toInt());
+    options.edits = qMax(1, parser.value(editsOption).toInt());
+
+    AddressBookBenchmark benchmark(options);
+    if (!benchmark.run()) {
+        QTextStream(stderr) << benchmark.lastError() << "\n";
+        return 1;
+    }
+
+    QFile output(parser.value(outputOption));
+    bool opened = parser.isSet(outputOption) ? output.open(QIODevice::WriteOnly | QIODevice::Truncate)
+                                             : output.open(stdout, QIODevice::WriteOnly);
+    if (!opened) {
+        QTextStream(stderr) << "Не удалось открыть файл результатов: " << output.errorString() << "\n";
+        return 1;
+    }
+    output.write(benchmark.results().toJson());
+    return 0;
+}
@@ -0,0 +1,11 @@
+#include "AddressBookCli.hpp"
+#include <QCoreApplication>
+
+int main(int argc, char *argv[]) {
+    // QCoreApplication без цикла событий: команды выполняются по порядку и сразу завершаются
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("addressbook-cli");
+
+    AddressBookCli cli;
+    return cli.run(app.arguments());
+}
@@ -1,11 +1,47 @@
 #include "AddressBook.hpp"
+#include "Trace.hpp"
 #include <QApplication>
+#include <QDebug>
 
 int main(int argc, char *argv[]) {
     QApplication app(argc, argv);
+    const QStringList arguments = app.arguments();
 
-    AddressBook AddressBook;
-    AddressBook.show();
+    // --low-memory: не загружать книгу целиком, искать прямо в БД
+    bool lowMemoryMode = arguments.contains("--low-memory");
 
-    return app.exec();
+    // --durability strict|grouped: транзакция на каждую правку или на группу правок (по умолчанию)
+    WriteQueue::Durability durability = WriteQueue::Durability::Grouped;
+    int durabilityIndex = arguments.indexOf("--durability");
+    if (durabilityIndex >= 0) {
+        bool ok = false;
+        durability = WriteQueue::durabilityFromString(arguments.value(durabilityIndex + 1), &ok);
+        if (!ok) qWarning().noquote() << "Неизвестный режим --durability, используется grouped";
+    }
+
+    // --snapshot: открывать книгу из снимка на диске рядом с БД и обновлять его при выходе
+    bool snapshotCache = arguments.contains("--snapshot");
+
+    // --stats: сводка замеров в строке состояния и полная статистика при выходе
+    // --trace <файл>: записать события в формате chrome://tracing при выходе
+    bool statsMode = arguments.contains("--stats");
+    int traceIndex = arguments.indexOf("--trace");
+    QString traceFile = traceIndex >= 0 ? arguments.value(traceIndex + 1) : QString();
+    Trace::setEnabled(statsMode || !traceFile.isEmpty());
+
+    int result;
+    {
+        AddressBook AddressBook(nullptr, lowMemoryMode, durability, snapshotCache);
+        AddressBook.show();
+
+        result = app.exec();
+    }
+
+    // Окно уже закрыто и последнее сохранение записано, так что в замеры попало всё
+    if (statsMode) qInfo().noquote() << Trace::stats();
+    if (!traceFile.isEmpty()) {
+        QString errText;
+        if (!Trace::writeChromeTrace(traceFile, errText)) qWarning().noquote() << errText;
+    }
+    return result;
 }
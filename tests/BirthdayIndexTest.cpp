@@ -0,0 +1,172 @@
+#include <QtTest>
+
+#include "BirthdayIndex.hpp"
+#include "ContactStore.hpp"
+
+/*
+ * Проверки индекса дней рождения: окна через Новый год, 29 февраля в невисокосный год,
+ * окно длиной в год, диапазоны дат рождения и поддержка индекса при правках.
+ */
+class BirthdayIndexTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void monthDayRanges_data();
+    void monthDayRanges();
+    void birthdayIn();
+    void nextBirthday();
+
+    void upcomingAcrossNewYear();
+    void upcomingLeapDay();
+    void upcomingWholeYear();
+    void bornBetween();
+    void maintainedOnEdits();
+
+private:
+    // Строки "слот дата возраст", чтобы QCOMPARE показывал расхождение целиком
+    static QStringList describe(const QVector<BirthdayIndex::Upcoming> &upcoming);
+    static QList<QPair<int, int>> pairs(const QVector<BirthdayIndex::MonthDayRange> &ranges);
+    static Item person(const QString &birthday);
+
+    ContactStore contacts;
+    QVector<int> liveSlots;
+};
+
+Item BirthdayIndexTest::person(const QString &birthday) {
+    Item item;
+    item.userLastName = "Иванов";
+    item.userBirthday = birthday;
+    return item;
+}
+
+QStringList BirthdayIndexTest::describe(const QVector<BirthdayIndex::Upcoming> &upcoming) {
+    QStringList result;
+    for (const BirthdayIndex::Upcoming &entry : upcoming) {
+        result.append(QString("%1 %2 %3").arg(entry.slot).arg(entry.date.toString("dd-MM-yyyy")).arg(entry.age));
+    }
+    return result;
+}
+
+QList<QPair<int, int>> BirthdayIndexTest::pairs(const QVector<BirthdayIndex::MonthDayRange> &ranges) {
+    QList<QPair<int, int>> result;
+    for (const BirthdayIndex::MonthDayRange &range : ranges) result.append({range.first, range.last});
+    return result;
+}
+
+void BirthdayIndexTest::initTestCase() {
+    liveSlots.append(contacts.append(person("29-02-2000")));   // 0
+    liveSlots.append(contacts.append(person("01-01-1990")));   // 1
+    liveSlots.append(contacts.append(person("26-12-1985")));   // 2
+    liveSlots.append(contacts.append(person("не помню")));     // 3 - не дата
+    liveSlots.append(contacts.append(person("01-06-1970")));   // 4
+    liveSlots.append(contacts.append(person("")));             // 5 - даты нет
+}
+
+void BirthdayIndexTest::monthDayRanges_data() {
+    QTest::addColumn<QDate>("from");
+    QTest::addColumn<int>("days");
+    QTest::addColumn<QList<QPair<int, int>>>("expected");
+
+    using Ranges = QList<QPair<int, int>>;
+    QTest::newRow("inside year") << QDate(2026, 1, 10) << 14 << Ranges{{110, 123}};
+    QTest::newRow("new year") << QDate(2025, 12, 25) << 14 << Ranges{{1225, 1231}, {101, 107}};
+    QTest::newRow("ends feb 28, non-leap") << QDate(2026, 2, 15) << 14 << Ranges{{215, 229}};
+    QTest::newRow("ends feb 28, leap") << QDate(2028, 2, 15) << 14 << Ranges{{215, 228}};
+    QTest::newRow("one day") << QDate(2026, 7, 4) << 1 << Ranges{{704, 704}};
+    QTest::newRow("longer than year") << QDate(2026, 6, 1) << 1000 << Ranges{{601, 1231}, {101, 601}};
+    QTest::newRow("empty window") << QDate(2026, 6, 1) << 0 << Ranges{};
+    QTest::newRow("invalid date") << QDate() << 14 << Ranges{};
+}
+
+void BirthdayIndexTest::monthDayRanges() {
+    QFETCH(QDate, from);
+    QFETCH(int, days);
+    QFETCH(QList<QPair<int, int>>, expected);
+
+    QCOMPARE(pairs(BirthdayIndex::monthDayRanges(from, days)), expected);
+}
+
+void BirthdayIndexTest::birthdayIn() {
+    QCOMPARE(BirthdayIndex::birthdayIn(2026, 2, 29), QDate(2026, 2, 28));
+    QCOMPARE(BirthdayIndex::birthdayIn(2028, 2, 29), QDate(2028, 2, 29));
+    QCOMPARE(BirthdayIndex::birthdayIn(2026, 12, 31), QDate(2026, 12, 31));
+}
+
+void BirthdayIndexTest::nextBirthday() {
+    QCOMPARE(BirthdayIndex::nextBirthday(QDate(1990, 3, 10), QDate(2026, 3, 10)), QDate(2026, 3, 10));
+    QCOMPARE(BirthdayIndex::nextBirthday(QDate(1990, 3, 10), QDate(2026, 3, 11)), QDate(2027, 3, 10));
+    QCOMPARE(BirthdayIndex::nextBirthday(QDate(2000, 2, 29), QDate(2026, 2, 1)), QDate(2026, 2, 28));
+    QCOMPARE(BirthdayIndex::nextBirthday(QDate(2000, 2, 29), QDate(2026, 3, 1)), QDate(2027, 2, 28));
+    QCOMPARE(BirthdayIndex::nextBirthday(QDate(2000, 2, 29), QDate(2027, 3, 1)), QDate(2028, 2, 29));
+    QVERIFY(!BirthdayIndex::nextBirthday(QDate(), QDate(2026, 1, 1)).isValid());
+}
+
+void BirthdayIndexTest::upcomingAcrossNewYear() {
+    BirthdayIndex index(contacts);
+    index.build(liveSlots);
+
+    QCOMPARE(describe(index.upcoming(QDate(2025, 12, 25), 14)),
+             QStringList({"2 26-12-2025 40", "1 01-01-2026 36"}));
+}
+
+void BirthdayIndexTest::upcomingLeapDay() {
+    BirthdayIndex index(contacts);
+    index.build(liveSlots);
+
+    // В невисокосный год - 28 февраля, окно до 28-го включительно его находит
+    QCOMPARE(describe(index.upcoming(QDate(2026, 2, 20), 9)), QStringList({"0 28-02-2026 26"}));
+    // С 1 марта 28 февраля уже прошло
+    QVERIFY(index.upcoming(QDate(2026, 3, 1), 10).isEmpty());
+    // В високосный год - только 29-го
+    QVERIFY(index.upcoming(QDate(2028, 2, 20), 9).isEmpty());
+    QCOMPARE(describe(index.upcoming(QDate(2028, 2, 20), 10)), QStringList({"0 29-02-2028 28"}));
+}
+
+void BirthdayIndexTest::upcomingWholeYear() {
+    BirthdayIndex index(contacts);
+    index.build(liveSlots);
+
+    // Окно в 366 дней начинается и кончается 1 июня: этот день рождения попадает в него дважды
+    QCOMPARE(describe(index.upcoming(QDate(2026, 6, 1), BirthdayIndex::MaxDays)),
+             QStringList({"4 01-06-2026 56", "2 26-12-2026 41", "1 01-01-2027 37", "0 28-02-2027 27", "4 01-06-2027 57"}));
+}
+
+void BirthdayIndexTest::bornBetween() {
+    BirthdayIndex index(contacts);
+    index.build(liveSlots);
+
+    QCOMPARE(index.bornBetween(QDate(1985, 1, 1), QDate(1990, 12, 31)), QVector<int>({2, 1}));
+    QCOMPARE(index.bornBetween(QDate(2000, 2, 29), QDate(2000, 2, 29)), QVector<int>({0}));
+    QCOMPARE(index.bornBetween(QDate(1960, 1, 1), QDate(2030, 12, 31)), QVector<int>({4, 2, 1, 0}));
+    QVERIFY(index.bornBetween(QDate(1990, 12, 31), QDate(1985, 1, 1)).isEmpty());
+}
+
+void BirthdayIndexTest::maintainedOnEdits() {
+    ContactStore store = contacts;
+    BirthdayIndex index(store);
+    index.build(liveSlots);
+
+    // Правка: убрать, пока в хранилище старая дата, и добавить с новой
+    index.remove(1);
+    store.set(1, person("20-12-1991"));
+    index.insert(1);
+
+    // Новые контакты пачкой; текстовая дата в индекс не попадает
+    const int added = store.append(person("27-12-1999"));
+    const int text = store.append(person("весной"));
+    index.insert(QVector<int>({added, text}));
+
+    QCOMPARE(describe(index.upcoming(QDate(2025, 12, 15), 14)),
+             QStringList({"1 20-12-2025 34", "2 26-12-2025 40", QString("%1 27-12-2025 26").arg(added)}));
+
+    // Удалённый контакт больше не находится
+    index.remove(2);
+    store.erase(2);
+    QCOMPARE(index.bornBetween(QDate(1985, 1, 1), QDate(1985, 12, 31)), QVector<int>());
+    QCOMPARE(describe(index.upcoming(QDate(2025, 12, 15), 14)).size(), 2);
+}
+
+QTEST_APPLESS_MAIN(BirthdayIndexTest)
+#include "BirthdayIndexTest.moc"
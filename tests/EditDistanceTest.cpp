@@ -0,0 +1,105 @@
+#include <QtTest>
+#include <algorithm>
+
+#include "EditDistance.hpp"
+
+/*
+ * Проверки расстояния правок по Майерсу: известные пары, расстояние до начала и до всего текста,
+ * пустые строки и сверка со школьной динамикой на случайных словах.
+ */
+class EditDistanceTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void knownPairs_data();
+    void knownPairs();
+    void emptyStrings();
+    void matchesReference();
+
+private:
+    // Динамика по всей матрице: prefix - минимум по последней строке, whole - её последняя клетка
+    static void reference(QStringView pattern, QStringView text, int &prefix, int &whole);
+};
+
+void EditDistanceTest::reference(QStringView pattern, QStringView text, int &prefix, int &whole) {
+    QVector<int> row(text.size() + 1);
+    for (int j = 0; j <= text.size(); ++j) row[j] = j;
+    for (int i = 1; i <= pattern.size(); ++i) {
+        int diagonal = row[0];
+        row[0] = i;
+        for (int j = 1; j <= text.size(); ++j) {
+            const int above = row[j];
+            row[j] = std::min({above + 1, row[j - 1] + 1, diagonal + (pattern[i - 1] == text[j - 1] ? 0 : 1)});
+            diagonal = above;
+        }
+    }
+    prefix = *std::min_element(row.cbegin(), row.cend());
+    whole = row.last();
+}
+
+void EditDistanceTest::knownPairs_data() {
+    QTest::addColumn<QString>("pattern");
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<int>("prefix");
+    QTest::addColumn<int>("whole");
+
+    QTest::newRow("same") << "иванов" << "иванов" << 0 << 0;
+    QTest::newRow("classic") << "kitten" << "sitting" << 3 << 3;
+    QTest::newRow("pattern is prefix") << "иван" << "иванов" << 0 << 2;
+    QTest::newRow("prefix with typo") << "ивн" << "иванов" << 1 << 3;
+    QTest::newRow("name and more") << "петров" << "петрова анна" << 0 << 6;
+    QTest::newRow("replaced letter") << "смирнов" << "смирнав" << 1 << 1;
+    QTest::newRow("repeated letters") << "аааа" << "аа" << 2 << 2;
+}
+
+void EditDistanceTest::knownPairs() {
+    QFETCH(QString, pattern);
+    QFETCH(QString, text);
+    QFETCH(int, prefix);
+    QFETCH(int, whole);
+
+    int gotPrefix = -1;
+    int gotWhole = -1;
+    EditDistance(pattern).compute(text, gotPrefix, gotWhole);
+    QCOMPARE(gotPrefix, prefix);
+    QCOMPARE(gotWhole, whole);
+    QCOMPARE(EditDistance(pattern).distance(text), whole);
+}
+
+void EditDistanceTest::emptyStrings() {
+    int prefix = -1;
+    int whole = -1;
+    EditDistance(u"абв").compute(u"", prefix, whole);
+    QCOMPARE(prefix, 3);
+    QCOMPARE(whole, 3);
+
+    EditDistance(u"").compute(u"abc", prefix, whole);
+    QCOMPARE(prefix, 0);
+    QCOMPARE(whole, 3);
+
+    QCOMPARE(EditDistance(u"").distance(u""), 0);
+}
+
+void EditDistanceTest::matchesReference() {
+    // Маленький алфавит, чтобы совпадений было много; длины до 64 - весь шаблон в одном слове
+    const QString alphabet = "абвгде";
+    QRandomGenerator random(7);
+    auto randomWord = [&random, &alphabet](int maxLength) {
+        QString word;
+        const int length = random.bounded(maxLength + 1);
+        for (int i = 0; i < length; ++i) word.append(alphabet[random.bounded(alphabet.size())]);
+        return word;
+    };
+
+    for (int round = 0; round < 2000; ++round) {
+        const QString pattern = randomWord(64);
+        const QString text = randomWord(80);
+        int prefix, whole, expectedPrefix, expectedWhole;
+        EditDistance(pattern).compute(text, prefix, whole);
+        reference(pattern, text, expectedPrefix, expectedWhole);
+        QVERIFY2(prefix == expectedPrefix && whole == expectedWhole, qPrintable(pattern + " / " + text));
+    }
+}
+
+QTEST_APPLESS_MAIN(EditDistanceTest)
+#include "EditDistanceTest.moc"